@@ -76,7 +76,8 @@ run_simulation() {
     print_info "Compiling SPI Slave testbench..."
     $IVERILOG -g2012 -o spi_slave_tb \
         "$TB_DIR/tb_spi_slave.v" \
-        "$SRC_DIR/soc/spi_slave.v"
+        "$SRC_DIR/soc/spi_slave.v" \
+        "$SRC_DIR/soc/spi_master.v"
     
     if [ $? -eq 0 ]; then
         print_info "Running SPI Slave testbench..."
@@ -86,6 +87,21 @@ run_simulation() {
         exit 1
     fi
     
+    # Same testbench against the SCK-clocked slave datapath
+    print_info "Compiling SCK-clocked SPI Slave testbench..."
+    $IVERILOG -g2012 -P tb_spi_slave.SCK_CLOCKED=1 -o spi_slave_sck_tb \
+        "$TB_DIR/tb_spi_slave.v" \
+        "$SRC_DIR/soc/spi_slave.v" \
+        "$SRC_DIR/soc/spi_master.v"
+    
+    if [ $? -eq 0 ]; then
+        print_info "Running SCK-clocked SPI Slave testbench..."
+        $VVP spi_slave_sck_tb
+    else
+        print_error "Failed to compile SCK-clocked SPI Slave testbench"
+        exit 1
+    fi
+    
     print_info "Simulation completed successfully"
 }
 
@@ -162,6 +178,18 @@ build_firmware() {
         -o spi_driver.o \
         "$FIRMWARE_DIR/spi_driver.c"
     
+    # Compile transaction queue
+    gcc -c -Wall -Wextra -O2 \
+        -I "$FIRMWARE_DIR" \
+        -o spi_queue.o \
+        "$FIRMWARE_DIR/spi_queue.c"
+    
+    # Compile timer driver
+    gcc -c -Wall -Wextra -O2 \
+        -I "$FIRMWARE_DIR" \
+        -o timer.o \
+        "$FIRMWARE_DIR/timer.c"
+    
     # Compile main application
     gcc -c -Wall -Wextra -O2 \
         -I "$FIRMWARE_DIR" \
@@ -171,6 +199,8 @@ build_firmware() {
     # Link
     gcc -o spi_test.elf \
         spi_driver.o \
+        spi_queue.o \
+        timer.o \
         main.o
     
     if [ $? -eq 0 ]; then
@@ -0,0 +1,223 @@
+#!/usr/bin/env python3
+"""Synthesis QoR benchmark: area and Fmax of spi_controller per configuration.
+
+Usage: ./scripts/synth_bench.py [--param NAME=V1,V2,...]... [-o results.csv]
+                                [--baseline old.csv] [--tolerance PCT]
+
+Every combination of the --param values is one build of the out-of-context
+wrapper src/synth/spi_synth_bench.v: Yosys synth_ice40, then nextpnr-ice40
+place and route against the --freq target. LUTs, FFs and BRAMs are the
+Yosys cell counts (SB_LUT4, SB_DFF*, SB_RAM40_4K); logic cells and Fmax
+come from the nextpnr report after routing. Fmax is the slowest clock, so
+SCK tops out at Fmax with CLK_DIV.FAST and at Fmax / 2 divided.
+
+The table goes to stdout and the CSV keeps one row per configuration.
+--baseline compares against the CSV of an earlier run and flags rows whose
+LUTs grow or whose Fmax drops by more than --tolerance percent. A
+configuration that fails to build (or to fit the device) is reported and
+the matrix carries on. The exit status is 1 when any row failed or was
+flagged.
+
+Experimental: this has not yet been run against a real Yosys/nextpnr
+install, so the stat and report JSON fields it reads are unverified.
+"""
+
+import argparse
+import csv
+import itertools
+import json
+import os
+import subprocess
+import sys
+
+PROJECT_ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SRC_DIR = os.path.join(PROJECT_ROOT, "src")
+SOURCES = [
+    os.path.join(SRC_DIR, "soc", "spi_master.v"),
+    os.path.join(SRC_DIR, "soc", "spi_controller.v"),
+    os.path.join(SRC_DIR, "synth", "spi_synth_bench.v"),
+]
+TOP = "spi_synth_bench"
+
+DEFAULT_MATRIX = ["FIFO_DEPTH=4,8,16", "TRACE_DEPTH=0,256"]
+
+CSV_FIELDS = ["config", "luts", "ffs", "brams", "lcs", "lcs_avail", "fmax_mhz", "status"]
+
+
+def parse_matrix(params):
+    """Turn NAME=V1,V2 strings into a list of [(name, value), ...] configs."""
+    axes = []
+    for param in params:
+        name, sep, values = param.partition("=")
+        if not sep or not name or not values:
+            raise ValueError("bad --param %r, expected NAME=V1,V2,..." % param)
+        axes.append([(name, value) for value in values.split(",")])
+    return [list(combo) for combo in itertools.product(*axes)]
+
+
+def config_name(config):
+    return ",".join("%s=%s" % (name, value) for name, value in config) or "default"
+
+
+def run(cmd, log_path):
+    with open(log_path, "w") as log:
+        return subprocess.call(cmd, stdout=log, stderr=subprocess.STDOUT) == 0
+
+
+def log_tail(log_path, lines=5):
+    if not os.path.exists(log_path):
+        return "(no log)"
+    with open(log_path) as log:
+        return "".join(log.readlines()[-lines:])
+
+
+def synthesize(args, config, work):
+    """Yosys synth_ice40; returns the cell counts by type."""
+    netlist = os.path.join(work, "netlist.json")
+    stat = os.path.join(work, "stat.json")
+    script = os.path.join(work, "synth.ys")
+
+    with open(script, "w") as ys:
+        for src in SOURCES:
+            ys.write("read_verilog -sv %s\n" % src)
+        for name, value in config:
+            ys.write("chparam -set %s %s %s\n" % (name, value, TOP))
+        ys.write("synth_ice40 -top %s -json %s\n" % (TOP, netlist))
+        ys.write("tee -q -o %s stat -json\n" % stat)
+
+    log = os.path.join(work, "yosys.log")
+    if not run([args.yosys, "-q", "-l", log, script], os.path.join(work, "yosys.out")):
+        raise RuntimeError("yosys failed:\n" + log_tail(log))
+
+    # The design totals, or the one flattened module in older releases
+    with open(stat) as f:
+        data = json.load(f)
+    design = data.get("design") or next(iter(data["modules"].values()))
+    return netlist, design["num_cells_by_type"]
+
+
+def place_and_route(args, netlist, work):
+    """nextpnr-ice40; returns (lcs_used, lcs_avail, fmax_mhz)."""
+    report = os.path.join(work, "report.json")
+    log = os.path.join(work, "nextpnr.log")
+    cmd = [args.nextpnr, "--" + args.device, "--package", args.package,
+           "--json", netlist, "--asc", os.path.join(work, "design.asc"),
+           "--freq", str(args.freq), "--seed", str(args.seed),
+           "--pcf-allow-unconstrained", "--report", report]
+    if not run(cmd, log):
+        raise RuntimeError("nextpnr failed:\n" + log_tail(log))
+
+    with open(report) as f:
+        data = json.load(f)
+    lcs = data["utilization"]["ICESTORM_LC"]
+    fmax = min(clock["achieved"] for clock in data["fmax"].values())
+    return lcs["used"], lcs["available"], fmax
+
+
+def bench_config(args, config):
+    name = config_name(config)
+    work = os.path.join(args.build_dir, name.replace(",", "_").replace("=", ""))
+    os.makedirs(work, exist_ok=True)
+    row = dict.fromkeys(CSV_FIELDS, "")
+    row["config"] = name
+
+    try:
+        netlist, cells = synthesize(args, config, work)
+        row["luts"] = cells.get("SB_LUT4", 0)
+        row["ffs"] = sum(n for cell, n in cells.items() if cell.startswith("SB_DFF"))
+        row["brams"] = cells.get("SB_RAM40_4K", 0)
+        row["lcs"], row["lcs_avail"], fmax = place_and_route(args, netlist, work)
+        row["fmax_mhz"] = "%.1f" % fmax
+        row["status"] = "ok"
+    except (RuntimeError, OSError, KeyError, ValueError) as err:
+        row["status"] = "failed"
+        print("synth_bench: %s: %s" % (name, err), file=sys.stderr)
+    return row
+
+
+def percent(new, old):
+    return 100.0 * (float(new) - float(old)) / float(old) if float(old) else 0.0
+
+
+def compare(row, base, tolerance):
+    """Change against the baseline row: (text, regressed)."""
+    if base is None or row["status"] != "ok" or base.get("status") != "ok":
+        return "", False
+    luts = percent(row["luts"], base["luts"])
+    fmax = percent(row["fmax_mhz"], base["fmax_mhz"])
+    regressed = luts > tolerance or fmax < -tolerance
+    text = "LUTs %+.1f%%, Fmax %+.1f%%" % (luts, fmax)
+    return text + ("  REGRESSION" if regressed else ""), regressed
+
+
+def print_table(rows, baseline, tolerance):
+    width = max([len("config")] + [len(row["config"]) for row in rows])
+    print("%-*s %6s %6s %5s %13s %9s" % (width, "config", "LUTs", "FFs", "BRAM",
+                                         "LCs", "Fmax MHz"))
+    regressions = 0
+    for row in rows:
+        if row["status"] != "ok":
+            print("%-*s %s" % (width, row["config"], "build failed"))
+            continue
+        used = "%s/%s" % (row["lcs"], row["lcs_avail"])
+        delta, regressed = compare(row, baseline.get(row["config"]), tolerance)
+        regressions += regressed
+        line = "%-*s %6s %6s %5s %13s %9s  %s" % (width, row["config"], row["luts"],
+                                                  row["ffs"], row["brams"], used,
+                                                  row["fmax_mhz"], delta)
+        print(line.rstrip())
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Synthesis area and Fmax benchmark")
+    parser.add_argument("--param", action="append", metavar="NAME=V1,V2",
+                        help="spi_synth_bench parameter values to sweep (repeatable, "
+                             "default: %s)" % " ".join(DEFAULT_MATRIX))
+    parser.add_argument("-o", "--output", help="CSV results file")
+    parser.add_argument("--baseline", help="CSV of an earlier run to compare against")
+    parser.add_argument("--tolerance", type=float, default=5.0,
+                        help="percent change flagged as a regression (default: 5)")
+    parser.add_argument("--device", default="hx8k", help="nextpnr-ice40 device (default: hx8k)")
+    parser.add_argument("--package", default="ct256", help="device package (default: ct256)")
+    parser.add_argument("--freq", type=float, default=50.0,
+                        help="clock target in MHz (default: 50)")
+    parser.add_argument("--seed", type=int, default=1, help="placer seed (default: 1)")
+    parser.add_argument("--build-dir", default=os.path.join(PROJECT_ROOT, "build", "synth_bench"),
+                        help="work directory, one subdirectory per configuration")
+    parser.add_argument("--yosys", default="yosys")
+    parser.add_argument("--nextpnr", default="nextpnr-ice40")
+    args = parser.parse_args()
+
+    try:
+        configs = parse_matrix(args.param or DEFAULT_MATRIX)
+    except ValueError as err:
+        sys.exit("synth_bench: %s" % err)
+
+    baseline = {}
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = {row["config"]: row for row in csv.DictReader(f)}
+
+    rows = []
+    for config in configs:
+        print("synth_bench: building %s" % config_name(config), file=sys.stderr)
+        rows.append(bench_config(args, config))
+
+    if args.output:
+        with open(args.output, "w", newline="") as f:
+            writer = csv.DictWriter(f, fieldnames=CSV_FIELDS)
+            writer.writeheader()
+            writer.writerows(rows)
+
+    regressions = print_table(rows, baseline, args.tolerance)
+    failed = sum(row["status"] != "ok" for row in rows)
+    if failed:
+        print("synth_bench: %d of %d configurations failed" % (failed, len(rows)),
+              file=sys.stderr)
+    if failed or regressions:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
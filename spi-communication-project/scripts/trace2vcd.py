@@ -0,0 +1,195 @@
+#!/usr/bin/env python3
+"""Convert an SPI controller trace dump to VCD.
+
+Usage: ./scripts/trace2vcd.py [dump] [-o trace.vcd] [--clk-hz HZ] [--binary]
+
+The dump is what spi_trace_dump() returns: two 32-bit words per entry,
+stamp then payload. Text input takes every line containing
+"TRACE,<stamp>,<data>" in hex (the format printed by the test firmware),
+so a console log can be passed as is. --binary reads the raw entries as
+little-endian words instead. Without a dump file the input is stdin.
+
+Stamps count controller clock cycles in 28 bits. They are unwrapped in
+dump order, so consecutive entries must be less than 2^27 cycles apart.
+Entries are then sorted by time, as the controller may store events that
+land in the same few cycles out of order.
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+STAMP_BITS = 28
+STAMP_MASK = (1 << STAMP_BITS) - 1
+
+KIND_FRAME = 1
+KIND_CS = 2
+KIND_STALL = 3
+
+# (name, width, VCD identifier)
+SIGNALS = [
+    ("cs_n", 4, "!"),
+    ("tx_byte", 8, '"'),
+    ("rx_byte", 8, "#"),
+    ("tx_level", 8, "$"),
+    ("rx_level", 8, "%"),
+    ("frame", 1, "&"),
+    ("stall_tx_empty", 1, "'"),
+    ("stall_gap", 1, "("),
+    ("stall_rx_full", 1, ")"),
+    ("underrun", 1, "*"),
+    ("overrun", 1, "+"),
+]
+
+STALL_LEVELS = ["stall_tx_empty", "stall_gap", "stall_rx_full"]
+STALL_PULSES = ["underrun", "overrun"]
+
+TRACE_LINE = re.compile(r"TRACE,(?:0x)?([0-9A-Fa-f]{1,8}),(?:0x)?([0-9A-Fa-f]{1,8})")
+
+
+def read_text(stream):
+    entries = []
+    for line in stream:
+        match = TRACE_LINE.search(line)
+        if match:
+            entries.append((int(match.group(1), 16), int(match.group(2), 16)))
+    return entries
+
+
+def read_binary(data):
+    if len(data) % 8 != 0:
+        raise ValueError("binary dump is not a whole number of 8-byte entries")
+    return [struct.unpack_from("<II", data, off) for off in range(0, len(data), 8)]
+
+
+def unwrap(entries):
+    """Return (cycle, kind, data) in time order; empty entries are skipped."""
+    events = []
+    epoch = 0
+    last = None
+    for stamp, data in entries:
+        kind = stamp >> STAMP_BITS
+        if kind == 0:
+            continue
+        time = stamp & STAMP_MASK
+        if last is not None and time + (1 << (STAMP_BITS - 1)) < last:
+            epoch += 1 << STAMP_BITS
+        last = time
+        events.append((epoch + time, kind, data))
+    events.sort(key=lambda event: event[0])
+    return events
+
+
+def value_changes(events):
+    """Yield (cycle, {signal: value}) in time order."""
+    pulses_off = {}
+    for cycle, kind, data in events:
+        # Pulses raised at an earlier cycle drop one cycle later
+        for when in sorted(t for t in pulses_off if t <= cycle):
+            yield when, dict.fromkeys(pulses_off.pop(when), 0)
+
+        changes = {}
+        if kind == KIND_FRAME:
+            changes["tx_byte"] = data & 0xFF
+            changes["rx_byte"] = (data >> 8) & 0xFF
+            changes["tx_level"] = (data >> 16) & 0xFF
+            changes["rx_level"] = (data >> 24) & 0xFF
+            changes["frame"] = 1
+            pulses_off.setdefault(cycle + 1, set()).add("frame")
+        elif kind == KIND_CS:
+            changes["cs_n"] = data & 0xF
+        elif kind == KIND_STALL:
+            for bit, name in enumerate(STALL_LEVELS):
+                changes[name] = (data >> bit) & 1
+            for bit, name in enumerate(STALL_PULSES, len(STALL_LEVELS)):
+                if (data >> bit) & 1:
+                    changes[name] = 1
+                    pulses_off.setdefault(cycle + 1, set()).add(name)
+        yield cycle, changes
+
+    for when in sorted(pulses_off):
+        yield when, dict.fromkeys(pulses_off[when], 0)
+
+
+def vcd_value(width, ident, value):
+    if width == 1:
+        return "%d%s" % (value, ident)
+    return "b%s %s" % (format(value, "b"), ident)
+
+
+def write_vcd(out, events, clk_hz):
+    period_ps = max(1, round(1e12 / clk_hz))
+    widths = {name: (width, ident) for name, width, ident in SIGNALS}
+
+    out.write("$date SPI controller trace $end\n")
+    out.write("$timescale 1ps $end\n")
+    out.write("$scope module spi_trace $end\n")
+    for name, width, ident in SIGNALS:
+        out.write("$var wire %d %s %s $end\n" % (width, ident, name))
+    out.write("$upscope $end\n$enddefinitions $end\n")
+
+    # Unknown until the first event of each signal, pulses start low
+    out.write("$dumpvars\n")
+    for name, width, ident in SIGNALS:
+        if name == "frame" or name in STALL_PULSES:
+            out.write(vcd_value(width, ident, 0) + "\n")
+        else:
+            out.write(("x" if width == 1 else "bx ") + ident + "\n")
+    out.write("$end\n")
+
+    current = {}
+    last_cycle = None
+    for cycle, changes in value_changes(events):
+        lines = []
+        for name, value in changes.items():
+            if current.get(name) != value:
+                current[name] = value
+                width, ident = widths[name]
+                lines.append(vcd_value(width, ident, value))
+        if not lines:
+            continue
+        if cycle != last_cycle:
+            out.write("#%d\n" % (cycle * period_ps))
+            last_cycle = cycle
+        out.write("\n".join(lines) + "\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert an SPI trace dump to VCD")
+    parser.add_argument("dump", nargs="?", help="dump file (default: stdin)")
+    parser.add_argument("-o", "--output", help="VCD file (default: stdout)")
+    parser.add_argument("--clk-hz", type=float, default=50e6,
+                        help="controller clock in Hz (default: 50 MHz)")
+    parser.add_argument("--binary", action="store_true",
+                        help="dump is raw little-endian entries")
+    args = parser.parse_args()
+
+    if args.binary:
+        if args.dump:
+            with open(args.dump, "rb") as stream:
+                entries = read_binary(stream.read())
+        else:
+            entries = read_binary(sys.stdin.buffer.read())
+    elif args.dump:
+        with open(args.dump) as stream:
+            entries = read_text(stream)
+    else:
+        entries = read_text(sys.stdin)
+
+    events = unwrap(entries)
+    if not events:
+        sys.exit("trace2vcd: no trace entries in the input")
+
+    if args.output:
+        with open(args.output, "w") as out:
+            write_vcd(out, events, args.clk_hz)
+    else:
+        write_vcd(sys.stdout, events, args.clk_hz)
+
+    print("trace2vcd: %d events over %d cycles" % (len(events), events[-1][0] - events[0][0]),
+          file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
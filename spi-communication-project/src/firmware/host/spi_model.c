@@ -0,0 +1,1263 @@
+// SPI Controller Host Model Implementation
+// Every register access advances the model clock by SPI_MODEL_ACCESS_CYCLES
+// and first runs the master up to that time, so polling loops, FIFO levels
+// and timeouts behave as they do against spi_controller. Frames are timed
+// from CLK_DIV, the frame size and the lane count, and their bytes are
+// exchanged with the selected device (MSB first) when the master loads
+// them. Only SPI_FLASH_CS of controller 0 has a device on it; other lines
+// read back 0xFF unless loopback is on. The timer at TIMER_BASE_ADDR counts
+// model cycles.
+//
+// Each of the SPI_MODEL_NUM_CTRL controllers has its own registers,
+// master, FIFOs, DMA engine and interrupt line, and all of them run on the
+// one model clock, so transfers on different buses overlap in time. The
+// controller being accessed (or whose master is being run) is c; every
+// per-controller helper works on it.
+//
+// The trace buffer records FRAME and CS events; stall reasons are only
+// captured in the snapshot taken when a trace starts.
+
+#include "spi_model.h"
+#include "spi_driver.h"
+#include "timer.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+// Controller build parameters and register masks (as in spi_controller.v)
+#define MODEL_FIFO_DEPTH    SPI_FIFO_DEPTH
+#define MODEL_VERSION       0x00010000
+#define MODEL_CLK_DIV_MASK  0x010FFFFF
+#define MODEL_PROFILE_MASK  0x00FF3337
+#define MODEL_CS_CFG_MASK   (CS_CFG_EN | CS_CFG_DIV(0xFF) | CS_CFG_POL | CS_CFG_MODE(3))
+#define MODEL_DMA_WINDOWS   8
+#define MODEL_TRACE_DEPTH   256     // SPI_TRACE_DEPTH in top
+
+// Flash busy times in model cycles (datasheet typicals)
+#define FLASH_CYCLES_US         (SPI_MODEL_CLK_HZ / 1000000)
+#define FLASH_PROGRAM_CYCLES    (700 * FLASH_CYCLES_US)
+#define FLASH_ERASE_4K_CYCLES   (45000 * FLASH_CYCLES_US)
+#define FLASH_ERASE_32K_CYCLES  (120000 * FLASH_CYCLES_US)
+#define FLASH_ERASE_64K_CYCLES  (150000 * FLASH_CYCLES_US)
+#define FLASH_CMD_WRITE_DISABLE 0x04
+#define FLASH_STATUS_WEL        (1 << 1)
+
+// Show-ahead FIFO of frames
+typedef struct {
+    uint32_t data[MODEL_FIFO_DEPTH];
+    uint32_t head;
+    uint32_t count;
+} model_fifo_t;
+
+// Host memory visible to the DMA engine
+typedef struct {
+    uint32_t bus_addr;
+    uint8_t *host;
+    uint32_t size;
+} dma_window_t;
+
+// What the master is doing until phase_end
+typedef enum {
+    PHASE_FRAME,    // Shifting a frame; COMPLETE at phase_end
+    PHASE_HOLD,     // CS hold time, CS released at phase_end
+} master_phase_t;
+
+// One controller
+typedef struct {
+    // Registers
+    struct {
+        uint32_t control;
+        uint32_t tx_data;
+        uint32_t rx_data;
+        uint32_t clk_div;
+        uint32_t irq_en;
+        uint32_t tx_low;
+        uint32_t rx_high;
+        uint32_t cs_timing;
+        uint32_t auto_cs;
+        uint32_t cs_cfg[4];
+        uint32_t profile[SPI_NUM_PROFILES];
+        uint32_t xip_ctrl;
+        uint32_t fill_data;
+        uint32_t crc_ctrl;
+        uint32_t crc_poly;
+        uint32_t crc_init;
+        uint32_t crc_tx;
+        uint32_t crc_rx;
+        bool start_req;
+        bool irq_done_flag;
+        bool irq_error_flag;
+    } regs;
+    
+    // Master state machine
+    struct {
+        bool busy;
+        bool cs_asserted;
+        bool fast;                // CLK_DIV.FAST, sampled while CS is deasserted
+        uint32_t frames_left;
+        uint32_t fill_left;       // TX fill frames not yet started
+        master_phase_t phase;
+        uint64_t phase_end;
+        uint32_t tx_frame;
+        uint32_t rx_frame;
+        uint32_t frame_bytes;
+        bool reg_frame;           // Started from TX_DATA, not a FIFO
+    } master;
+    
+    // DMA engine
+    struct {
+        uint32_t src;
+        uint32_t dst;
+        uint32_t len;
+        bool tx_en;
+        bool rx_en;
+        bool sg;
+        bool busy;
+        bool done_flag;
+        uint32_t tx_left;
+        uint32_t rx_left;
+        bool seg_tx_en;           // Directions of the current segment
+        bool seg_rx_en;
+        uint32_t desc;            // Next scatter-gather descriptor
+        uint32_t desc_left;
+    } dma;
+    
+    // Performance counters
+    struct {
+        uint32_t bytes;
+        uint32_t busy;
+        uint32_t idle;
+        uint32_t underrun;
+        uint32_t overrun;
+        uint32_t irq_cnt;
+        uint32_t irq_lat;
+        bool freeze;
+    } perf;
+    
+    // Trace buffer
+    struct {
+        uint32_t ctrl;            // EN, ONESHOT and the event mask
+        spi_trace_entry_t entries[MODEL_TRACE_DEPTH];
+        uint32_t head;
+        uint32_t count;
+        bool rd_half;             // Stamp word of the head already read
+        bool wrapped;
+        bool lost;
+        uint64_t start;           // Model time of the last CLEAR
+    } trace;
+    
+    model_fifo_t tx_fifo;
+    model_fifo_t rx_fifo;
+    bool irq_prev;
+    void (*irq_handler)(void);
+} model_ctrl_t;
+
+static model_ctrl_t ctrls[SPI_MODEL_NUM_CTRL];
+static model_ctrl_t *c = &ctrls[0];
+
+// Host memory visible to the DMA engines
+static dma_window_t dma_windows[MODEL_DMA_WINDOWS];
+static uint32_t dma_num_windows = 0;
+
+// Serial NOR flash on SPI_FLASH_CS of controller 0
+static struct {
+    uint8_t mem[SPI_MODEL_FLASH_SIZE];
+    bool selected;
+    uint32_t count;           // Bytes clocked in this CS window
+    uint8_t cmd;
+    uint32_t addr;
+    bool wel;
+    uint64_t busy_until;
+    uint8_t page[FLASH_PAGE_SIZE];
+    bool page_valid[FLASH_PAGE_SIZE];
+} flash;
+
+static uint64_t now = 0;              // Model time in controller cycles
+static uint32_t timer_hi_snapshot = 0;
+static bool model_ready = false;
+static bool in_irq = false;
+
+// FIFO helpers
+static void fifo_push(model_fifo_t *fifo, uint32_t value) {
+    fifo->data[(fifo->head + fifo->count) % MODEL_FIFO_DEPTH] = value;
+    fifo->count++;
+}
+
+static uint32_t fifo_pop(model_fifo_t *fifo) {
+    uint32_t value = fifo->data[fifo->head];
+    
+    if (fifo->count > 0) {
+        fifo->head = (fifo->head + 1) % MODEL_FIFO_DEPTH;
+        fifo->count--;
+    }
+    return value;
+}
+
+// Counters stand still while frozen
+static void perf_add(uint32_t *counter, uint32_t amount) {
+    if (!c->perf.freeze) {
+        *counter += amount;
+    }
+}
+
+// Append a trace entry of the given kind when that kind is being recorded
+static void trace_record(uint32_t kind, uint32_t event, uint32_t data) {
+    if (!(c->trace.ctrl & TRACE_CTRL_EN) || !(c->trace.ctrl & event)) {
+        return;
+    }
+    
+    if (c->trace.count == MODEL_TRACE_DEPTH) {
+        if (c->trace.ctrl & TRACE_CTRL_ONESHOT) {
+            c->trace.lost = true;
+            return;
+        }
+        c->trace.head = (c->trace.head + 1) % MODEL_TRACE_DEPTH;
+        c->trace.count--;
+        c->trace.rd_half = false;
+        c->trace.wrapped = true;
+    }
+    
+    spi_trace_entry_t *entry = &c->trace.entries[(c->trace.head + c->trace.count) %
+                                                 MODEL_TRACE_DEPTH];
+    entry->stamp = (kind << 28) | ((uint32_t)(now - c->trace.start) & 0x0FFFFFFF);
+    entry->data = data;
+    c->trace.count++;
+}
+
+// Flash
+static bool flash_busy(void) {
+    return now < flash.busy_until;
+}
+
+// First data byte of a read command, 0 for anything else. 0xEB sends an
+// address and mode byte on four lanes and 4 dummy clocks (two bytes).
+static uint32_t flash_data_offset(uint8_t cmd) {
+    switch (cmd) {
+        case FLASH_CMD_READ:
+            return 4;
+        case FLASH_CMD_FAST_READ:
+        case SPI_FLASH_READ_DUAL_OUT:
+        case SPI_FLASH_READ_QUAD_OUT:
+            return 5;
+        case SPI_FLASH_READ_QUAD_IO:
+            return 7;
+        default:
+            return 0;
+    }
+}
+
+// CS falling edge: a new command starts
+static void flash_select(void) {
+    flash.selected = true;
+    flash.count = 0;
+    flash.cmd = 0;
+    flash.addr = 0;
+    memset(flash.page_valid, 0, sizeof(flash.page_valid));
+}
+
+// CS rising edge: write enable, program and erase take effect
+static void flash_deselect(void) {
+    uint32_t size = 0;
+    uint32_t busy = 0;
+    
+    flash.selected = false;
+    
+    switch (flash.cmd) {
+        case FLASH_CMD_WRITE_ENABLE:
+            flash.wel = true;
+            return;
+        case FLASH_CMD_WRITE_DISABLE:
+            flash.wel = false;
+            return;
+        case FLASH_CMD_PAGE_PROGRAM:
+            if (flash.wel && flash.count > 4) {
+                uint32_t base = flash.addr & ~(FLASH_PAGE_SIZE - 1);
+                for (uint32_t off = 0; off < FLASH_PAGE_SIZE; off++) {
+                    if (flash.page_valid[off]) {
+                        flash.mem[base + off] &= flash.page[off];
+                    }
+                }
+                flash.busy_until = now + FLASH_PROGRAM_CYCLES;
+                flash.wel = false;
+            }
+            return;
+        case FLASH_CMD_ERASE_4K:
+            size = FLASH_SECTOR_SIZE;
+            busy = FLASH_ERASE_4K_CYCLES;
+            break;
+        case FLASH_CMD_ERASE_32K:
+            size = FLASH_BLOCK_32K;
+            busy = FLASH_ERASE_32K_CYCLES;
+            break;
+        case FLASH_CMD_ERASE_64K:
+            size = FLASH_BLOCK_64K;
+            busy = FLASH_ERASE_64K_CYCLES;
+            break;
+        default:
+            return;
+    }
+    
+    if (flash.wel && flash.count >= 4) {
+        memset(&flash.mem[flash.addr & ~(size - 1)], 0xFF, size);
+        flash.busy_until = now + busy;
+        flash.wel = false;
+    }
+}
+
+// One byte in on IO0, one byte out. While an operation is in progress
+// only READ STATUS is accepted.
+static uint8_t flash_exchange(uint8_t in) {
+    static const uint8_t id[3] = {
+        SPI_MODEL_FLASH_MFR_ID, SPI_MODEL_FLASH_DEV_ID, SPI_MODEL_FLASH_CAP_ID
+    };
+    uint32_t n = flash.count++;
+    
+    if (n == 0) {
+        flash.cmd = (flash_busy() && in != FLASH_CMD_READ_STATUS) ? 0 : in;
+        return 0xFF;
+    }
+    
+    if (flash.cmd == FLASH_CMD_READ_STATUS) {
+        return (flash_busy() ? FLASH_STATUS_WIP : 0) | (flash.wel ? FLASH_STATUS_WEL : 0);
+    }
+    
+    if (flash.cmd == FLASH_CMD_READ_ID) {
+        return (n <= 3) ? id[n - 1] : 0xFF;
+    }
+    
+    // 24-bit address, MSB first
+    if (n <= 3) {
+        flash.addr = ((flash.addr << 8) | in) & (SPI_MODEL_FLASH_SIZE - 1);
+        return 0xFF;
+    }
+    
+    uint32_t data = flash_data_offset(flash.cmd);
+    if (data != 0) {
+        return (n >= data) ? flash.mem[(flash.addr + n - data) & (SPI_MODEL_FLASH_SIZE - 1)] : 0xFF;
+    }
+    
+    // Program data wraps within the page
+    if (flash.cmd == FLASH_CMD_PAGE_PROGRAM) {
+        uint32_t off = (flash.addr + n - 4) & (FLASH_PAGE_SIZE - 1);
+        flash.page[off] = in;
+        flash.page_valid[off] = true;
+    }
+    
+    return 0xFF;
+}
+
+// Master
+static uint32_t master_cs_line(void) {
+    return (c->regs.control & CTRL_CS_MASK) >> CTRL_CS_SHIFT;
+}
+
+static bool master_cs_hold(void) {
+    return (c->regs.control & CTRL_CS_HOLD) != 0;
+}
+
+// A counted window stays open while it has frames left
+static bool window_counted(void) {
+    return (c->regs.auto_cs & AUTO_CS_EN) && c->master.frames_left != 0;
+}
+
+static bool window_last(void) {
+    return (c->regs.auto_cs & AUTO_CS_EN) && c->master.frames_left == 1;
+}
+
+// Received frames skip the RX FIFO; the DMA engine counts every frame
+static bool rx_discard(void) {
+    return (c->regs.control & CTRL_RX_DISCARD) && !c->dma.busy;
+}
+
+// A fill frame waits for RX FIFO room for what it will receive
+static bool fill_ready(void) {
+    return c->master.fill_left != 0 && (rx_discard() || c->rx_fifo.count < MODEL_FIFO_DEPTH);
+}
+
+// Follow CS on the flash line
+static void flash_update_cs(void) {
+    if (c != &ctrls[0]) {
+        return;
+    }
+    
+    bool selected = c->master.cs_asserted && master_cs_line() == SPI_FLASH_CS;
+    
+    if (selected && !flash.selected) {
+        flash_select();
+    } else if (!selected && flash.selected) {
+        flash_deselect();
+    }
+}
+
+// Levels of the four CS lines: each idles at its configured polarity
+static uint32_t master_cs_lines(void) {
+    uint32_t lines = 0;
+    
+    for (uint32_t i = 0; i < 4; i++) {
+        uint32_t cfg = c->regs.cs_cfg[i];
+        bool active_high = (cfg & CS_CFG_EN) ? (cfg & CS_CFG_POL) != 0
+                                             : (c->regs.control & CTRL_CS_POL) != 0;
+        bool asserted = c->master.cs_asserted && master_cs_line() == i;
+        if (active_high == asserted) {
+            lines |= 1u << i;
+        }
+    }
+    return lines;
+}
+
+static void master_set_cs(bool asserted) {
+    bool changed = (asserted != c->master.cs_asserted);
+    
+    c->master.cs_asserted = asserted;
+    flash_update_cs();
+    if (changed) {
+        trace_record(SPI_TRACE_CS, TRACE_CTRL_CS, master_cs_lines());
+    }
+}
+
+// Cycles to shift one frame of the given width over the given lanes
+static uint32_t frame_cycles(uint32_t bits, uint32_t lanes) {
+    uint32_t beats = bits / ((lanes & 0x2) ? 4 : (lanes == 1) ? 2 : 1);
+    
+    if (c->master.fast) {
+        return beats + ((c->regs.clk_div & CLK_DIV_SAMPLE_MASK) >> 16) + 1;
+    }
+    
+    // Half period in 1/256 cycles
+    uint32_t div = c->regs.clk_div & 0xFF;
+    uint64_t half = ((uint64_t)(div != 0 ? div : 256) << 8) | ((c->regs.clk_div >> 8) & 0xFF);
+    return (uint32_t)((beats * 2 * half + 0xFF) >> 8);
+}
+
+// Shift a frame out MSB first and collect what comes back
+static uint32_t master_exchange(uint32_t frame, uint32_t bytes) {
+    uint32_t mask = (bytes == 4) ? 0xFFFFFFFF : ((1u << (bytes * 8)) - 1);
+    uint32_t rx = 0;
+    
+    frame &= mask;
+    for (uint32_t i = bytes; i > 0; i--) {
+        uint8_t out = (uint8_t)(frame >> ((i - 1) * 8));
+        uint8_t in = (c == &ctrls[0] && flash.selected) ? flash_exchange(out) : 0xFF;
+        rx = (rx << 8) | in;
+    }
+    
+    // Loopback returns the sent frame; the lanes still drive the device
+    return (c->regs.control & CTRL_LOOPBACK) ? frame : rx;
+}
+
+// LOAD_DATA at time start: the TX FIFO has priority over TX fill, fill
+// over a start request, and the request is dropped once the master is busy
+static void master_load(uint64_t start) {
+    uint32_t frame = c->regs.tx_data;
+    c->master.reg_frame = false;
+    if (c->tx_fifo.count > 0) {
+        frame = fifo_pop(&c->tx_fifo);
+    } else if (fill_ready()) {
+        frame = c->regs.fill_data;
+        c->master.fill_left--;
+    } else {
+        c->master.reg_frame = true;
+    }
+    uint32_t lanes = (c->regs.control & CTRL_LANES_MASK) >> CTRL_LANES_SHIFT;
+    
+    c->regs.start_req = false;
+    // DMA frames are bytes whatever CONTROL selects
+    c->master.frame_bytes = c->dma.busy ? 1 :
+                            ((c->regs.control & CTRL_FRAME_MASK) >> CTRL_FRAME_SHIFT) + 1;
+    c->master.tx_frame = frame;
+    c->master.rx_frame = master_exchange(frame, c->master.frame_bytes);
+    c->master.phase = PHASE_FRAME;
+    c->master.phase_end = start + frame_cycles(c->master.frame_bytes * 8, lanes) + 2;
+}
+
+// Busy falls; DONE latches when the TX FIFO has drained
+static void master_go_idle(void) {
+    c->master.busy = false;
+    if (c->tx_fifo.count == 0 && c->master.fill_left == 0) {
+        c->regs.irq_done_flag = true;
+    }
+}
+
+// IDLE: keep or release CS, and start the next window or frame
+static void master_idle(void) {
+    // SCK changes mode only between CS windows
+    if (!c->master.cs_asserted) {
+        c->master.fast = (c->regs.clk_div & CLK_DIV_FAST) != 0;
+    }
+    
+    if (master_cs_hold() || c->master.fill_left != 0) {
+        master_set_cs(true);
+    } else if (!window_counted()) {
+        master_set_cs(false);
+    }
+    
+    if (c->regs.start_req || c->tx_fifo.count > 0 || fill_ready()) {
+        uint64_t start = now + 1;
+        if (!c->master.cs_asserted) {
+            // New window: arm the frame count, then setup time
+            c->master.frames_left = c->regs.auto_cs & 0xFFFF;
+            start += c->regs.cs_timing & 0xFF;
+        }
+        master_set_cs(true);
+        c->master.busy = true;
+        master_load(start);
+    }
+}
+
+// Fold a completed frame into a CRC, in wire order (see spi_controller)
+static uint32_t crc_frame(uint32_t crc, uint32_t frame, uint32_t bytes) {
+    uint32_t top = (c->regs.crc_ctrl >> 8) & 0x1F;
+    bool refin = (c->regs.crc_ctrl & CRC_CTRL_REFIN) != 0;
+    
+    for (uint32_t k = bytes; k > 0; k--) {
+        uint8_t data = (uint8_t)(frame >> ((k - 1) * 8));
+        for (uint32_t j = 0; j < 8; j++) {
+            uint32_t bit = refin ? (data >> j) & 1 : (data >> (7 - j)) & 1;
+            bool feedback = ((crc >> top) & 1) ^ bit;
+            crc = feedback ? ((crc << 1) ^ c->regs.crc_poly) : (crc << 1);
+        }
+    }
+    return crc & (0xFFFFFFFFu >> (31 - top));
+}
+
+// End of the current phase at time now
+static void master_phase_done(void) {
+    if (c->master.phase == PHASE_HOLD) {
+        master_set_cs(false);
+        master_go_idle();
+        return;
+    }
+    
+    // COMPLETE
+    bool counted = window_counted();
+    bool last = window_last();
+    
+    if (rx_discard()) {
+        // Write-only phase: nothing is stored
+    } else if (c->rx_fifo.count < MODEL_FIFO_DEPTH) {
+        fifo_push(&c->rx_fifo, c->master.rx_frame);
+    } else if (!c->master.reg_frame) {
+        // TX_DATA frames are read back through RX_DATA instead
+        perf_add(&c->perf.overrun, 1);
+    }
+    c->regs.rx_data = c->master.rx_frame;
+    perf_add(&c->perf.bytes, c->master.frame_bytes);
+    trace_record(SPI_TRACE_FRAME, TRACE_CTRL_FRAME,
+                 (c->rx_fifo.count << 24) | (c->tx_fifo.count << 16) |
+                 ((c->master.rx_frame & 0xFF) << 8) | (c->master.tx_frame & 0xFF));
+    
+    if (c->regs.crc_ctrl & CRC_CTRL_TX_EN) {
+        c->regs.crc_tx = crc_frame(c->regs.crc_tx, c->master.tx_frame, c->master.frame_bytes);
+    }
+    if (c->regs.crc_ctrl & CRC_CTRL_RX_EN) {
+        c->regs.crc_rx = crc_frame(c->regs.crc_rx, c->master.rx_frame, c->master.frame_bytes);
+    }
+    
+    bool fill_hold = c->master.fill_left != 0;
+    if (c->tx_fifo.count == 0 && !fill_hold && (master_cs_hold() || (counted && !last))) {
+        perf_add(&c->perf.underrun, 1);
+    }
+    if (counted) {
+        c->master.frames_left--;
+    }
+    
+    if ((c->tx_fifo.count > 0 || fill_ready()) && !last) {
+        master_load(now + ((c->regs.cs_timing >> 16) & 0xFF));
+    } else if (master_cs_hold() || fill_hold || (counted && !last)) {
+        master_go_idle();
+    } else {
+        uint32_t hold = (c->regs.cs_timing >> 8) & 0xFF;
+        c->master.phase = PHASE_HOLD;
+        c->master.phase_end = now + (hold != 0 ? hold : 1);
+    }
+}
+
+// DMA
+static uint8_t *dma_locate(uint32_t addr) {
+    for (uint32_t i = 0; i < dma_num_windows; i++) {
+        if (addr - dma_windows[i].bus_addr < dma_windows[i].size) {
+            return dma_windows[i].host + (addr - dma_windows[i].bus_addr);
+        }
+    }
+    return NULL;
+}
+
+// Little-endian word load as the engine's bus port sees it
+static uint32_t dma_read32(uint32_t addr) {
+    uint32_t word = 0;
+    for (uint32_t i = 4; i > 0; i--) {
+        uint8_t *p = dma_locate(addr + i - 1);
+        word = (word << 8) | ((p != NULL) ? *p : 0xFF);
+    }
+    return word;
+}
+
+// Load the next scatter-gather descriptor: TX address, RX address, length
+static void dma_load_desc(void) {
+    uint32_t tx_addr = dma_read32(c->dma.desc);
+    uint32_t rx_addr = dma_read32(c->dma.desc + 4);
+    uint32_t length = dma_read32(c->dma.desc + 8);
+    
+    c->dma.src = tx_addr;
+    c->dma.dst = rx_addr;
+    c->dma.seg_tx_en = c->dma.tx_en && tx_addr != 0;
+    c->dma.seg_rx_en = c->dma.rx_en && rx_addr != 0;
+    c->dma.tx_left = length;
+    c->dma.rx_left = length;
+    c->dma.desc += SPI_SG_DESC_BYTES;
+    c->dma.desc_left--;
+}
+
+// Keep the TX FIFO topped up and drain every received byte. Like the RTL,
+// a segment drains completely before the next descriptor is loaded.
+static void dma_service(void) {
+    if (!c->dma.busy) {
+        return;
+    }
+    
+    for (;;) {
+        while (c->dma.tx_left > 0 && c->tx_fifo.count < MODEL_FIFO_DEPTH) {
+            uint8_t *src = c->dma.seg_tx_en ? dma_locate(c->dma.src++) : NULL;
+            fifo_push(&c->tx_fifo, (src != NULL) ? *src : 0xFF);
+            c->dma.tx_left--;
+        }
+        
+        while (c->dma.rx_left > 0 && c->rx_fifo.count > 0) {
+            uint8_t data = (uint8_t)fifo_pop(&c->rx_fifo);
+            uint8_t *dst = c->dma.seg_rx_en ? dma_locate(c->dma.dst++) : NULL;
+            if (dst != NULL) {
+                *dst = data;
+            }
+            c->dma.rx_left--;
+        }
+        
+        if (c->dma.rx_left > 0) {
+            return;
+        }
+        
+        if (c->dma.desc_left == 0) {
+            c->dma.busy = false;
+            c->dma.done_flag = true;
+            return;
+        }
+        
+        dma_load_desc();
+    }
+}
+
+// Interrupt causes and line
+static uint32_t irq_cause(void) {
+    uint32_t cause = 0;
+    
+    if (c->regs.irq_done_flag) cause |= IRQ_DONE;
+    if (c->rx_fifo.count >= c->regs.rx_high) cause |= IRQ_RX_HIGH;
+    if (c->regs.irq_error_flag) cause |= IRQ_ERROR;
+    if (c->dma.done_flag) cause |= IRQ_DMA_DONE;
+    if (c->tx_fifo.count <= c->regs.tx_low) cause |= IRQ_TX_LOW;
+    
+    return cause;
+}
+
+static bool irq_line(void) {
+    return (c->regs.control & CTRL_IRQ_EN) && (irq_cause() & c->regs.irq_en & 0x1F);
+}
+
+// Settle everything that reacts to a state change at time now
+static void model_update(void) {
+    dma_service();
+    if (!c->master.busy) {
+        master_idle();
+    }
+    flash_update_cs();
+    
+    bool irq = irq_line();
+    if (irq && !c->irq_prev) {
+        perf_add(&c->perf.irq_cnt, 1);
+    }
+    c->irq_prev = irq;
+}
+
+// Charge an interval in which nothing changes to every controller's counters
+static void model_account(uint64_t cycles) {
+    if (cycles == 0) {
+        return;
+    }
+    
+    model_ctrl_t *saved = c;
+    for (c = &ctrls[0]; c < &ctrls[SPI_MODEL_NUM_CTRL]; c++) {
+        if (c->master.busy) {
+            perf_add(&c->perf.busy, (uint32_t)cycles);
+        } else if (master_cs_hold() || c->tx_fifo.count > 0 || c->regs.start_req ||
+                   c->master.fill_left != 0) {
+            perf_add(&c->perf.idle, (uint32_t)cycles);
+        }
+        if (c->irq_prev) {
+            perf_add(&c->perf.irq_lat, (uint32_t)cycles);
+        }
+    }
+    c = saved;
+}
+
+// Run the model up to time until, ending phases on all controllers in
+// time order
+static void model_run(uint64_t until) {
+    model_ctrl_t *saved = c;
+    
+    for (;;) {
+        model_ctrl_t *next = NULL;
+        for (model_ctrl_t *k = &ctrls[0]; k < &ctrls[SPI_MODEL_NUM_CTRL]; k++) {
+            if (k->master.busy && k->master.phase_end <= until &&
+                (next == NULL || k->master.phase_end < next->master.phase_end)) {
+                next = k;
+            }
+        }
+        if (next == NULL) {
+            break;
+        }
+        
+        model_account(next->master.phase_end - now);
+        now = next->master.phase_end;
+        c = next;
+        master_phase_done();
+        model_update();
+    }
+    
+    c = saved;
+    model_account(until - now);
+    now = until;
+}
+
+// Reflect the current CONTROL/CLK_DIV on a profile or CS_CFG switch
+static void load_device(uint32_t mode, bool pol, uint32_t div) {
+    c->regs.control &= ~(CTRL_MODE0 | CTRL_MODE1 | CTRL_CS_POL);
+    c->regs.control |= (mode & 0x3) << 1;
+    if (pol) {
+        c->regs.control |= CTRL_CS_POL;
+    }
+    c->regs.clk_div = (c->regs.clk_div & CLK_DIV_SAMPLE_MASK) | CLK_DIV_INT(div);
+}
+
+// XIP window read: command and address frame, dummy bytes, then one
+// little-endian data word. There is no line buffer, so every read pays
+// for its own flash command.
+static uint32_t xip_read(uint32_t offset) {
+    if (!(c->regs.xip_ctrl & XIP_CTRL_EN)) {
+        return 0xDEADBEEF;
+    }
+    
+    uint32_t cmd = c->regs.xip_ctrl & 0xFF;
+    uint32_t dummy = (c->regs.xip_ctrl >> 8) & 0xF;
+    bool selected = c == &ctrls[0] && ((c->regs.xip_ctrl >> 12) & 0x3) == SPI_FLASH_CS;
+    uint32_t header = (cmd << 24) | (offset & 0xFFFFFC);
+    uint32_t word = 0;
+    
+    if (selected) {
+        flash_select();
+        for (int i = 3; i >= 0; i--) {
+            flash_exchange((uint8_t)(header >> (i * 8)));
+        }
+        for (uint32_t i = 0; i < dummy; i++) {
+            flash_exchange(0xFF);
+        }
+    }
+    for (uint32_t i = 0; i < 4; i++) {
+        uint32_t byte = selected ? flash_exchange(0xFF) : 0xFF;
+        word |= byte << (i * 8);
+    }
+    if (selected) {
+        flash_deselect();
+    }
+    
+    // The bus stalls until the data frame is in
+    model_run(now + frame_cycles(32, 0) * 2 + frame_cycles(8, 0) * dummy + 2 * (dummy + 2));
+    
+    return word;
+}
+
+// Timer registers on the model clock
+static uint32_t timer_read(uint32_t offset) {
+    switch (offset) {
+        case TIMER_COUNT_LO:
+            timer_hi_snapshot = (uint32_t)(now >> 32);
+            return (uint32_t)now;
+        case TIMER_COUNT_HI:
+            return timer_hi_snapshot;
+        case TIMER_FREQ:
+            return SPI_MODEL_CLK_HZ;
+        default:
+            return 0;
+    }
+}
+
+// Register reads
+static uint32_t reg_read(uint32_t offset) {
+    if (offset >= SPI_FIFO_WIN && offset < SPI_FIFO_WIN + 4 * SPI_FIFO_WIN_WORDS) {
+        offset = SPI_RX_FIFO;  // Every window word pops
+    }
+    if (offset >= SPI_CS_CFG(0) && offset <= SPI_CS_CFG(3)) {
+        return c->regs.cs_cfg[(offset - SPI_CS_CFG(0)) / 4];
+    }
+    if (offset >= SPI_PROFILE(0) && offset < SPI_PROFILE(SPI_NUM_PROFILES)) {
+        return c->regs.profile[(offset - SPI_PROFILE(0)) / 4];
+    }
+    
+    switch (offset) {
+        case SPI_CONTROL:
+            return c->regs.control | (c->regs.start_req ? CTRL_START : 0);
+        case SPI_STATUS: {
+            uint32_t status = 0;
+            if (c->master.busy || c->regs.start_req || c->master.fill_left != 0) {
+                status |= STAT_BUSY;
+            }
+            if (c->tx_fifo.count == MODEL_FIFO_DEPTH) status |= STAT_TX_FULL;
+            if (c->tx_fifo.count == 0) status |= STAT_TX_EMPTY;
+            if (c->rx_fifo.count == MODEL_FIFO_DEPTH) status |= STAT_RX_FULL;
+            if (c->rx_fifo.count == 0) status |= STAT_RX_EMPTY;
+            if (irq_line()) status |= STAT_IRQ_PEND;
+            return status;
+        }
+        case SPI_FILL_DATA:
+            return c->regs.fill_data;
+        case SPI_FILL_COUNT:
+            return c->master.fill_left;
+        case SPI_CRC_CTRL:
+            return c->regs.crc_ctrl;
+        case SPI_CRC_POLY:
+            return c->regs.crc_poly;
+        case SPI_CRC_INIT:
+            return c->regs.crc_init;
+        case SPI_CRC_TX:
+            return c->regs.crc_tx;
+        case SPI_CRC_RX:
+            return c->regs.crc_rx;
+        case SPI_TRACE_CTRL:
+            return c->trace.ctrl | (c->trace.wrapped ? TRACE_CTRL_WRAPPED : 0) |
+                   (c->trace.lost ? TRACE_CTRL_LOST : 0);
+        case SPI_TRACE_STAT:
+            return ((uint32_t)MODEL_TRACE_DEPTH << 16) | c->trace.count;
+        case SPI_TRACE_DATA: {
+            // Stamp word first, the payload read pops the entry
+            if (c->trace.count == 0) {
+                return 0;
+            }
+            spi_trace_entry_t *entry = &c->trace.entries[c->trace.head];
+            if (!c->trace.rd_half) {
+                c->trace.rd_half = true;
+                return entry->stamp;
+            }
+            c->trace.rd_half = false;
+            c->trace.head = (c->trace.head + 1) % MODEL_TRACE_DEPTH;
+            c->trace.count--;
+            return entry->data;
+        }
+        case SPI_TX_DATA:
+            return c->regs.tx_data;
+        case SPI_RX_DATA:
+            return c->regs.rx_data;
+        case SPI_CLK_DIV:
+            return c->regs.clk_div;
+        case SPI_RX_FIFO:
+            // Pop on read; an empty pop is an underrun
+            if (c->rx_fifo.count == 0) {
+                perf_add(&c->perf.underrun, 1);
+            }
+            c->regs.rx_data = fifo_pop(&c->rx_fifo);
+            return c->regs.rx_data;
+        case SPI_IRQ_EN:
+            return c->regs.irq_en;
+        case SPI_VERSION:
+            return MODEL_VERSION;
+        case SPI_IRQ_STAT:
+            return irq_cause();
+        case SPI_FIFO_INFO:
+            return ((uint32_t)MODEL_FIFO_DEPTH << 16) | (c->rx_fifo.count << 8) | c->tx_fifo.count;
+        case SPI_FIFO_THRESH:
+            return FIFO_THRESH(c->regs.tx_low, c->regs.rx_high);
+        case SPI_CS_TIMING:
+            return c->regs.cs_timing;
+        case SPI_AUTO_CS:
+            return c->regs.auto_cs;
+        case SPI_DMA_SRC:
+            return c->dma.src;
+        case SPI_DMA_DST:
+            return c->dma.dst;
+        case SPI_DMA_LEN:
+            return c->dma.len;
+        case SPI_DMA_CTRL:
+            return (c->dma.done_flag ? DMA_DONE : 0) | (c->dma.busy ? DMA_BUSY : 0) |
+                   (c->dma.tx_en ? DMA_TX_EN : 0) | (c->dma.rx_en ? DMA_RX_EN : 0) |
+                   (c->dma.sg ? DMA_SG : 0);
+        case SPI_XIP_CTRL:
+            return c->regs.xip_ctrl;  // XIP reads complete within the access
+        case SPI_PERF_BYTES:
+            return c->perf.bytes;
+        case SPI_PERF_BUSY:
+            return c->perf.busy;
+        case SPI_PERF_IDLE:
+            return c->perf.idle;
+        case SPI_PERF_UNDERRUN:
+            return c->perf.underrun;
+        case SPI_PERF_OVERRUN:
+            return c->perf.overrun;
+        case SPI_PERF_IRQ_CNT:
+            return c->perf.irq_cnt;
+        case SPI_PERF_IRQ_LAT:
+            return c->perf.irq_lat;
+        case SPI_PERF_CTRL:
+            return c->perf.freeze ? PERF_CTRL_FREEZE : 0;
+        default:
+            return 0xDEADBEEF;
+    }
+}
+
+// Register writes
+static void reg_write(uint32_t offset, uint32_t value) {
+    if (offset >= SPI_FIFO_WIN && offset < SPI_FIFO_WIN + 4 * SPI_FIFO_WIN_WORDS) {
+        offset = SPI_TX_FIFO;  // Every window word pushes
+    }
+    if (offset >= SPI_CS_CFG(0) && offset <= SPI_CS_CFG(3)) {
+        c->regs.cs_cfg[(offset - SPI_CS_CFG(0)) / 4] = value & MODEL_CS_CFG_MASK;
+        return;
+    }
+    if (offset >= SPI_PROFILE(0) && offset < SPI_PROFILE(SPI_NUM_PROFILES)) {
+        c->regs.profile[(offset - SPI_PROFILE(0)) / 4] = value & MODEL_PROFILE_MASK;
+        return;
+    }
+    
+    switch (offset) {
+        case SPI_CONTROL: {
+            uint32_t cs_old = master_cs_line();
+            uint32_t cs_new = (value & CTRL_CS_MASK) >> CTRL_CS_SHIFT;
+            uint32_t cfg = c->regs.cs_cfg[cs_new];
+            
+            c->regs.control = value & ~CTRL_START;
+            // Switching to a configured chip select brings its settings
+            if (cs_new != cs_old && (cfg & CS_CFG_EN)) {
+                load_device(cfg & 0x3, (cfg & CS_CFG_POL) != 0, (cfg >> 8) & 0xFF);
+            }
+            if (value & CTRL_START) {
+                c->regs.start_req = true;
+            }
+            break;
+        }
+        case SPI_CMD:
+            if ((value & CMD_PROFILE) && ((value >> CMD_PROFILE_SHIFT) & 0x7) < SPI_NUM_PROFILES) {
+                uint32_t profile = c->regs.profile[(value >> CMD_PROFILE_SHIFT) & 0x7];
+                c->regs.control &= ~(CTRL_CS_MASK | CTRL_FRAME_MASK | CTRL_LANES_MASK);
+                c->regs.control |= CTRL_CS(profile >> 4);
+                c->regs.control |= ((profile >> 8) & 0x3) << CTRL_FRAME_SHIFT;
+                c->regs.control |= ((profile >> 12) & 0x3) << CTRL_LANES_SHIFT;
+                load_device(profile & 0x3, (profile & PROFILE_CS_POL) != 0, profile >> 16);
+            }
+            if (value & CMD_LOAD) {
+                c->regs.tx_data = (value >> CMD_DATA_SHIFT) & 0xFF;
+            }
+            if (value & CMD_START) {
+                c->regs.start_req = true;
+            }
+            break;
+        case SPI_TX_DATA:
+            c->regs.tx_data = value;
+            break;
+        case SPI_FILL_DATA:
+            c->regs.fill_data = value;
+            break;
+        case SPI_CRC_CTRL:
+            c->regs.crc_ctrl = value & (CRC_CTRL_WIDTH(32) | CRC_CTRL_REFIN | CRC_CTRL_RX_EN |
+                                        CRC_CTRL_TX_EN);
+            if (value & CRC_CTRL_CLEAR) {
+                c->regs.crc_tx = c->regs.crc_init;
+                c->regs.crc_rx = c->regs.crc_init;
+            }
+            break;
+        case SPI_CRC_POLY:
+            c->regs.crc_poly = value;
+            break;
+        case SPI_CRC_INIT:
+            c->regs.crc_init = value;
+            break;
+        case SPI_FILL_COUNT:
+            // The DMA engine owns the master while it runs
+            if (!c->dma.busy) {
+                c->master.fill_left = value & FILL_COUNT_MAX;
+            }
+            break;
+        case SPI_CLK_DIV:
+            c->regs.clk_div = value & MODEL_CLK_DIV_MASK;
+            break;
+        case SPI_TX_FIFO:
+            // The DMA engine owns the FIFO ports while it runs
+            if (c->dma.busy) {
+                break;
+            }
+            if (c->tx_fifo.count < MODEL_FIFO_DEPTH) {
+                fifo_push(&c->tx_fifo, value);
+            } else {
+                perf_add(&c->perf.overrun, 1);
+            }
+            break;
+        case SPI_RX_FIFO:
+            (void)reg_read(SPI_RX_FIFO);
+            break;
+        case SPI_IRQ_EN:
+            c->regs.irq_en = value;
+            break;
+        case SPI_FIFO_THRESH:
+            c->regs.tx_low = value & 0xFF;
+            c->regs.rx_high = (value >> 8) & 0xFF;
+            break;
+        case SPI_CS_TIMING:
+            c->regs.cs_timing = value & 0xFFFFFF;
+            break;
+        case SPI_AUTO_CS:
+            c->regs.auto_cs = value & (AUTO_CS_EN | 0xFFFF);
+            break;
+        case SPI_IRQ_STAT:
+            // Write 1 to clear latched causes
+            if (value & IRQ_DONE) c->regs.irq_done_flag = false;
+            if (value & IRQ_ERROR) c->regs.irq_error_flag = false;
+            if (value & IRQ_DMA_DONE) c->dma.done_flag = false;
+            break;
+        case SPI_DMA_SRC:
+            if (!c->dma.busy) c->dma.src = value;
+            break;
+        case SPI_DMA_DST:
+            if (!c->dma.busy) c->dma.dst = value;
+            break;
+        case SPI_DMA_LEN:
+            if (!c->dma.busy) c->dma.len = value;
+            break;
+        case SPI_DMA_CTRL:
+            if (value & DMA_DONE) {
+                c->dma.done_flag = false;
+            }
+            if (!c->dma.busy) {
+                c->dma.tx_en = (value & DMA_TX_EN) != 0;
+                c->dma.rx_en = (value & DMA_RX_EN) != 0;
+                c->dma.sg = (value & DMA_SG) != 0;
+                // DMA is only armed while CTRL_DMA_EN is set
+                if ((value & DMA_START) && (c->regs.control & CTRL_DMA_EN)) {
+                    if (c->dma.sg) {
+                        // SRC holds the list; segments come from descriptors
+                        c->dma.desc = c->dma.src;
+                        c->dma.desc_left = c->dma.len;
+                        c->dma.tx_left = 0;
+                        c->dma.rx_left = 0;
+                    } else {
+                        c->dma.seg_tx_en = c->dma.tx_en;
+                        c->dma.seg_rx_en = c->dma.rx_en;
+                        c->dma.desc_left = 0;
+                        c->dma.tx_left = c->dma.len;
+                        c->dma.rx_left = c->dma.len;
+                    }
+                    c->dma.busy = true;
+                    c->dma.done_flag = false;
+                }
+            }
+            break;
+        case SPI_XIP_CTRL:
+            c->regs.xip_ctrl = value & 0x3FFFF;
+            break;
+        case SPI_TRACE_CTRL:
+            c->trace.ctrl = value & (TRACE_CTRL_EN | TRACE_CTRL_ONESHOT | TRACE_CTRL_EVENTS);
+            if (value & TRACE_CTRL_CLEAR) {
+                // Start from the current CS and (unmodelled) stall state
+                c->trace.head = 0;
+                c->trace.count = 0;
+                c->trace.rd_half = false;
+                c->trace.wrapped = false;
+                c->trace.lost = false;
+                c->trace.start = now;
+                trace_record(SPI_TRACE_CS, TRACE_CTRL_CS, master_cs_lines());
+                trace_record(SPI_TRACE_STALL, TRACE_CTRL_STALL, 0);
+            }
+            break;
+        case SPI_PERF_CTRL:
+            if (value & PERF_CTRL_CLEAR) {
+                memset(&c->perf, 0, sizeof(c->perf));
+            }
+            c->perf.freeze = (value & PERF_CTRL_FREEZE) != 0;
+            break;
+        default:
+            break;  // Other addresses are ignored
+    }
+}
+
+// Start of a bus access: the CPU spends the access cycles on the bus
+static void access_begin(void) {
+    if (!model_ready) {
+        spi_model_reset();
+    }
+    model_run(now + SPI_MODEL_ACCESS_CYCLES);
+}
+
+// End of a bus access: settle the model, then let pending interrupts in
+static void access_end(void) {
+    model_update();
+    
+    for (model_ctrl_t *k = &ctrls[0]; k < &ctrls[SPI_MODEL_NUM_CTRL]; k++) {
+        c = k;
+        if (k->irq_handler != NULL && !in_irq && irq_line()) {
+            in_irq = true;
+            k->irq_handler();
+            in_irq = false;
+        }
+    }
+}
+
+// WFI: run time forward phase by phase until some controller asserts
+// irq_o, then let the interrupt in as after a bus access. Once every
+// master is idle nothing can raise it any more, so the wait ends there
+// rather than hanging the program.
+void spi_bus_wait_irq(void) {
+    model_ctrl_t *saved = c;
+    
+    if (!model_ready) {
+        spi_model_reset();
+    }
+    
+    for (;;) {
+        uint64_t next = UINT64_MAX;
+        bool irq = false;
+        for (c = &ctrls[0]; c < &ctrls[SPI_MODEL_NUM_CTRL]; c++) {
+            irq = irq || irq_line();
+            if (c->master.busy && c->master.phase_end < next) {
+                next = c->master.phase_end;
+            }
+        }
+        c = saved;
+        if (irq || next == UINT64_MAX) {
+            break;
+        }
+        model_run(next);
+    }
+    
+    access_end();
+    c = saved;
+}
+
+// Select the controller whose register window holds addr
+static bool reg_decode(uint32_t addr) {
+    for (uint32_t n = 0; n < SPI_MODEL_NUM_CTRL; n++) {
+        if ((addr & ~0xFFu) == SPI_BUS_BASE(n)) {
+            c = &ctrls[n];
+            return true;
+        }
+    }
+    return false;
+}
+
+// Select the controller whose XIP window holds addr
+static bool xip_decode(uint32_t addr) {
+    if (addr - SPI_XIP_BASE < SPI_XIP_SIZE * SPI_MODEL_NUM_CTRL) {
+        c = &ctrls[(addr - SPI_XIP_BASE) / SPI_XIP_SIZE];
+        return true;
+    }
+    return false;
+}
+
+uint32_t spi_bus_read(uint32_t addr, uint32_t size) {
+    uint32_t shift = (size < 4) ? (addr & 3) * 8 : 0;
+    uint32_t value;
+    
+    access_begin();
+    
+    if (reg_decode(addr)) {
+        value = reg_read(addr & 0xFC);
+    } else if ((addr & ~0xFFFu) == TIMER_BASE_ADDR) {
+        value = timer_read(addr & 0xFFC);
+    } else if (xip_decode(addr)) {
+        value = xip_read((addr - SPI_XIP_BASE) % SPI_XIP_SIZE);
+    } else {
+        fprintf(stderr, "[model] Read from unmapped address 0x%08X\n", (unsigned)addr);
+        value = 0;
+    }
+    
+    access_end();
+    
+    value >>= shift;
+    return (size < 4) ? (value & ((1u << (size * 8)) - 1)) : value;
+}
+
+void spi_bus_write(uint32_t addr, uint32_t size, uint32_t value) {
+    uint32_t shift = (size < 4) ? (addr & 3) * 8 : 0;
+    
+    access_begin();
+    
+    if (reg_decode(addr)) {
+        reg_write(addr & 0xFC, value << shift);
+    } else if ((addr & ~0xFFFu) == TIMER_BASE_ADDR || xip_decode(addr)) {
+        // Timer registers are read-only, XIP writes are ignored
+    } else {
+        fprintf(stderr, "[model] Write to unmapped address 0x%08X\n", (unsigned)addr);
+    }
+    
+    access_end();
+}
+
+void spi_model_reset(void) {
+    for (c = &ctrls[0]; c < &ctrls[SPI_MODEL_NUM_CTRL]; c++) {
+        memset(&c->regs, 0, sizeof(c->regs));
+        memset(&c->master, 0, sizeof(c->master));
+        memset(&c->dma, 0, sizeof(c->dma));
+        memset(&c->perf, 0, sizeof(c->perf));
+        memset(&c->trace, 0, sizeof(c->trace));
+        memset(&c->tx_fifo, 0, sizeof(c->tx_fifo));
+        memset(&c->rx_fifo, 0, sizeof(c->rx_fifo));
+        
+        c->regs.clk_div = 4;
+        c->regs.fill_data = 0xFFFFFFFF;
+        c->regs.crc_ctrl = CRC_CTRL_WIDTH(16);
+        c->regs.crc_poly = 0x1021;
+        c->regs.tx_low = MODEL_FIFO_DEPTH / 2;
+        c->regs.rx_high = MODEL_FIFO_DEPTH / 2;
+        c->regs.xip_ctrl = XIP_CTRL_CMD(FLASH_CMD_FAST_READ) | XIP_CTRL_DUMMY(1);
+        for (int cs = 0; cs < 4; cs++) {
+            c->regs.cs_cfg[cs] = CS_CFG_DIV(4);
+        }
+        for (int n = 0; n < SPI_NUM_PROFILES; n++) {
+            c->regs.profile[n] = PROFILE_DIV(4);
+        }
+        c->irq_prev = false;
+    }
+    c = &ctrls[0];
+    
+    // Memory windows and interrupt handlers stay set across a reset
+    memset(flash.mem, 0xFF, sizeof(flash.mem));
+    flash.selected = false;
+    flash.wel = false;
+    flash.busy_until = 0;
+    
+    now = 0;
+    timer_hi_snapshot = 0;
+    model_ready = true;
+}
+
+uint64_t spi_model_cycles(void) {
+    return now;
+}
+
+uint8_t *spi_model_flash(void) {
+    if (!model_ready) {
+        spi_model_reset();
+    }
+    return flash.mem;
+}
+
+void spi_model_map_memory(uint32_t bus_addr, void *host, uint32_t size) {
+    if (dma_num_windows >= MODEL_DMA_WINDOWS) {
+        fprintf(stderr, "[model] No free DMA window for 0x%08X\n", (unsigned)bus_addr);
+        return;
+    }
+    
+    dma_windows[dma_num_windows].bus_addr = bus_addr;
+    dma_windows[dma_num_windows].host = (uint8_t *)host;
+    dma_windows[dma_num_windows].size = size;
+    dma_num_windows++;
+}
+
+void spi_model_set_irq_handler(uint32_t ctrl, void (*handler)(void)) {
+    if (ctrl < SPI_MODEL_NUM_CTRL) {
+        ctrls[ctrl].irq_handler = handler;
+    }
+}
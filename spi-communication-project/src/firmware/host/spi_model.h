@@ -0,0 +1,46 @@
+// SPI Controller Host Model
+// In-process model of spi_controller behind the SPI_BUS_HOST register
+// backend (see spi_hal.h). Linked with the unmodified driver it lets the
+// firmware run as a native program: registers, FIFOs, loopback, CS
+// windows, performance counters, the DMA and XIP engines and a serial NOR
+// flash on SPI_FLASH_CS of controller 0 are modelled at frame level, with
+// time kept in controller clock cycles. SPI_MODEL_NUM_CTRL controllers
+// answer at SPI_BUS_BASE(0) upwards and share the one clock.
+#ifndef SPI_MODEL_H
+#define SPI_MODEL_H
+
+#include <stdint.h>
+
+// Model clock, reported through TIMER_FREQ
+#define SPI_MODEL_CLK_HZ        50000000u
+
+// Controllers modelled (SPI_NUM_BUSES in spi_driver.h)
+#define SPI_MODEL_NUM_CTRL      2
+
+// Cycles charged for each register access
+#define SPI_MODEL_ACCESS_CYCLES 2
+
+// Flash geometry (erased to 0xFF at reset)
+#define SPI_MODEL_FLASH_SIZE    0x01000000
+#define SPI_MODEL_FLASH_MFR_ID  0xEF
+#define SPI_MODEL_FLASH_DEV_ID  0x40
+#define SPI_MODEL_FLASH_CAP_ID  0x18
+
+// Return every register, FIFO and the flash to their reset state
+void spi_model_reset(void);
+
+// Controller cycles elapsed since reset
+uint64_t spi_model_cycles(void);
+
+// Flash array, for preloading images and checking results
+uint8_t *spi_model_flash(void);
+
+// Make host memory visible to the DMA engine at a bus address. DMA
+// accesses outside every window read 0xFF and drop writes.
+void spi_model_map_memory(uint32_t bus_addr, void *host, uint32_t size);
+
+// Called whenever controller ctrl asserts irq_o between register accesses,
+// the way the CPU would take that interrupt; NULL disconnects it
+void spi_model_set_irq_handler(uint32_t ctrl, void (*handler)(void));
+
+#endif // SPI_MODEL_H
@@ -1,21 +1,131 @@
 // SPI Driver Implementation
 
+#define SPI_DRIVER_IMPL  // Define the functions, not the spi_static.h aliases
 #include "spi_driver.h"
+#include "spi_hal.h"
+#include "timer.h"
 #include <stddef.h>
 
-// Memory-mapped register access macros
-#define SPI_REG(offset) (*((volatile uint32_t *)(SPI_BASE_ADDR + (offset))))
-#define SPI_REG8(offset) (*((volatile uint8_t *)(SPI_BASE_ADDR + (offset))))
+// Register access through the backend selected in spi_hal.h
+#define SPI_READ(bus, offset)          REG_READ32((bus)->base + (offset))
+#define SPI_WRITE(bus, offset, value)  REG_WRITE32((bus)->base + (offset), (value))
+#define SPI_READ8(bus, offset)         REG_READ8((bus)->base + (offset))
+#define SPI_WRITE8(bus, offset, value) REG_WRITE8((bus)->base + (offset), (value))
 
-// Private variables
-static spi_mode_t current_mode = SPI_MODE_0;
-static spi_cs_t current_cs = SPI_CS_0;
-static bool initialized = false;
+// Each controller's state lives in its spi_bus_t (see spi_driver.h).
+// CONTROL, CLK_DIV and AUTO_CS are kept as software shadows: setters derive
+// the new value from the shadow and issue one store instead of a
+// read-modify-write across the bus, and skip the store when nothing
+// changed. Define SPI_SHADOW_READBACK to resync CONTROL from hardware
+// before each update when another bus master may also write it.
+// The master re-arms the AUTO_CS frame count at every new CS window, so
+// repeated transactions of the same size need no register write at all.
 
-// Initialize SPI controller
-void spi_init(spi_mode_t mode, uint8_t clk_div) {
+// Current CONTROL value
+static uint32_t spi_control_get(spi_bus_t *bus) {
+#ifdef SPI_SHADOW_READBACK
+    bus->control_shadow = SPI_READ(bus, SPI_CONTROL) & ~CTRL_START;
+#endif
+    return bus->control_shadow;
+}
+
+// Update CONTROL, skipping the bus write when nothing changed
+static void spi_control_set(spi_bus_t *bus, uint32_t control) {
+    if (control != bus->control_shadow) {
+        bus->control_shadow = control;
+        SPI_WRITE(bus, SPI_CONTROL, control);
+    }
+}
+
+// Update AUTO_CS, skipping the bus write when nothing changed
+static void spi_auto_cs_set(spi_bus_t *bus, uint32_t auto_cs) {
+    if (auto_cs != bus->auto_cs_shadow) {
+        bus->auto_cs_shadow = auto_cs;
+        SPI_WRITE(bus, SPI_AUTO_CS, auto_cs);
+    }
+}
+
+// Controller cycles one frame takes to shift at the current width, lanes
+// and divider (CS timing and the fractional divider left out)
+static uint32_t spi_frame_cycles(spi_bus_t *bus) {
+    uint32_t lanes = (bus->control_shadow & CTRL_LANES_MASK) >> CTRL_LANES_SHIFT;
+    uint32_t beats = (bus->frame_bytes * 8) >> ((lanes >= 2) ? 2 : lanes);
+    
+    if (bus->clk_div_shadow & CLK_DIV_FAST) {
+        return beats;
+    }
+    return beats * 2 * CLK_DIV_INT(bus->clk_div_shadow);
+}
+
+// Sleep until irq_o raises cause, with only that cause armed, then put the
+// interrupt setup back. Callers acknowledge a latched cause before their
+// last check of the condition, so an event landing after that check keeps
+// irq_o up and the sleep falls straight through. Other interrupts wake the
+// core too; callers recheck and sleep again.
+static void spi_sleep_on(spi_bus_t *bus, uint32_t cause) {
+    uint32_t irq_en = SPI_READ(bus, SPI_IRQ_EN);
+    uint32_t control = spi_control_get(bus);
+    
+    SPI_WRITE(bus, SPI_IRQ_EN, cause);
+    spi_control_set(bus, control | CTRL_IRQ_EN);
+    CPU_WAIT_IRQ();
+    spi_control_set(bus, control);
+    SPI_WRITE(bus, SPI_IRQ_EN, irq_en);
+}
+
+// Master idle with the TX FIFO drained, the condition that latches IRQ_DONE
+static inline bool spi_status_done(uint32_t status) {
+    return (status & (STAT_BUSY | STAT_TX_EMPTY)) == STAT_TX_EMPTY;
+}
+
+// Wait for the master to finish everything queued, for at most timeout_ms
+// (0 waits forever). With spi_set_wfi() the core sleeps on IRQ_DONE while
+// the frames still queued need SPI_WFI_MIN_CYCLES or more; a single frame
+// at a fast SCK or the tail of a burst is polled, so back-to-back
+// transfers see the end as early as before.
+static spi_error_t spi_wait_done(spi_bus_t *bus, uint32_t timeout_ms) {
+    uint64_t deadline = (timeout_ms > 0) ? timer_deadline_ms(timeout_ms) : 0;
+    
+    while (!spi_status_done(SPI_READ(bus, SPI_STATUS))) {
+        if (timeout_ms > 0 && timer_expired(deadline)) {
+            return SPI_ERROR_TIMEOUT;
+        }
+        
+        if (bus->wfi) {
+            uint32_t frames = FIFO_INFO_TX_LEVEL(SPI_READ(bus, SPI_FIFO_INFO)) + 1;
+            if (frames * spi_frame_cycles(bus) >= SPI_WFI_MIN_CYCLES) {
+                SPI_WRITE(bus, SPI_IRQ_STAT, IRQ_DONE);
+                if (!spi_status_done(SPI_READ(bus, SPI_STATUS))) {
+                    spi_sleep_on(bus, IRQ_DONE);
+                }
+            }
+        }
+    }
+    
+    return SPI_OK;
+}
+
+// Initialize the controller at base (SPI_BUS_BASE(n)) and bind it to bus,
+// with chip select 0 selected
+void spi_init(spi_bus_t *bus, uint32_t base, spi_mode_t mode, uint8_t clk_div) {
     uint32_t control = 0;
     
+    bus->base = base;
+    bus->cs = SPI_CS_0;
+    bus->async.active = false;
+    bus->dma_cs_window = false;
+    bus->dma_frames = 0;
+    bus->wfi = false;
+
+#ifdef SPI_STATIC_CONFIG
+    // The build fixes mode, divider and chip select (spi_static.h)
+    (void)mode;
+    (void)clk_div;
+    mode = (spi_mode_t)SPI_STATIC_MODE;
+    clk_div = SPI_STATIC_CLK_DIV;
+    bus->cs = (spi_cs_t)SPI_STATIC_CS;
+    control = SPI_STATIC_CONTROL;
+#else
     // Set mode bits
     switch (mode) {
         case SPI_MODE_0:
@@ -38,48 +148,78 @@ void spi_init(spi_mode_t mode, uint8_t clk_div) {
     }
     
     // Set chip select
-    control |= (current_cs == SPI_CS_0) ? CTRL_CS0 :
-               (current_cs == SPI_CS_1) ? CTRL_CS1 : 0;
+    control |= CTRL_CS(bus->cs);
+#endif
     
     // Write control register
-    SPI_REG(SPI_CONTROL) = control;
+    SPI_WRITE(bus, SPI_CONTROL, control);
+    bus->control_shadow = control;
     
     // Set clock divider
-    SPI_REG(SPI_CLK_DIV) = clk_div;
+    if (clk_div < 1) {
+        clk_div = 1;
+    }
+    SPI_WRITE(bus, SPI_CLK_DIV, clk_div);
+    
+    // CS follows the FIFO, no extra setup/hold/gap cycles
+    SPI_WRITE(bus, SPI_AUTO_CS, 0);
+    SPI_WRITE(bus, SPI_CS_TIMING, 0);
+    bus->auto_cs_shadow = 0;
+    
+    // Reads clock out all ones
+    SPI_WRITE(bus, SPI_FILL_DATA, 0xFFFFFFFF);
+    
+    // CRC unit off
+    SPI_WRITE(bus, SPI_CRC_CTRL, 0);
+    bus->crc_ctrl = 0;
+    
+    // No stored per-device configuration
+    for (int cs = SPI_CS_0; cs <= SPI_CS_3; cs++) {
+        SPI_WRITE(bus, SPI_CS_CFG(cs), 0);
+        bus->cs_config[cs] = 0;
+    }
+    bus->profile_valid = 0;
     
     // Clear status
-    SPI_REG(SPI_STATUS) = 0;
+    SPI_WRITE(bus, SPI_STATUS, 0);
+    
+    // Size bursts to the FIFOs this controller was built with
+    uint32_t depth = FIFO_INFO_DEPTH(SPI_READ(bus, SPI_FIFO_INFO));
+    bus->fifo_depth = (depth > 0 && depth < 256) ? depth : SPI_FIFO_DEPTH;
     
-    current_mode = mode;
-    initialized = true;
+    bus->mode = mode;
+    bus->clk_div_shadow = clk_div;
+    bus->frame_bytes = 1;
+    bus->initialized = true;
 }
 
 // Deinitialize SPI controller
-spi_error_t spi_deinit(void) {
-    if (!initialized) {
+spi_error_t spi_deinit(spi_bus_t *bus) {
+    if (!bus->initialized) {
         return SPI_OK;
     }
     
     // Reset control register
-    SPI_REG(SPI_CONTROL) = 0;
+    SPI_WRITE(bus, SPI_CONTROL, 0);
+    bus->control_shadow = 0;
     
     // Clear FIFOs (if any)
-    while (!spi_is_rx_fifo_empty()) {
+    while (!spi_is_rx_fifo_empty(bus)) {
         uint8_t dummy;
-        spi_fifo_read(&dummy);
+        spi_fifo_read(bus, &dummy);
     }
     
-    initialized = false;
+    bus->initialized = false;
     return SPI_OK;
 }
 
 // Set SPI mode
-spi_error_t spi_set_mode(spi_mode_t mode) {
-    if (!initialized) {
+spi_error_t spi_set_mode(spi_bus_t *bus, spi_mode_t mode) {
+    if (!bus->initialized) {
         return SPI_ERROR_INVALID_MODE;
     }
     
-    uint32_t control = SPI_REG(SPI_CONTROL);
+    uint32_t control = spi_control_get(bus);
     
     // Clear mode bits
     control &= ~(CTRL_MODE0 | CTRL_MODE1);
@@ -102,402 +242,1677 @@ spi_error_t spi_set_mode(spi_mode_t mode) {
             return SPI_ERROR_INVALID_MODE;
     }
     
-    SPI_REG(SPI_CONTROL) = control;
-    current_mode = mode;
+    spi_control_set(bus, control);
+    bus->mode = mode;
     
     return SPI_OK;
 }
 
-// Set clock divider
-spi_error_t spi_set_clock_divider(uint8_t divider) {
-    if (!initialized) {
+// Update CLK_DIV, keeping the sample delay and skipping the bus write when
+// nothing changed
+static void spi_clk_div_set(spi_bus_t *bus, uint32_t clk_div) {
+    clk_div = (clk_div & ~CLK_DIV_SAMPLE_MASK) | (bus->clk_div_shadow & CLK_DIV_SAMPLE_MASK);
+    if (clk_div != bus->clk_div_shadow) {
+        bus->clk_div_shadow = clk_div;
+        SPI_WRITE(bus, SPI_CLK_DIV, clk_div);
+    }
+}
+
+// Set clock divider. SCK runs at the controller clock / (2 * divider).
+spi_error_t spi_set_clock_divider(spi_bus_t *bus, uint8_t divider) {
+    if (!bus->initialized) {
         return SPI_ERROR_INVALID_MODE;
     }
     
-    if (divider < 2) {
-        divider = 2;  // Minimum divider
+    if (divider < 1) {
+        divider = 1;  // Minimum divider
     }
     
-    SPI_REG(SPI_CLK_DIV) = divider;
+    spi_clk_div_set(bus, CLK_DIV_INT(divider));
     return SPI_OK;
 }
 
-// Set chip select polarity
-spi_error_t spi_set_cs_polarity(bool active_high) {
-    if (!initialized) {
+// Set the SCK rate in Hz, the closest rate not above the request. Rates
+// at or above the controller clock use the full-rate SCK; below that the
+// divider gets a fractional part, so SCK is no longer limited to even
+// divisions of the clock (individual half periods dither by one cycle).
+spi_error_t spi_set_sck_freq(spi_bus_t *bus, uint32_t hz) {
+    if (!bus->initialized || hz == 0) {
         return SPI_ERROR_INVALID_MODE;
     }
     
-    uint32_t control = SPI_REG(SPI_CONTROL);
+    uint32_t clk_hz = timer_get_freq();
+    if (hz >= clk_hz) {
+        spi_clk_div_set(bus, CLK_DIV_FAST | CLK_DIV_INT(1));
+        return SPI_OK;
+    }
     
-    if (active_high) {
-        control |= CTRL_CS_POL;
-    } else {
-        control &= ~CTRL_CS_POL;
+    // Half period in 1/256 clock cycles, rounded up
+    uint64_t half = (((uint64_t)clk_hz << 7) + hz - 1) / hz;
+    if (half < 0x100) {
+        half = 0x100;       // Divide by 1
+    } else if (half > 0xFFFF) {
+        half = 0xFFFF;      // Slowest rate
     }
     
-    SPI_REG(SPI_CONTROL) = control;
+    spi_clk_div_set(bus, CLK_DIV_INT(half >> 8) | CLK_DIV_FRAC(half));
     return SPI_OK;
 }
 
-// Enable/disable loopback mode
-spi_error_t spi_enable_loopback(bool enable) {
-    if (!initialized) {
-        return SPI_ERROR_INVALID_MODE;
-    }
-    
-    uint32_t control = SPI_REG(SPI_CONTROL);
+// Get the SCK rate in Hz
+uint32_t spi_get_sck_freq(spi_bus_t *bus) {
+    uint32_t clk_hz = timer_get_freq();
     
-    if (enable) {
-        control |= CTRL_LOOPBACK;
-    } else {
-        control &= ~CTRL_LOOPBACK;
+    if (bus->clk_div_shadow & CLK_DIV_FAST) {
+        return clk_hz;
     }
     
-    SPI_REG(SPI_CONTROL) = control;
-    return SPI_OK;
+    // Half period in 1/256 cycles: DIV is the integer part, FRAC the fraction
+    uint32_t half = ((bus->clk_div_shadow & 0xFF) << 8) | ((bus->clk_div_shadow >> 8) & 0xFF);
+    if (half < 0x100) {
+        return 0;
+    }
+    return (uint32_t)(((uint64_t)clk_hz << 7) / half);
 }
 
-// Select SPI device
-spi_error_t spi_select_device(spi_cs_t cs_line) {
-    if (!initialized) {
+// Delay the receive sample by a number of controller clock cycles, to
+// cover pad and device output delay at high SCK rates. On divided clocks
+// the delay must stay below the divider (the controller clamps it).
+spi_error_t spi_set_sample_delay(spi_bus_t *bus, uint8_t cycles) {
+    if (!bus->initialized) {
         return SPI_ERROR_INVALID_MODE;
     }
     
-    uint32_t control = SPI_REG(SPI_CONTROL);
-    
-    // Clear CS bits
-    control &= ~(CTRL_CS0 | CTRL_CS1);
-    
-    // Set new CS
-    switch (cs_line) {
-        case SPI_CS_0:
-            control |= CTRL_CS0;
-            break;
-        case SPI_CS_1:
-            control |= CTRL_CS1;
-            break;
-        case SPI_CS_2:
-            // For CS2 and CS3, need to extend the register if supported
-            // For now, treat as CS0
-            control |= CTRL_CS0;
-            break;
-        case SPI_CS_3:
-            control |= CTRL_CS1;
-            break;
-        default:
-            return SPI_ERROR_INVALID_MODE;
+    if (cycles > CLK_DIV_SAMPLE_MAX) {
+        return SPI_ERROR_INVALID_MODE;
     }
     
-    SPI_REG(SPI_CONTROL) = control;
-    current_cs = cs_line;
-    
+    uint32_t clk_div = (bus->clk_div_shadow & ~CLK_DIV_SAMPLE_MASK) | CLK_DIV_SAMPLE(cycles);
+    if (clk_div != bus->clk_div_shadow) {
+        bus->clk_div_shadow = clk_div;
+        SPI_WRITE(bus, SPI_CLK_DIV, clk_div);
+    }
     return SPI_OK;
 }
 
-// Deselect SPI device
-spi_error_t spi_deselect_device(spi_cs_t cs_line) {
-    if (!initialized) {
+// Set the frame sent while reading (NULL TX buffers), right-aligned like a
+// TX FIFO entry
+spi_error_t spi_set_tx_fill(spi_bus_t *bus, uint32_t frame) {
+    if (!bus->initialized) {
         return SPI_ERROR_INVALID_MODE;
     }
     
-    uint32_t control = SPI_REG(SPI_CONTROL);
+    SPI_WRITE(bus, SPI_FILL_DATA, frame);
+    return SPI_OK;
+}
+
+// Set frame size
+spi_error_t spi_set_frame_size(spi_bus_t *bus, spi_frame_size_t size) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
     
-    // Clear the specific CS bit
-    switch (cs_line) {
-        case SPI_CS_0:
-            control &= ~CTRL_CS0;
-            break;
-        case SPI_CS_1:
-            control &= ~CTRL_CS1;
-            break;
-        default:
-            // For CS2 and CS3, just clear all for now
-            control &= ~(CTRL_CS0 | CTRL_CS1);
-            break;
+    if (size > SPI_FRAME_32) {
+        return SPI_ERROR_INVALID_MODE;
     }
     
-    SPI_REG(SPI_CONTROL) = control;
+    uint32_t control = spi_control_get(bus);
+    control &= ~CTRL_FRAME_MASK;
+    control |= (uint32_t)size << CTRL_FRAME_SHIFT;
+    spi_control_set(bus, control);
     
+    bus->frame_bytes = (uint32_t)size + 1;
     return SPI_OK;
 }
 
-// Single byte transfer (non-blocking)
-spi_error_t spi_transfer(uint8_t tx_data, uint8_t *rx_data) {
-    if (!initialized) {
+// Get frame size
+spi_frame_size_t spi_get_frame_size(spi_bus_t *bus) {
+    return (spi_frame_size_t)(bus->frame_bytes - 1);
+}
+
+// Set the number of data lanes. Dual and quad frames are half duplex:
+// input selects whether the master samples the lanes or drives them.
+spi_error_t spi_set_lanes(spi_bus_t *bus, spi_lanes_t lanes, bool input) {
+    if (!bus->initialized) {
         return SPI_ERROR_INVALID_MODE;
     }
     
-    if (spi_is_busy()) {
-        return SPI_ERROR_BUSY;
+    if (lanes > SPI_LANES_QUAD) {
+        return SPI_ERROR_INVALID_MODE;
     }
     
-    // Write transmit data
-    SPI_REG8(SPI_TX_DATA) = tx_data;
-    
-    // Start transfer
-    uint32_t control = SPI_REG(SPI_CONTROL);
-    control |= CTRL_START;
-    SPI_REG(SPI_CONTROL) = control;
-    
-    // If rx_data pointer is provided, wait for completion and read
-    if (rx_data != NULL) {
-        // Wait for transfer to complete
-        while (spi_is_busy()) {
-            // Busy wait
-        }
-        
-        // Check for errors
-        if (spi_has_error()) {
-            return SPI_ERROR_TIMEOUT;
-        }
-        
-        // Read received data
-        *rx_data = SPI_REG8(SPI_RX_DATA);
+    uint32_t control = spi_control_get(bus);
+    control &= ~(CTRL_LANES_MASK | CTRL_LANE_IN);
+    control |= (uint32_t)lanes << CTRL_LANES_SHIFT;
+    if (input && lanes != SPI_LANES_SINGLE) {
+        control |= CTRL_LANE_IN;
     }
+    spi_control_set(bus, control);
     
     return SPI_OK;
 }
 
-// Single byte transfer (blocking with timeout)
-spi_error_t spi_transfer_blocking(uint8_t tx_data, uint8_t *rx_data, uint32_t timeout_ms) {
-    if (!initialized) {
+// Get the active SPI mode
+spi_mode_t spi_get_mode(spi_bus_t *bus) {
+    return bus->mode;
+}
+
+// Get the active clock divider (0 while SCK runs at a fractional or the
+// full clock rate, which no integer divider describes)
+uint8_t spi_get_clock_divider(spi_bus_t *bus) {
+    if (bus->clk_div_shadow & (CLK_DIV_FAST | CLK_DIV_FRAC(0xFF))) {
+        return 0;
+    }
+    return (uint8_t)bus->clk_div_shadow;
+}
+
+// Set chip select polarity
+spi_error_t spi_set_cs_polarity(spi_bus_t *bus, bool active_high) {
+    if (!bus->initialized) {
         return SPI_ERROR_INVALID_MODE;
     }
     
-    spi_error_t error = spi_transfer(tx_data, NULL);
-    if (error != SPI_OK) {
-        return error;
-    }
+    uint32_t control = spi_control_get(bus);
     
-    // Wait with timeout
-    uint32_t start_time = 0;  // Would need a timer implementation
-    while (spi_is_busy()) {
-        // Check timeout
-        if (timeout_ms > 0) {
-            // Implement timeout checking with system timer
-            // For now, just busy wait
-        }
+    if (active_high) {
+        control |= CTRL_CS_POL;
+    } else {
+        control &= ~CTRL_CS_POL;
     }
     
-    // Check for errors
-    if (spi_has_error()) {
-        return SPI_ERROR_TIMEOUT;
+    spi_control_set(bus, control);
+    return SPI_OK;
+}
+
+// Enable/disable loopback mode
+spi_error_t spi_enable_loopback(spi_bus_t *bus, bool enable) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
     }
     
-    // Read received data
-    if (rx_data != NULL) {
-        *rx_data = SPI_REG8(SPI_RX_DATA);
+    uint32_t control = spi_control_get(bus);
+    
+    if (enable) {
+        control |= CTRL_LOOPBACK;
+    } else {
+        control &= ~CTRL_LOOPBACK;
     }
     
+    spi_control_set(bus, control);
     return SPI_OK;
 }
 
-// Write multiple bytes
-spi_error_t spi_write_bytes(const uint8_t *data, uint32_t length) {
-    if (!initialized) {
+// Select SPI device. Switching to a line with a stored configuration
+// also brings its mode, CS polarity and divider, in the same write.
+spi_error_t spi_select_device(spi_bus_t *bus, spi_cs_t cs_line) {
+    if (!bus->initialized) {
         return SPI_ERROR_INVALID_MODE;
     }
     
-    if (data == NULL) {
-        return SPI_OK;  // Nothing to do
+    if (cs_line > SPI_CS_3) {
+        return SPI_ERROR_INVALID_MODE;
     }
     
-    for (uint32_t i = 0; i < length; i++) {
-        spi_error_t error = spi_transfer(data[i], NULL);
-        if (error != SPI_OK) {
-            return error;
+    uint32_t control = spi_control_get(bus);
+    control &= ~CTRL_CS_MASK;
+    control |= CTRL_CS(cs_line);
+    
+    // Mirror what the controller loads from CS_CFGn on the switch
+    uint32_t cfg = bus->cs_config[cs_line];
+    if (cs_line != bus->cs && (cfg & CS_CFG_EN)) {
+        control &= ~(CTRL_MODE0 | CTRL_MODE1 | CTRL_CS_POL);
+        control |= (cfg & 0x3) << 1;
+        if (cfg & CS_CFG_POL) {
+            control |= CTRL_CS_POL;
         }
+        bus->mode = (spi_mode_t)(cfg & 0x3);
+        bus->clk_div_shadow = (bus->clk_div_shadow & CLK_DIV_SAMPLE_MASK) | CLK_DIV_INT(cfg >> 8);
     }
     
+    spi_control_set(bus, control);
+    bus->cs = cs_line;
+    
     return SPI_OK;
 }
 
-// Read multiple bytes
-spi_error_t spi_read_bytes(uint8_t *buffer, uint32_t length) {
-    if (!initialized) {
+// Deselect SPI device. CS is only driven during transfers, so this just
+// releases a CS held asserted on that line.
+spi_error_t spi_deselect_device(spi_bus_t *bus, spi_cs_t cs_line) {
+    if (!bus->initialized) {
         return SPI_ERROR_INVALID_MODE;
     }
     
-    if (buffer == NULL) {
-        return SPI_OK;  // Nothing to do
+    if (cs_line > SPI_CS_3) {
+        return SPI_ERROR_INVALID_MODE;
     }
     
-    for (uint32_t i = 0; i < length; i++) {
-        spi_error_t error = spi_transfer(0xFF, &buffer[i]);
-        if (error != SPI_OK) {
-            return error;
-        }
+    if (cs_line == bus->cs) {
+        spi_control_set(bus, spi_control_get(bus) & ~CTRL_CS_HOLD);
     }
     
     return SPI_OK;
 }
 
-// Transfer multiple bytes (bidirectional)
-spi_error_t spi_transfer_bytes(const uint8_t *tx_data, uint8_t *rx_data, uint32_t length) {
-    if (!initialized) {
+// Hold the selected CS asserted while the master is idle, so a command and
+// its data phase can be issued as separate transfers under one CS window
+spi_error_t spi_set_cs_hold(spi_bus_t *bus, bool hold) {
+    if (!bus->initialized) {
         return SPI_ERROR_INVALID_MODE;
     }
     
-    if (tx_data == NULL && rx_data == NULL) {
-        return SPI_OK;  // Nothing to do
-    }
+    uint32_t control = spi_control_get(bus);
     
-    for (uint32_t i = 0; i < length; i++) {
-        uint8_t tx_byte = (tx_data != NULL) ? tx_data[i] : 0xFF;
-        uint8_t rx_byte;
-        
-        spi_error_t error = spi_transfer(tx_byte, &rx_byte);
-        if (error != SPI_OK) {
-            return error;
-        }
-        
-        if (rx_data != NULL) {
-            rx_data[i] = rx_byte;
-        }
+    if (hold) {
+        control |= CTRL_CS_HOLD;
+    } else {
+        control &= ~CTRL_CS_HOLD;
     }
     
+    spi_control_set(bus, control);
     return SPI_OK;
 }
 
-// Write to TX FIFO
-spi_error_t spi_fifo_write(uint8_t data) {
-    if (!initialized) {
+// Program CS setup (assert to first SCK), hold (last frame to deassert)
+// and inter-frame gap times
+spi_error_t spi_set_cs_timing(spi_bus_t *bus, uint8_t setup_cycles, uint8_t hold_cycles,
+                              uint8_t gap_cycles) {
+    if (!bus->initialized) {
         return SPI_ERROR_INVALID_MODE;
     }
     
-    if (spi_is_tx_fifo_full()) {
-        return SPI_ERROR_FIFO_FULL;
-    }
-    
-    SPI_REG8(SPI_TX_FIFO) = data;
+    SPI_WRITE(bus, SPI_CS_TIMING, CS_TIMING(setup_cycles, hold_cycles, gap_cycles));
     return SPI_OK;
 }
 
-// Read from RX FIFO
-spi_error_t spi_fifo_read(uint8_t *data) {
-    if (!initialized) {
+// Hold each CS window open for a fixed number of frames, even if the TX
+// FIFO runs dry in between; the master releases CS after the last one.
+// 0 returns to releasing CS whenever the FIFO drains, and also aborts an
+// open window.
+spi_error_t spi_set_auto_cs(spi_bus_t *bus, uint32_t frames) {
+    if (!bus->initialized) {
         return SPI_ERROR_INVALID_MODE;
     }
     
-    if (spi_is_rx_fifo_empty()) {
-        return SPI_ERROR_FIFO_EMPTY;
+    if (frames > AUTO_CS_MAX_FRAMES) {
+        return SPI_ERROR_INVALID_MODE;
     }
     
-    *data = SPI_REG8(SPI_RX_FIFO);
+    spi_auto_cs_set(bus, (frames != 0) ? (AUTO_CS_EN | AUTO_CS_FRAMES(frames)) : 0);
     return SPI_OK;
 }
 
-// Check if TX FIFO is full
-bool spi_is_tx_fifo_full(void) {
-    return (SPI_REG(SPI_STATUS) & STAT_TX_FULL) != 0;
-}
-
-// Check if TX FIFO is empty
-bool spi_is_tx_fifo_empty(void) {
-    return (SPI_REG(SPI_STATUS) & STAT_TX_EMPTY) != 0;
-}
-
-// Check if RX FIFO is full
-bool spi_is_rx_fifo_full(void) {
-    return (SPI_REG(SPI_STATUS) & STAT_RX_FULL) != 0;
+// Get the auto-CS window length in frames, 0 when CS follows the FIFO
+uint32_t spi_get_auto_cs(spi_bus_t *bus) {
+    return (bus->auto_cs_shadow & AUTO_CS_EN) ? AUTO_CS_FRAMES(bus->auto_cs_shadow) : 0;
 }
 
-// Check if RX FIFO is empty
-bool spi_is_rx_fifo_empty(void) {
-    return (SPI_REG(SPI_STATUS) & STAT_RX_EMPTY) != 0;
+// Get the currently selected device
+spi_cs_t spi_get_selected_device(spi_bus_t *bus) {
+    return bus->cs;
 }
 
-// Check if SPI is busy
-bool spi_is_busy(void) {
-    return (SPI_REG(SPI_STATUS) & STAT_BUSY) != 0;
+// Store a device's mode, clock divider and CS polarity on its chip select
+// line, so spi_select_device() alone switches the bus over to it. The
+// line's CS polarity applies right away; for the selected line the mode
+// and divider are applied now as well.
+spi_error_t spi_set_device_config(spi_bus_t *bus, spi_cs_t cs_line, spi_mode_t mode,
+                                  uint8_t clk_div, bool cs_active_high) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    if (cs_line > SPI_CS_3 || mode > SPI_MODE_3) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    if (clk_div < 1) {
+        clk_div = 1;  // Minimum divider
+    }
+    
+    uint32_t cfg = CS_CFG_EN | CS_CFG_MODE(mode) | CS_CFG_DIV(clk_div);
+    if (cs_active_high) {
+        cfg |= CS_CFG_POL;
+    }
+    SPI_WRITE(bus, SPI_CS_CFG(cs_line), cfg);
+    bus->cs_config[cs_line] = cfg;
+    
+    if (cs_line == bus->cs) {
+        spi_set_mode(bus, mode);
+        spi_set_clock_divider(bus, clk_div);
+        spi_set_cs_polarity(bus, cs_active_high);
+    }
+    
+    return SPI_OK;
 }
 
-// Check if transfer is done
-bool spi_is_done(void) {
-    return (SPI_REG(SPI_STATUS) & STAT_DONE) != 0;
+// Drop a chip select line's stored configuration; the line goes back to
+// following the global mode, divider and CS polarity
+spi_error_t spi_clear_device_config(spi_bus_t *bus, spi_cs_t cs_line) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    if (cs_line > SPI_CS_3) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    SPI_WRITE(bus, SPI_CS_CFG(cs_line), 0);
+    bus->cs_config[cs_line] = 0;
+    
+    return SPI_OK;
 }
 
-// Check for errors
-bool spi_has_error(void) {
-    return (SPI_REG(SPI_STATUS) & STAT_ERROR) != 0;
+// Program a device's profile slot. The device's chip select line also gets
+// the device's mode, divider and polarity (see spi_set_device_config()),
+// so the line idles correctly while other devices are in use.
+spi_error_t spi_device_init(spi_bus_t *bus, const spi_device_t *dev) {
+    if (!bus->initialized || dev == NULL) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    if (dev->profile >= SPI_NUM_PROFILES || dev->cs > SPI_CS_3 ||
+        dev->mode > SPI_MODE_3 || dev->frame_size > SPI_FRAME_32 ||
+        dev->lanes > SPI_LANES_QUAD) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    uint8_t clk_div = (dev->clk_div < 1) ? 1 : dev->clk_div;
+    
+    uint32_t profile = PROFILE_MODE(dev->mode) | PROFILE_CS(dev->cs) |
+                       PROFILE_FRAME(dev->frame_size) | PROFILE_LANES(dev->lanes) |
+                       PROFILE_DIV(clk_div);
+    if (dev->cs_active_high) {
+        profile |= PROFILE_CS_POL;
+    }
+    
+    SPI_WRITE(bus, SPI_PROFILE(dev->profile), profile);
+    bus->profile_cache[dev->profile] = profile;
+    bus->profile_valid |= 1u << dev->profile;
+    
+    return spi_set_device_config(bus, dev->cs, dev->mode, clk_div, dev->cs_active_high);
 }
 
-// Get SPI version
-uint32_t spi_get_version(void) {
-    return SPI_REG(SPI_VERSION);
+// Switch the bus to a device: one CMD write loads its whole profile, and
+// nothing is written when the device's settings are already active
+spi_error_t spi_device_select(spi_bus_t *bus, const spi_device_t *dev) {
+    if (!bus->initialized || dev == NULL) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    if (dev->profile >= SPI_NUM_PROFILES || !(bus->profile_valid & (1u << dev->profile))) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    // Apply the cached profile to the shadows exactly as the controller
+    // applies it to CONTROL and CLK_DIV
+    uint32_t profile = bus->profile_cache[dev->profile];
+    uint32_t control = spi_control_get(bus);
+    control &= ~(CTRL_MODE0 | CTRL_MODE1 | CTRL_CS_POL | CTRL_CS_MASK |
+                 CTRL_FRAME_MASK | CTRL_LANES_MASK);
+    control |= (profile & 0x3) << 1;
+    control |= CTRL_CS(profile >> 4);
+    control |= ((profile >> 8) & 0x3) << CTRL_FRAME_SHIFT;
+    control |= ((profile >> 12) & 0x3) << CTRL_LANES_SHIFT;
+    if (profile & PROFILE_CS_POL) {
+        control |= CTRL_CS_POL;
+    }
+    uint32_t clk_div = (bus->clk_div_shadow & CLK_DIV_SAMPLE_MASK) | CLK_DIV_INT(profile >> 16);
+    
+    if (control != bus->control_shadow || clk_div != bus->clk_div_shadow) {
+        SPI_WRITE(bus, SPI_CMD, CMD_PROFILE | ((uint32_t)dev->profile << CMD_PROFILE_SHIFT));
+        bus->control_shadow = control;
+        bus->clk_div_shadow = clk_div;
+    }
+    
+    bus->mode = (spi_mode_t)(profile & 0x3);
+    bus->cs = (spi_cs_t)((profile >> 4) & 0x3);
+    bus->frame_bytes = ((profile >> 8) & 0x3) + 1;
+    
+    return SPI_OK;
 }
 
-// Enable/disable interrupts
-spi_error_t spi_enable_interrupt(bool enable) {
-    if (!initialized) {
+// Single byte transfer (non-blocking)
+spi_error_t spi_transfer(spi_bus_t *bus, uint8_t tx_data, uint8_t *rx_data) {
+#ifdef SPI_STATIC_CONFIG
+    return spi_static_transfer(bus, tx_data, rx_data);
+#else
+    if (!bus->initialized) {
         return SPI_ERROR_INVALID_MODE;
     }
     
-    uint32_t control = SPI_REG(SPI_CONTROL);
+    if (spi_is_busy(bus)) {
+        return SPI_ERROR_BUSY;
+    }
     
-    if (enable) {
-        control |= CTRL_IRQ_EN;
-    } else {
-        control &= ~CTRL_IRQ_EN;
+    // Load transmit data and start in a single store
+    SPI_WRITE(bus, SPI_CMD, CMD_START | CMD_LOAD | ((uint32_t)tx_data << CMD_DATA_SHIFT));
+    
+    // If rx_data pointer is provided, wait for completion and read
+    if (rx_data != NULL) {
+        (void)spi_wait_done(bus, 0);
+        
+        // Check for errors
+        if (spi_has_error(bus)) {
+            return SPI_ERROR_TIMEOUT;
+        }
+        
+        // Read received data
+        *rx_data = SPI_READ8(bus, SPI_RX_DATA);
     }
     
-    SPI_REG(SPI_CONTROL) = control;
     return SPI_OK;
+#endif
 }
 
-// Clear interrupt
-spi_error_t spi_clear_interrupt(void) {
-    if (!initialized) {
+// Single byte transfer (blocking with timeout)
+spi_error_t spi_transfer_blocking(spi_bus_t *bus, uint8_t tx_data, uint8_t *rx_data,
+                                  uint32_t timeout_ms) {
+    if (!bus->initialized) {
         return SPI_ERROR_INVALID_MODE;
     }
+
+#ifdef SPI_STATIC_CONFIG
+    // Start without the static path's unbounded completion poll
+    SPI_WRITE(bus, SPI_CMD, CMD_START | CMD_LOAD | ((uint32_t)tx_data << CMD_DATA_SHIFT));
+#else
+    spi_error_t error = spi_transfer(bus, tx_data, NULL);
+    if (error != SPI_OK) {
+        return error;
+    }
+#endif
+    
+    // Wait with timeout (0 waits forever)
+    if (spi_wait_done(bus, timeout_ms) != SPI_OK) {
+        return SPI_ERROR_TIMEOUT;
+    }
+    
+    // Check for errors
+    if (spi_has_error(bus)) {
+        return SPI_ERROR_TIMEOUT;
+    }
     
-    // Reading the status register may clear some bits
-    // depending on hardware implementation
-    (void)SPI_REG(SPI_STATUS);
+    // Read received data
+    if (rx_data != NULL) {
+        *rx_data = SPI_READ8(bus, SPI_RX_DATA);
+    }
     
     return SPI_OK;
 }
 
-// Check if interrupt is pending
-bool spi_is_interrupt_pending(void) {
-    return (SPI_REG(SPI_STATUS) & STAT_IRQ_PEND) != 0;
+// Drop stale frames left in the RX FIFO by earlier transfers
+static void spi_flush_rx_fifo(spi_bus_t *bus) {
+    while (!spi_is_rx_fifo_empty(bus)) {
+        (void)SPI_READ(bus, SPI_RX_FIFO);
+    }
 }
 
-// Simple delay functions (would need proper implementation)
-void spi_delay_ms(uint32_t ms) {
-    // Implementation depends on system
-    // For now, just a rough loop
-    for (volatile uint32_t i = 0; i < ms * 1000; i++) {
-        __asm__("nop");
+// Fetch frame i of a transmit buffer. Byte buffers hold nbytes per frame,
+// MSB first; nbytes == 0 marks a buffer of right-aligned uint32_t frames.
+static inline uint32_t spi_frame_get(const uint8_t *buf, uint32_t i, uint32_t nbytes) {
+    if (nbytes == 0) {
+        return ((const uint32_t *)(const void *)buf)[i];
+    }
+    
+    const uint8_t *p = buf + i * nbytes;
+    uint32_t frame = 0;
+    for (uint32_t b = 0; b < nbytes; b++) {
+        frame = (frame << 8) | p[b];
     }
+    return frame;
 }
 
-void spi_delay_us(uint32_t us) {
-    // Implementation depends on system
-    for (volatile uint32_t i = 0; i < us; i++) {
-        __asm__("nop");
+// Store frame i into a receive buffer (same layout as spi_frame_get)
+static inline void spi_frame_put(uint8_t *buf, uint32_t i, uint32_t nbytes, uint32_t frame) {
+    if (nbytes == 0) {
+        ((uint32_t *)(void *)buf)[i] = frame;
+        return;
+    }
+    
+    uint8_t *p = buf + i * nbytes;
+    for (uint32_t b = nbytes; b > 0; b--) {
+        p[b - 1] = (uint8_t)frame;
+        frame >>= 8;
     }
 }
 
-// Example: Read SPI Flash ID
-spi_error_t spi_flash_read_id(uint8_t *manufacturer_id, uint8_t *device_id) {
-    if (!initialized) {
-        return SPI_ERROR_INVALID_MODE;
+// Write-only burst: RX discard keeps received frames out of the RX FIFO,
+// so the TX FIFO is simply kept full and nothing is read back. Returns
+// once the last frame has shifted out.
+static spi_error_t spi_burst_write(spi_bus_t *bus, const uint8_t *tx_data, uint32_t count,
+                                   uint32_t nbytes) {
+    uint32_t control = spi_control_get(bus);
+    spi_error_t error = SPI_OK;
+    uint32_t tx_count = 0;
+    
+    spi_control_set(bus, control | CTRL_RX_DISCARD);
+    
+    while (tx_count < count) {
+        uint32_t level = FIFO_INFO_TX_LEVEL(SPI_READ(bus, SPI_FIFO_INFO));
+        if (level >= bus->fifo_depth) {
+            if (spi_has_error(bus)) {
+                error = SPI_ERROR_TIMEOUT;
+                break;
+            }
+            continue;
+        }
+        
+        for (uint32_t room = bus->fifo_depth - level; room > 0 && tx_count < count; room--) {
+            SPI_WRITE(bus, SPI_TX_FIFO, (tx_data != NULL)
+                                    ? spi_frame_get(tx_data, tx_count, nbytes) : 0xFFFFFFFF);
+            tx_count++;
+        }
     }
     
-    uint8_t cmd = 0x9F;  // Read ID command
-    uint8_t response[3];
-    
-    // Select flash device
-    spi_select_device(SPI_CS_0);
+    // Drained once the FIFO is empty and the master has finished
+    (void)spi_wait_done(bus, 0);
     
-    // Send command and read response
-    spi_transfer(cmd, NULL);
-    spi_read_bytes(response, 3);
+    spi_control_set(bus, control);
+    return error;
+}
+
+// Burst engine: keep up to fifo_depth frames in flight through the
+// TX/RX FIFOs so the master reloads from its TX FIFO in COMPLETE and
+// shifts back-to-back frames without returning to IDLE. Each FIFO access
+// moves a whole frame, so wider frames cut bus accesses per payload byte.
+//
+// Every frame pushed into the TX FIFO eventually lands in the RX FIFO, so
+// limiting the in-flight count to the FIFO depth guarantees the TX FIFO
+// never fills and the RX FIFO never overflows. That lets the fill loop
+// push without re-reading STATUS, and the drain side pops every completed
+// frame reported by one FIFO_INFO read.
+//
+// Reads hand the TX side to the controller: one FILL_COUNT write starts up
+// to FILL_COUNT_MAX fill frames, and the master holds each one back until
+// the RX FIFO has room, so only the drain side costs bus accesses.
+static spi_error_t spi_burst_transfer(spi_bus_t *bus, const uint8_t *tx_data, uint8_t *rx_data,
+                                      uint32_t count, uint32_t nbytes) {
+    uint32_t tx_count = 0;
+    uint32_t rx_count = 0;
+    
+    if (bus->async.active) {
+        return SPI_ERROR_BUSY;
+    }
     
-    // Deselect device
-    spi_deselect_device(SPI_CS_0);
+    if (rx_data == NULL) {
+        return spi_burst_write(bus, tx_data, count, nbytes);
+    }
+    
+    spi_flush_rx_fifo(bus);
+    
+    while (rx_count < count) {
+        if (tx_data == NULL) {
+            // Next fill chunk once the previous one has fully come back
+            if (tx_count == rx_count && tx_count < count) {
+                uint32_t chunk = count - tx_count;
+                if (chunk > FILL_COUNT_MAX) {
+                    chunk = FILL_COUNT_MAX;
+                }
+                SPI_WRITE(bus, SPI_FILL_COUNT, chunk);
+                tx_count += chunk;
+            }
+        } else {
+            // Top up the TX FIFO to the in-flight window
+            while (tx_count < count && (tx_count - rx_count) < bus->fifo_depth) {
+                SPI_WRITE(bus, SPI_TX_FIFO, spi_frame_get(tx_data, tx_count, nbytes));
+                tx_count++;
+            }
+        }
+        
+        // Drain whatever has completed
+        uint32_t ready = FIFO_INFO_RX_LEVEL(SPI_READ(bus, SPI_FIFO_INFO));
+        if (ready == 0) {
+            if (spi_has_error(bus)) {
+                return SPI_ERROR_TIMEOUT;
+            }
+            continue;
+        }
+        
+        for (; ready > 0; ready--) {
+            spi_frame_put(rx_data, rx_count, nbytes, SPI_READ(bus, SPI_RX_FIFO));
+            rx_count++;
+        }
+    }
+    
+    return SPI_OK;
+}
+
+// Push TX frames of the async transfer up to the in-flight window
+static void spi_async_fill(spi_bus_t *bus) {
+    while (bus->async.tx_count < bus->async.length &&
+           (bus->async.tx_count - bus->async.rx_count) < bus->fifo_depth) {
+        SPI_WRITE(bus, SPI_TX_FIFO, (bus->async.tx_data != NULL)
+                                ? spi_frame_get(bus->async.tx_data, bus->async.tx_count,
+                                                bus->async.frame_bytes)
+                                : 0xFFFFFFFF);
+        bus->async.tx_count++;
+    }
+}
+
+// Start an interrupt-driven transfer. The first FIFO load is written here;
+// spi_irq_handler drains RX and refills TX in FIFO-sized chunks on the
+// RX_HIGH watermark, picks up the tail on DONE, and invokes the callback
+// once every byte is in.
+spi_error_t spi_transfer_async(spi_bus_t *bus, const uint8_t *tx_data, uint8_t *rx_data,
+                               uint32_t length, spi_callback_t callback, void *ctx) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    if (bus->async.active || spi_is_busy(bus)) {
+        return SPI_ERROR_BUSY;
+    }
+    
+    if (length % bus->frame_bytes != 0) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    if (length == 0) {
+        if (callback != NULL) {
+            callback(SPI_OK, ctx);
+        }
+        return SPI_OK;
+    }
+    
+    spi_flush_rx_fifo(bus);
+    
+    bus->async.tx_data = tx_data;
+    bus->async.rx_data = rx_data;
+    bus->async.length = length / bus->frame_bytes;
+    bus->async.frame_bytes = bus->frame_bytes;
+    bus->async.tx_count = 0;
+    bus->async.rx_count = 0;
+    bus->async.callback = callback;
+    bus->async.ctx = ctx;
+    bus->async.active = true;
+    
+    // Discard stale events, then arm only the causes the handler services;
+    // the caller's interrupt setup comes back when the transfer finishes
+    uint32_t control = spi_control_get(bus);
+    bus->async.saved_irq_en = SPI_READ(bus, SPI_IRQ_EN);
+    bus->async.saved_irq_on = (control & CTRL_IRQ_EN) != 0;
+    SPI_WRITE(bus, SPI_IRQ_STAT, IRQ_DONE | IRQ_ERROR);
+    SPI_WRITE(bus, SPI_IRQ_EN, IRQ_DONE | IRQ_RX_HIGH | IRQ_ERROR);
+    spi_control_set(bus, control | CTRL_IRQ_EN);
+    
+    spi_async_fill(bus);
+    
+    return SPI_OK;
+}
+
+// Check if an asynchronous transfer is still running
+bool spi_async_is_busy(spi_bus_t *bus) {
+    return bus->async.active;
+}
+
+// Write multiple bytes
+spi_error_t spi_write_bytes(spi_bus_t *bus, const uint8_t *data, uint32_t length) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    if (data == NULL) {
+        return SPI_OK;  // Nothing to do
+    }
+    
+    if (length % bus->frame_bytes != 0) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    return spi_burst_transfer(bus, data, NULL, length / bus->frame_bytes, bus->frame_bytes);
+}
+
+// Read multiple bytes
+spi_error_t spi_read_bytes(spi_bus_t *bus, uint8_t *buffer, uint32_t length) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    if (buffer == NULL) {
+        return SPI_OK;  // Nothing to do
+    }
+    
+    if (length % bus->frame_bytes != 0) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    return spi_burst_transfer(bus, NULL, buffer, length / bus->frame_bytes, bus->frame_bytes);
+}
+
+// Transfer multiple bytes (bidirectional)
+spi_error_t spi_transfer_bytes(spi_bus_t *bus, const uint8_t *tx_data, uint8_t *rx_data,
+                               uint32_t length) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    if (tx_data == NULL && rx_data == NULL) {
+        return SPI_OK;  // Nothing to do
+    }
+    
+    if (length % bus->frame_bytes != 0) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    return spi_burst_transfer(bus, tx_data, rx_data, length / bus->frame_bytes, bus->frame_bytes);
+}
+
+// Transfer right-aligned frames of the configured size, one FIFO access each
+spi_error_t spi_transfer_frames(spi_bus_t *bus, const uint32_t *tx_frames, uint32_t *rx_frames,
+                                uint32_t count) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    if (tx_frames == NULL && rx_frames == NULL) {
+        return SPI_OK;  // Nothing to do
+    }
+    
+    return spi_burst_transfer(bus, (const uint8_t *)tx_frames, (uint8_t *)rx_frames, count, 0);
+}
+
+// Frames in a segment list, or SPI_ERROR_INVALID_MODE in *error when a
+// segment is not a whole number of frames
+static uint32_t spi_sg_frames(spi_bus_t *bus, const spi_sg_t *segs, uint32_t count,
+                              spi_error_t *error) {
+    uint32_t frames = 0;
+    
+    *error = SPI_OK;
+    for (uint32_t i = 0; i < count; i++) {
+        if (segs[i].length % bus->frame_bytes != 0) {
+            *error = SPI_ERROR_INVALID_MODE;
+            return 0;
+        }
+        frames += segs[i].length / bus->frame_bytes;
+    }
+    
+    return frames;
+}
+
+// Burst engine over a segment list: the same in-flight window as
+// spi_burst_transfer(), with separate TX and RX segment cursors so the
+// FIFOs keep streaming across segment boundaries
+static spi_error_t spi_sg_burst(spi_bus_t *bus, const spi_sg_t *segs, uint32_t frames) {
+    uint32_t nbytes = bus->frame_bytes;
+    const spi_sg_t *tx_seg = segs;
+    const spi_sg_t *rx_seg = segs;
+    uint32_t tx_pos = 0;          // Frame within the current segment
+    uint32_t rx_pos = 0;
+    uint32_t tx_count = 0;
+    uint32_t rx_count = 0;
+    
+    spi_flush_rx_fifo(bus);
+    
+    while (rx_count < frames) {
+        while (tx_count < frames && (tx_count - rx_count) < bus->fifo_depth) {
+            // Skip finished (and empty) segments
+            while (tx_pos * nbytes == tx_seg->length) {
+                tx_seg++;
+                tx_pos = 0;
+            }
+            SPI_WRITE(bus, SPI_TX_FIFO, (tx_seg->tx_data != NULL)
+                                    ? spi_frame_get(tx_seg->tx_data, tx_pos, nbytes) : 0xFFFFFFFF);
+            tx_pos++;
+            tx_count++;
+        }
+        
+        uint32_t ready = FIFO_INFO_RX_LEVEL(SPI_READ(bus, SPI_FIFO_INFO));
+        if (ready == 0) {
+            if (spi_has_error(bus)) {
+                return SPI_ERROR_TIMEOUT;
+            }
+            continue;
+        }
+        
+        for (; ready > 0; ready--) {
+            uint32_t frame = SPI_READ(bus, SPI_RX_FIFO);
+            while (rx_pos * nbytes == rx_seg->length) {
+                rx_seg++;
+                rx_pos = 0;
+            }
+            if (rx_seg->rx_data != NULL) {
+                spi_frame_put(rx_seg->rx_data, rx_pos, nbytes, frame);
+            }
+            rx_pos++;
+            rx_count++;
+        }
+    }
+    
+    return SPI_OK;
+}
+
+// Run a segment list as one burst under a single CS assertion: a counted
+// auto-CS window over every segment, or CS_HOLD when that is too long to
+// count. Inside a window the caller already holds, the segments just join
+// it.
+spi_error_t spi_transfer_sg(spi_bus_t *bus, const spi_sg_t *segs, uint32_t count) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    if (bus->async.active) {
+        return SPI_ERROR_BUSY;
+    }
+    
+    spi_error_t error;
+    uint32_t frames = spi_sg_frames(bus, segs, count, &error);
+    if (error != SPI_OK || frames == 0) {
+        return error;
+    }
+    
+    bool held = (spi_control_get(bus) & CTRL_CS_HOLD) != 0;
+    bool hold = !held && frames > AUTO_CS_MAX_FRAMES;
+    uint32_t saved_auto_cs = bus->auto_cs_shadow;
+    
+    if (hold) {
+        spi_auto_cs_set(bus, 0);
+        spi_set_cs_hold(bus, true);
+    } else if (!held) {
+        spi_auto_cs_set(bus, AUTO_CS_EN | AUTO_CS_FRAMES(frames));
+    }
+    
+    error = spi_sg_burst(bus, segs, frames);
+    
+    if (hold) {
+        spi_set_cs_hold(bus, false);
+    } else if (!held && error != SPI_OK) {
+        // Abort the window the failed burst left open
+        spi_auto_cs_set(bus, 0);
+    }
+    spi_auto_cs_set(bus, saved_auto_cs);
+    
+    return error;
+}
+
+// Program the CRC unit and start both CRCs from the algorithm's init value
+spi_error_t spi_crc_enable(spi_bus_t *bus, const spi_crc_t *crc, bool tx, bool rx) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    if (crc->width < 1 || crc->width > 32 || (!tx && !rx)) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    bus->crc = *crc;
+    bus->crc_ctrl = CRC_CTRL_WIDTH(crc->width) | (crc->reflect ? CRC_CTRL_REFIN : 0) |
+                    (tx ? CRC_CTRL_TX_EN : 0) | (rx ? CRC_CTRL_RX_EN : 0);
+    
+    SPI_WRITE(bus, SPI_CRC_POLY, crc->poly);
+    SPI_WRITE(bus, SPI_CRC_INIT, crc->init);
+    SPI_WRITE(bus, SPI_CRC_CTRL, bus->crc_ctrl | CRC_CTRL_CLEAR);
+    return SPI_OK;
+}
+
+// Stop accumulating; the last CRC values stay readable
+spi_error_t spi_crc_disable(spi_bus_t *bus) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    bus->crc_ctrl = 0;
+    SPI_WRITE(bus, SPI_CRC_CTRL, 0);
+    return SPI_OK;
+}
+
+// Restart both CRCs from the init value
+spi_error_t spi_crc_reset(spi_bus_t *bus) {
+    if (!bus->initialized || bus->crc_ctrl == 0) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    SPI_WRITE(bus, SPI_CRC_CTRL, bus->crc_ctrl | CRC_CTRL_CLEAR);
+    return SPI_OK;
+}
+
+// Finish a raw CRC register value: reflect the result, then apply xor_out
+static uint32_t spi_crc_finish(spi_bus_t *bus, uint32_t raw) {
+    uint32_t width = bus->crc.width;
+    uint32_t mask = (width == 32) ? 0xFFFFFFFF : ((1u << width) - 1);
+    uint32_t value = raw;
+    
+    if (bus->crc.reflect) {
+        value = 0;
+        for (uint32_t i = 0; i < width; i++) {
+            value = (value << 1) | ((raw >> i) & 1);
+        }
+    }
+    
+    return (value ^ bus->crc.xor_out) & mask;
+}
+
+// CRC of the frames sent since the last reset
+uint32_t spi_crc_tx(spi_bus_t *bus) {
+    return spi_crc_finish(bus, SPI_READ(bus, SPI_CRC_TX));
+}
+
+// CRC of the frames received since the last reset
+uint32_t spi_crc_rx(spi_bus_t *bus) {
+    return spi_crc_finish(bus, SPI_READ(bus, SPI_CRC_RX));
+}
+
+// CRC as it goes on the wire: (width + 7) / 8 bytes, LSB byte first for
+// reflected algorithms and MSB byte first otherwise
+static uint32_t spi_crc_bytes(spi_bus_t *bus, uint32_t crc, uint8_t *bytes) {
+    uint32_t count = (bus->crc.width + 7u) / 8u;
+    
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t shift = bus->crc.reflect ? 8 * i : 8 * (count - 1 - i);
+        bytes[i] = (uint8_t)(crc >> shift);
+    }
+    return count;
+}
+
+// Write a buffer followed by its CRC
+spi_error_t spi_write_bytes_crc(spi_bus_t *bus, const uint8_t *data, uint32_t length) {
+    if (!(bus->crc_ctrl & CRC_CTRL_TX_EN)) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    uint8_t trailer[4];
+    spi_error_t error = spi_crc_reset(bus);
+    if (error == SPI_OK) {
+        error = spi_write_bytes(bus, data, length);
+    }
+    
+    // The write has shifted out completely, so CRC_TX is final
+    if (error == SPI_OK) {
+        uint32_t count = spi_crc_bytes(bus, spi_crc_tx(bus), trailer);
+        error = spi_write_bytes(bus, trailer, count);
+    }
+    
+    return error;
+}
+
+// Read a buffer and the CRC that follows it, and check one against the other
+spi_error_t spi_read_bytes_crc(spi_bus_t *bus, uint8_t *buffer, uint32_t length) {
+    if (!(bus->crc_ctrl & CRC_CTRL_RX_EN)) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    uint8_t expected[4];
+    uint8_t trailer[4];
+    uint32_t count = 0;
+    spi_error_t error = spi_crc_reset(bus);
+    if (error == SPI_OK) {
+        error = spi_read_bytes(bus, buffer, length);
+    }
+    
+    // Every data frame has been popped, so CRC_RX covers exactly the data
+    if (error == SPI_OK) {
+        count = spi_crc_bytes(bus, spi_crc_rx(bus), expected);
+        error = spi_read_bytes(bus, trailer, count);
+    }
+    
+    for (uint32_t i = 0; error == SPI_OK && i < count; i++) {
+        if (trailer[i] != expected[i]) {
+            error = SPI_ERROR_CRC;
+        }
+    }
+    
+    return error;
+}
+
+// Start a DMA transfer between memory and the SPI FIFOs
+spi_error_t spi_transfer_dma(spi_bus_t *bus, const uint8_t *tx_data, uint8_t *rx_data,
+                             uint32_t length) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    if (spi_dma_is_busy(bus)) {
+        return SPI_ERROR_BUSY;
+    }
+    
+    if (length == 0 || (tx_data == NULL && rx_data == NULL)) {
+        return SPI_OK;  // Nothing to do
+    }
+    
+    // The engine moves one byte per FIFO entry
+    if (bus->frame_bytes != 1) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    // The engine would otherwise store stale frames ahead of ours
+    spi_flush_rx_fifo(bus);
+    
+    // Completion is reported through IRQ_DMA_DONE when enabled in SPI_IRQ_EN
+    uint32_t control = spi_control_get(bus);
+    if (!(control & CTRL_DMA_EN)) {
+        control |= CTRL_DMA_EN;
+        spi_control_set(bus, control);
+    }
+    
+    uint32_t dma_ctrl = DMA_START | DMA_DONE;
+    if (tx_data != NULL) {
+        SPI_WRITE(bus, SPI_DMA_SRC, (uint32_t)(uintptr_t)tx_data);
+        dma_ctrl |= DMA_TX_EN;
+    }
+    if (rx_data != NULL) {
+        SPI_WRITE(bus, SPI_DMA_DST, (uint32_t)(uintptr_t)rx_data);
+        dma_ctrl |= DMA_RX_EN;
+    }
+    SPI_WRITE(bus, SPI_DMA_LEN, length);
+    SPI_WRITE(bus, SPI_DMA_CTRL, dma_ctrl);
+    bus->dma_frames = length;
+    
+    return SPI_OK;
+}
+
+// Hand a segment list to the DMA engine, which walks it as its descriptor
+// list under one auto-CS window; spi_dma_wait() completes it. The list and
+// buffers must stay in place until then. Needs 8-bit frames and a window
+// of at most AUTO_CS_MAX_FRAMES. With pointers wider than 32 bits the list
+// is packed into bus->dma_desc (at most SPI_SG_DMA_MAX_SEGS segments), and
+// the engine walks that copy.
+spi_error_t spi_transfer_sg_dma(spi_bus_t *bus, const spi_sg_t *segs, uint32_t count) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    if (spi_dma_is_busy(bus)) {
+        return SPI_ERROR_BUSY;
+    }
+    
+    if (bus->frame_bytes != 1) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+#ifdef SPI_SG_PACK_DESC
+    if (count > SPI_SG_DMA_MAX_SEGS) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+#else
+    if (sizeof(spi_sg_t) != SPI_SG_DESC_BYTES) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+#endif
+    
+    spi_error_t error;
+    uint32_t frames = spi_sg_frames(bus, segs, count, &error);
+    if (error != SPI_OK || frames == 0) {
+        return error;
+    }
+    
+    if (frames > AUTO_CS_MAX_FRAMES) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    spi_flush_rx_fifo(bus);
+    
+    uint32_t control = spi_control_get(bus);
+    if (!(control & CTRL_DMA_EN)) {
+        control |= CTRL_DMA_EN;
+        spi_control_set(bus, control);
+    }
+    
+    if (!(control & CTRL_CS_HOLD)) {
+        bus->dma_saved_auto_cs = bus->auto_cs_shadow;
+        bus->dma_cs_window = true;
+        spi_auto_cs_set(bus, AUTO_CS_EN | AUTO_CS_FRAMES(frames));
+    }
+    
+    // NULL fields come through as zero addresses, which the engine treats
+    // as send-0xFF / discard
+#ifdef SPI_SG_PACK_DESC
+    for (uint32_t i = 0; i < count; i++) {
+        bus->dma_desc[3 * i] = (uint32_t)(uintptr_t)segs[i].tx_data;
+        bus->dma_desc[3 * i + 1] = (uint32_t)(uintptr_t)segs[i].rx_data;
+        bus->dma_desc[3 * i + 2] = segs[i].length;
+    }
+    SPI_WRITE(bus, SPI_DMA_SRC, (uint32_t)(uintptr_t)bus->dma_desc);
+#else
+    SPI_WRITE(bus, SPI_DMA_SRC, (uint32_t)(uintptr_t)segs);
+#endif
+    SPI_WRITE(bus, SPI_DMA_LEN, count);
+    SPI_WRITE(bus, SPI_DMA_CTRL, DMA_START | DMA_DONE | DMA_TX_EN | DMA_RX_EN | DMA_SG);
+    bus->dma_frames = frames;
+    
+    return SPI_OK;
+}
+
+// Wait for the current DMA transfer to finish and acknowledge it
+spi_error_t spi_dma_wait(spi_bus_t *bus) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    // DMA_DONE was cleared at the start and stays latched until the
+    // acknowledge below, so it cannot slip past the busy check. Short
+    // transfers are polled, as in spi_wait_done().
+    if (bus->wfi && (uint64_t)bus->dma_frames * spi_frame_cycles(bus) >= SPI_WFI_MIN_CYCLES) {
+        while (spi_dma_is_busy(bus)) {
+            spi_sleep_on(bus, IRQ_DMA_DONE);
+        }
+    }
+    
+    while (spi_dma_is_busy(bus)) {
+        // Busy wait
+    }
+    
+    // Clear the sticky done flag (and its interrupt)
+    SPI_WRITE(bus, SPI_DMA_CTRL, DMA_DONE);
+    
+    // The window of an SG transfer has closed on its last frame
+    if (bus->dma_cs_window) {
+        spi_auto_cs_set(bus, bus->dma_saved_auto_cs);
+        bus->dma_cs_window = false;
+    }
+    
+    if (spi_has_error(bus)) {
+        return SPI_ERROR_TIMEOUT;
+    }
+    
+    return SPI_OK;
+}
+
+// Check if a DMA transfer is in progress
+bool spi_dma_is_busy(spi_bus_t *bus) {
+    return (SPI_READ(bus, SPI_DMA_CTRL) & DMA_BUSY) != 0;
+}
+
+// Check if the last DMA transfer has finished and not been acknowledged
+bool spi_dma_is_done(spi_bus_t *bus) {
+    return (SPI_READ(bus, SPI_DMA_CTRL) & DMA_DONE) != 0;
+}
+
+// Map flash into the XIP window. Use 0x03 with no dummy bytes, or 0x0B
+// with one dummy byte for clock rates above the flash READ limit.
+spi_error_t spi_xip_enable(spi_bus_t *bus, spi_cs_t cs, uint8_t read_cmd, uint8_t dummy_bytes,
+                           bool prefetch) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    if (cs > SPI_CS_3 || dummy_bytes > 15) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    // The engine takes over the master, which must be idle
+    if (bus->async.active || spi_dma_is_busy(bus) || spi_is_busy(bus)) {
+        return SPI_ERROR_BUSY;
+    }
+    
+    // The engine issues its own single-lane frames
+    spi_set_lanes(bus, SPI_LANES_SINGLE, false);
+    spi_flush_rx_fifo(bus);
+    
+    uint32_t xip_ctrl = XIP_CTRL_CMD(read_cmd) | XIP_CTRL_DUMMY(dummy_bytes) |
+                        XIP_CTRL_CS(cs) | XIP_CTRL_EN;
+    if (prefetch) {
+        xip_ctrl |= XIP_CTRL_PREFETCH;
+    }
+    SPI_WRITE(bus, SPI_XIP_CTRL, xip_ctrl);
+    
+    return SPI_OK;
+}
+
+// Unmap the XIP window and wait for the engine to release the master
+spi_error_t spi_xip_disable(spi_bus_t *bus) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    SPI_WRITE(bus, SPI_XIP_CTRL, SPI_READ(bus, SPI_XIP_CTRL) & ~(XIP_CTRL_EN | XIP_CTRL_ACTIVE));
+    
+    while (SPI_READ(bus, SPI_XIP_CTRL) & XIP_CTRL_ACTIVE) {
+        // Busy wait for the line fill and CS release
+    }
+    
+    return SPI_OK;
+}
+
+// Write to TX FIFO
+spi_error_t spi_fifo_write(spi_bus_t *bus, uint8_t data) {
+#ifdef SPI_STATIC_CONFIG
+    return spi_static_fifo_write(bus, data);
+#else
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    if (spi_is_tx_fifo_full(bus)) {
+        return SPI_ERROR_FIFO_FULL;
+    }
+    
+    SPI_WRITE8(bus, SPI_TX_FIFO, data);
+    return SPI_OK;
+#endif
+}
+
+// Read from RX FIFO
+spi_error_t spi_fifo_read(spi_bus_t *bus, uint8_t *data) {
+#ifdef SPI_STATIC_CONFIG
+    return spi_static_fifo_read(bus, data);
+#else
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    if (spi_is_rx_fifo_empty(bus)) {
+        return SPI_ERROR_FIFO_EMPTY;
+    }
+    
+    *data = SPI_READ8(bus, SPI_RX_FIFO);
+    return SPI_OK;
+#endif
+}
+
+// Check if TX FIFO is full
+bool spi_is_tx_fifo_full(spi_bus_t *bus) {
+    return (SPI_READ(bus, SPI_STATUS) & STAT_TX_FULL) != 0;
+}
+
+// Check if TX FIFO is empty
+bool spi_is_tx_fifo_empty(spi_bus_t *bus) {
+    return (SPI_READ(bus, SPI_STATUS) & STAT_TX_EMPTY) != 0;
+}
+
+// Check if RX FIFO is full
+bool spi_is_rx_fifo_full(spi_bus_t *bus) {
+    return (SPI_READ(bus, SPI_STATUS) & STAT_RX_FULL) != 0;
+}
+
+// Check if RX FIFO is empty
+bool spi_is_rx_fifo_empty(spi_bus_t *bus) {
+    return (SPI_READ(bus, SPI_STATUS) & STAT_RX_EMPTY) != 0;
+}
+
+// Get the FIFO depth reported by the controller
+uint32_t spi_get_fifo_depth(spi_bus_t *bus) {
+    return bus->fifo_depth;
+}
+
+// Get the current TX/RX FIFO fill levels (one register read)
+void spi_get_fifo_levels(spi_bus_t *bus, uint32_t *tx_level, uint32_t *rx_level) {
+    uint32_t info = SPI_READ(bus, SPI_FIFO_INFO);
+    
+    if (tx_level != NULL) {
+        *tx_level = FIFO_INFO_TX_LEVEL(info);
+    }
+    
+    if (rx_level != NULL) {
+        *rx_level = FIFO_INFO_RX_LEVEL(info);
+    }
+}
+
+// Set the TX-low / RX-high watermarks behind IRQ_TX_LOW and IRQ_RX_HIGH
+spi_error_t spi_set_fifo_thresholds(spi_bus_t *bus, uint8_t tx_low, uint8_t rx_high) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    if (tx_low >= bus->fifo_depth || rx_high == 0 || rx_high > bus->fifo_depth) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    SPI_WRITE(bus, SPI_FIFO_THRESH, FIFO_THRESH(tx_low, rx_high));
+    return SPI_OK;
+}
+
+// Check if SPI is busy
+bool spi_is_busy(spi_bus_t *bus) {
+    return (SPI_READ(bus, SPI_STATUS) & STAT_BUSY) != 0;
+}
+
+// Check if transfer is done
+bool spi_is_done(spi_bus_t *bus) {
+    return (SPI_READ(bus, SPI_STATUS) & STAT_DONE) != 0;
+}
+
+// Check for errors
+bool spi_has_error(spi_bus_t *bus) {
+    return (SPI_READ(bus, SPI_STATUS) & STAT_ERROR) != 0;
+}
+
+// Get SPI version
+uint32_t spi_get_version(spi_bus_t *bus) {
+    return SPI_READ(bus, SPI_VERSION);
+}
+
+// Snapshot the performance counters. They are frozen while being read so
+// the values belong to the same instant.
+spi_error_t spi_get_perf_stats(spi_bus_t *bus, spi_perf_stats_t *stats) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    if (stats == NULL) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    SPI_WRITE(bus, SPI_PERF_CTRL, PERF_CTRL_FREEZE);
+    stats->bytes = SPI_READ(bus, SPI_PERF_BYTES);
+    stats->busy_cycles = SPI_READ(bus, SPI_PERF_BUSY);
+    stats->idle_cycles = SPI_READ(bus, SPI_PERF_IDLE);
+    stats->underruns = SPI_READ(bus, SPI_PERF_UNDERRUN);
+    stats->overruns = SPI_READ(bus, SPI_PERF_OVERRUN);
+    stats->irq_count = SPI_READ(bus, SPI_PERF_IRQ_CNT);
+    stats->irq_latency = SPI_READ(bus, SPI_PERF_IRQ_LAT);
+    SPI_WRITE(bus, SPI_PERF_CTRL, 0);
+    
+    return SPI_OK;
+}
+
+// Zero the performance counters
+spi_error_t spi_reset_perf_stats(spi_bus_t *bus) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    SPI_WRITE(bus, SPI_PERF_CTRL, PERF_CTRL_CLEAR);
+    return SPI_OK;
+}
+
+// Empty the trace buffer and start recording the given events
+spi_error_t spi_trace_start(spi_bus_t *bus, uint32_t events, bool oneshot) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    if (events == 0 || (events & ~TRACE_CTRL_EVENTS) != 0 ||
+        TRACE_STAT_DEPTH(SPI_READ(bus, SPI_TRACE_STAT)) == 0) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    SPI_WRITE(bus, SPI_TRACE_CTRL, events | TRACE_CTRL_EN | TRACE_CTRL_CLEAR |
+                                   (oneshot ? TRACE_CTRL_ONESHOT : 0));
+    return SPI_OK;
+}
+
+// Stop recording; the entries stay in the buffer
+spi_error_t spi_trace_stop(spi_bus_t *bus) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    uint32_t ctrl = SPI_READ(bus, SPI_TRACE_CTRL);
+    SPI_WRITE(bus, SPI_TRACE_CTRL, ctrl & (TRACE_CTRL_EVENTS | TRACE_CTRL_ONESHOT));
+    return SPI_OK;
+}
+
+// Copy up to max_entries trace entries out, oldest first. One status read,
+// then back-to-back TRACE_DATA reads: two per entry.
+spi_error_t spi_trace_dump(spi_bus_t *bus, spi_trace_entry_t *entries, uint32_t max_entries,
+                           uint32_t *count) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    if (entries == NULL || count == NULL) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    uint32_t n = TRACE_STAT_COUNT(SPI_READ(bus, SPI_TRACE_STAT));
+    if (n > max_entries) {
+        n = max_entries;
+    }
+    
+    for (uint32_t i = 0; i < n; i++) {
+        entries[i].stamp = SPI_READ(bus, SPI_TRACE_DATA);
+        entries[i].data = SPI_READ(bus, SPI_TRACE_DATA);
+    }
+    
+    *count = n;
+    return SPI_OK;
+}
+
+// Whether the last trace wrapped or missed events
+uint32_t spi_trace_flags(spi_bus_t *bus) {
+    return SPI_READ(bus, SPI_TRACE_CTRL) & (TRACE_CTRL_WRAPPED | TRACE_CTRL_LOST);
+}
+
+// Let blocking calls sleep the core through their long completion waits
+spi_error_t spi_set_wfi(spi_bus_t *bus, bool enable) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    bus->wfi = enable;
+    return SPI_OK;
+}
+
+// Enable/disable interrupts
+spi_error_t spi_enable_interrupt(spi_bus_t *bus, bool enable) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    uint32_t control = spi_control_get(bus);
+    
+    if (enable) {
+        control |= CTRL_IRQ_EN;
+    } else {
+        control &= ~CTRL_IRQ_EN;
+    }
+    
+    spi_control_set(bus, control);
+    return SPI_OK;
+}
+
+// Choose which causes drive irq_o (CONTROL.IRQ_EN gates them all)
+spi_error_t spi_set_irq_mask(spi_bus_t *bus, uint32_t causes) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    SPI_WRITE(bus, SPI_IRQ_EN, causes);
+    return SPI_OK;
+}
+
+// Get the causes that drive irq_o
+uint32_t spi_get_irq_mask(spi_bus_t *bus) {
+    return SPI_READ(bus, SPI_IRQ_EN);
+}
+
+// Get every active cause, whether it is routed to irq_o or not
+uint32_t spi_get_irq_status(spi_bus_t *bus) {
+    return SPI_READ(bus, SPI_IRQ_STAT);
+}
+
+// Clear interrupt
+spi_error_t spi_clear_interrupt(spi_bus_t *bus) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    // Latched causes are write-1-to-clear
+    SPI_WRITE(bus, SPI_IRQ_STAT, IRQ_DONE | IRQ_ERROR | IRQ_DMA_DONE);
+    
+    return SPI_OK;
+}
+
+// Check if interrupt is pending
+bool spi_is_interrupt_pending(spi_bus_t *bus) {
+    return (SPI_READ(bus, SPI_STATUS) & STAT_IRQ_PEND) != 0;
+}
+
+// Interrupt service routine for irq_o
+void spi_irq_handler(spi_bus_t *bus) {
+    uint32_t cause = SPI_READ(bus, SPI_IRQ_STAT);
+    
+    // Acknowledge latched events before servicing so none are lost
+    SPI_WRITE(bus, SPI_IRQ_STAT, cause & (IRQ_DONE | IRQ_ERROR));
+    
+    if (!bus->async.active) {
+        return;
+    }
+    
+    spi_error_t result = SPI_OK;
+    
+    if (cause & IRQ_ERROR) {
+        result = SPI_ERROR_TIMEOUT;
+    } else {
+        // Drain everything that has completed, then top the TX FIFO back up
+        uint32_t ready = FIFO_INFO_RX_LEVEL(SPI_READ(bus, SPI_FIFO_INFO));
+        for (; ready > 0 && bus->async.rx_count < bus->async.tx_count; ready--) {
+            uint32_t frame = SPI_READ(bus, SPI_RX_FIFO);
+            if (bus->async.rx_data != NULL) {
+                spi_frame_put(bus->async.rx_data, bus->async.rx_count,
+                              bus->async.frame_bytes, frame);
+            }
+            bus->async.rx_count++;
+        }
+        
+        spi_async_fill(bus);
+        
+        if (bus->async.rx_count < bus->async.length) {
+            return;
+        }
+    }
+    
+    // Finished: put the caller's interrupt setup back and report
+    SPI_WRITE(bus, SPI_IRQ_EN, bus->async.saved_irq_en);
+    if (!bus->async.saved_irq_on) {
+        spi_control_set(bus, spi_control_get(bus) & ~CTRL_IRQ_EN);
+    }
+    bus->async.active = false;
+    
+    if (bus->async.callback != NULL) {
+        bus->async.callback(result, bus->async.ctx);
+    }
+}
+
+// Delay functions (timer backed)
+void spi_delay_ms(uint32_t ms) {
+    timer_delay_ms(ms);
+}
+
+void spi_delay_us(uint32_t us) {
+    timer_delay_us(us);
+}
+
+// Bus settings a flash command overrides, restored when it ends
+typedef struct {
+    spi_frame_size_t frame_size;
+    uint32_t control;    // LANES, LANE_IN and CS_HOLD as the caller left them
+    spi_cs_t cs;
+} spi_flash_saved_t;
+
+// Start a flash command: byte frames on one lane, CS held across phases
+static spi_flash_saved_t spi_flash_begin(spi_bus_t *bus) {
+    spi_flash_saved_t saved = {
+        .frame_size = spi_get_frame_size(bus),
+        .control = spi_control_get(bus) & (CTRL_LANES_MASK | CTRL_LANE_IN | CTRL_CS_HOLD),
+        .cs = bus->cs,
+    };
+    
+    spi_select_device(bus, SPI_FLASH_CS);
+    spi_set_frame_size(bus, SPI_FRAME_8);
+    spi_set_lanes(bus, SPI_LANES_SINGLE, false);
+    spi_set_cs_hold(bus, true);
+    
+    return saved;
+}
+
+// End a flash command: release CS, then hand the bus back as it was
+static void spi_flash_end(spi_bus_t *bus, const spi_flash_saved_t *saved) {
+    spi_set_cs_hold(bus, false);
+    spi_set_lanes(bus, (spi_lanes_t)((saved->control & CTRL_LANES_MASK) >> CTRL_LANES_SHIFT),
+                  (saved->control & CTRL_LANE_IN) != 0);
+    spi_set_frame_size(bus, saved->frame_size);
+    spi_select_device(bus, saved->cs);
+    spi_set_cs_hold(bus, (saved->control & CTRL_CS_HOLD) != 0);
+}
+
+// Data phase transfers move the bulk as 32-bit frames and the tail as bytes
+static spi_error_t spi_flash_write_data(spi_bus_t *bus, const uint8_t *data, uint32_t length) {
+    uint32_t bulk = length & ~3u;
+    spi_error_t error = SPI_OK;
+    
+    if (bulk > 0) {
+        spi_set_frame_size(bus, SPI_FRAME_32);
+        error = spi_write_bytes(bus, data, bulk);
+        spi_set_frame_size(bus, SPI_FRAME_8);
+    }
+    
+    if (error == SPI_OK && bulk < length) {
+        error = spi_write_bytes(bus, data + bulk, length - bulk);
+    }
+    
+    return error;
+}
+
+// Read a data phase with the given lanes, moving the bulk as 32-bit frames
+static spi_error_t spi_flash_read_data(spi_bus_t *bus, spi_lanes_t lanes, uint8_t *buffer,
+                                       uint32_t length) {
+    uint32_t bulk = length & ~3u;
+    spi_error_t error = spi_set_lanes(bus, lanes, true);
+    
+    if (error == SPI_OK && bulk > 0) {
+        spi_set_frame_size(bus, SPI_FRAME_32);
+        error = spi_read_bytes(bus, buffer, bulk);
+        spi_set_frame_size(bus, SPI_FRAME_8);
+    }
+    
+    if (error == SPI_OK && bulk < length) {
+        error = spi_read_bytes(bus, buffer + bulk, length - bulk);
+    }
+    
+    return error;
+}
+
+// Build a command byte followed by a 24-bit address
+static void spi_flash_header(uint8_t *header, uint8_t cmd, uint32_t address) {
+    header[0] = cmd;
+    header[1] = (uint8_t)(address >> 16);
+    header[2] = (uint8_t)(address >> 8);
+    header[3] = (uint8_t)address;
+}
+
+// Send a command without address or data (e.g. WREN) in its own CS window
+static spi_error_t spi_flash_simple_command(spi_bus_t *bus, uint8_t cmd) {
+    spi_flash_saved_t saved = spi_flash_begin(bus);
+    spi_error_t error = spi_write_bytes(bus, &cmd, 1);
+    spi_flash_end(bus, &saved);
+    
+    return error;
+}
+
+// Wait for the write-in-progress bit to clear. The flash keeps shifting out
+// its status register while CS stays asserted, so RDSR is sent once and
+// status bytes are then clocked back-to-back until WIP drops or the
+// operation's datasheet maximum has passed.
+static spi_error_t spi_flash_wait_ready(spi_bus_t *bus, uint32_t timeout_ms) {
+    uint8_t cmd = FLASH_CMD_READ_STATUS;
+    uint8_t status = FLASH_STATUS_WIP;
+    uint64_t deadline = timer_deadline_ms(timeout_ms);
+    spi_flash_saved_t saved = spi_flash_begin(bus);
+    spi_error_t error = spi_write_bytes(bus, &cmd, 1);
+    
+    while (error == SPI_OK) {
+        error = spi_read_bytes(bus, &status, 1);
+        if (error != SPI_OK || !(status & FLASH_STATUS_WIP)) {
+            break;
+        }
+        if (timer_expired(deadline)) {
+            error = SPI_ERROR_TIMEOUT;
+        }
+    }
+    
+    spi_flash_end(bus, &saved);
+    return error;
+}
+
+// Example: Read SPI Flash ID
+spi_error_t spi_flash_read_id(spi_bus_t *bus, uint8_t *manufacturer_id, uint8_t *device_id) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    uint8_t cmd = FLASH_CMD_READ_ID;
+    uint8_t response[3];
+    
+    // Command and response share one CS window
+    spi_flash_saved_t saved = spi_flash_begin(bus);
+    spi_error_t error = spi_write_bytes(bus, &cmd, 1);
+    if (error == SPI_OK) {
+        error = spi_read_bytes(bus, response, 3);
+    }
+    spi_flash_end(bus, &saved);
+    
+    if (error != SPI_OK) {
+        return error;
+    }
     
     if (manufacturer_id != NULL) {
         *manufacturer_id = response[0];
@@ -509,3 +1924,195 @@ spi_error_t spi_flash_read_id(uint8_t *manufacturer_id, uint8_t *device_id) {
     
     return SPI_OK;
 }
+
+// Read flash with one FAST READ command and a single streaming burst
+spi_error_t spi_flash_read(spi_bus_t *bus, uint32_t address, uint8_t *buffer, uint32_t length) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    if (buffer == NULL || length == 0) {
+        return SPI_OK;  // Nothing to do
+    }
+    
+    uint8_t header[5];
+    spi_flash_header(header, FLASH_CMD_FAST_READ, address);
+    header[4] = 0xFF;  // 8 dummy clocks
+    
+    spi_flash_saved_t saved = spi_flash_begin(bus);
+    spi_error_t error = spi_write_bytes(bus, header, sizeof(header));
+    if (error == SPI_OK) {
+        error = spi_flash_read_data(bus, SPI_LANES_SINGLE, buffer, length);
+    }
+    spi_flash_end(bus, &saved);
+    
+    return error;
+}
+
+// Multi-I/O flash read. The command is always sent on one lane; 0x3B/0x6B
+// send the address on one lane followed by 8 dummy clocks, 0xEB sends the
+// address and mode byte on four lanes followed by 4 dummy clocks. The data
+// phase streams on two or four lanes under a single CS window. Quad
+// commands require the flash QE bit to be set.
+spi_error_t spi_flash_read_multi(spi_bus_t *bus, spi_flash_read_cmd_t cmd, uint32_t address,
+                                 uint8_t *buffer, uint32_t length) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    if (buffer == NULL || length == 0) {
+        return SPI_OK;  // Nothing to do
+    }
+    
+    if (cmd != SPI_FLASH_READ_DUAL_OUT && cmd != SPI_FLASH_READ_QUAD_OUT &&
+        cmd != SPI_FLASH_READ_QUAD_IO) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    uint8_t header[5];
+    uint8_t dummy[2];
+    spi_lanes_t data_lanes = (cmd == SPI_FLASH_READ_DUAL_OUT) ? SPI_LANES_DUAL : SPI_LANES_QUAD;
+    spi_error_t error;
+    
+    spi_flash_header(header, (uint8_t)cmd, address);
+    header[4] = 0x00;  // 0xEB mode byte (no continuous read) / 8 dummy clocks
+    
+    spi_flash_saved_t saved = spi_flash_begin(bus);
+    
+    if (cmd == SPI_FLASH_READ_QUAD_IO) {
+        // Command on IO0, then address + mode on IO0-IO3, then the four
+        // dummy clocks (one byte per two clocks) with the lanes released
+        error = spi_write_bytes(bus, header, 1);
+        if (error == SPI_OK) {
+            spi_set_lanes(bus, SPI_LANES_QUAD, false);
+            error = spi_write_bytes(bus, &header[1], 4);
+        }
+        if (error == SPI_OK) {
+            spi_set_lanes(bus, SPI_LANES_QUAD, true);
+            error = spi_read_bytes(bus, dummy, 2);
+        }
+    } else {
+        // Command, address and one dummy byte on IO0
+        error = spi_write_bytes(bus, header, sizeof(header));
+    }
+    
+    if (error == SPI_OK) {
+        error = spi_flash_read_data(bus, data_lanes, buffer, length);
+    }
+    
+    spi_flash_end(bus, &saved);
+    return error;
+}
+
+// Program flash. The data is split on page boundaries; each page is one
+// WREN plus a PAGE PROGRAM streamed as a single burst, and the next page
+// is issued as soon as WIP clears.
+spi_error_t spi_flash_write(spi_bus_t *bus, uint32_t address, const uint8_t *data,
+                            uint32_t length) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    if (data == NULL) {
+        return SPI_OK;  // Nothing to do
+    }
+    
+    spi_error_t error = SPI_OK;
+    
+    while (length > 0 && error == SPI_OK) {
+        uint32_t chunk = FLASH_PAGE_SIZE - (address & (FLASH_PAGE_SIZE - 1));
+        if (chunk > length) {
+            chunk = length;
+        }
+        
+        error = spi_flash_simple_command(bus, FLASH_CMD_WRITE_ENABLE);
+        if (error != SPI_OK) {
+            break;
+        }
+        
+        uint8_t header[4];
+        spi_flash_header(header, FLASH_CMD_PAGE_PROGRAM, address);
+        
+        spi_flash_saved_t saved = spi_flash_begin(bus);
+        error = spi_write_bytes(bus, header, sizeof(header));
+        if (error == SPI_OK) {
+            error = spi_flash_write_data(bus, data, chunk);
+        }
+        spi_flash_end(bus, &saved);
+        
+        // Programming starts when CS rises
+        if (error == SPI_OK) {
+            error = spi_flash_wait_ready(bus, FLASH_TIMEOUT_PROGRAM_MS);
+        }
+        
+        address += chunk;
+        data += chunk;
+        length -= chunk;
+    }
+    
+    return error;
+}
+
+// Erase every 4 KB sector overlapping [address, address + length). Each
+// step uses the largest block erase (64 KB, 32 KB, then 4 KB) that is
+// aligned at the current address and fits in the remaining range, since
+// block erases take far less time per byte than sector erases.
+spi_error_t spi_flash_erase(spi_bus_t *bus, uint32_t address, uint32_t length) {
+    if (!bus->initialized) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    if (length == 0) {
+        return SPI_OK;  // Nothing to do
+    }
+    
+    uint32_t start = address & ~(FLASH_SECTOR_SIZE - 1);
+    uint32_t end = (address + length + FLASH_SECTOR_SIZE - 1) & ~(FLASH_SECTOR_SIZE - 1);
+    spi_error_t error = SPI_OK;
+    
+    while (start < end && error == SPI_OK) {
+        uint32_t remaining = end - start;
+        uint32_t size;
+        uint32_t timeout_ms;
+        uint8_t cmd;
+        
+        if ((start & (FLASH_BLOCK_64K - 1)) == 0 && remaining >= FLASH_BLOCK_64K) {
+            size = FLASH_BLOCK_64K;
+            cmd = FLASH_CMD_ERASE_64K;
+            timeout_ms = FLASH_TIMEOUT_ERASE_64K_MS;
+        } else if ((start & (FLASH_BLOCK_32K - 1)) == 0 && remaining >= FLASH_BLOCK_32K) {
+            size = FLASH_BLOCK_32K;
+            cmd = FLASH_CMD_ERASE_32K;
+            timeout_ms = FLASH_TIMEOUT_ERASE_32K_MS;
+        } else {
+            size = FLASH_SECTOR_SIZE;
+            cmd = FLASH_CMD_ERASE_4K;
+            timeout_ms = FLASH_TIMEOUT_ERASE_4K_MS;
+        }
+        
+        error = spi_flash_simple_command(bus, FLASH_CMD_WRITE_ENABLE);
+        if (error != SPI_OK) {
+            break;
+        }
+        
+        uint8_t header[4];
+        spi_flash_header(header, cmd, start);
+        
+        spi_flash_saved_t saved = spi_flash_begin(bus);
+        error = spi_write_bytes(bus, header, sizeof(header));
+        spi_flash_end(bus, &saved);
+        
+        if (error == SPI_OK) {
+            error = spi_flash_wait_ready(bus, timeout_ms);
+        }
+        
+        start += size;
+    }
+    
+    return error;
+}
+
+// Erase the 4 KB sector containing address
+spi_error_t spi_flash_erase_sector(spi_bus_t *bus, uint32_t address) {
+    return spi_flash_erase(bus, address, FLASH_SECTOR_SIZE);
+}
@@ -4,10 +4,24 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "spi_hal.h"
 
-// SPI Base Address
+// SPI Base Address (controller 0)
 #define SPI_BASE_ADDR   0x40000000
 
+// Controllers, matching SPI_NUM_CTRL in top. Controller n decodes its
+// registers at SPI_BUS_BASE(n) and its XIP window at SPI_BUS_XIP_BASE(n).
+#define SPI_NUM_BUSES       2
+#define SPI_BUS_STRIDE      0x00010000
+#define SPI_BUS_BASE(n)     (SPI_BASE_ADDR + (uint32_t)(n) * SPI_BUS_STRIDE)
+#define SPI_BUS_XIP_BASE(n) (SPI_XIP_BASE + (uint32_t)(n) * SPI_XIP_SIZE)
+
+// XIP Flash Window of controller 0 (reads map to flash offsets 0-16 MB)
+#define SPI_XIP_BASE    0x60000000
+#define SPI_XIP_SIZE    0x01000000
+#define SPI_XIP_ADDR(offset) ((const volatile void *)(SPI_XIP_BASE + (offset)))
+#define SPI_XIP_WORD(offset) REG_READ32(SPI_XIP_BASE + (offset))  // Read one window word
+
 // Register Offsets
 #define SPI_CONTROL     0x00
 #define SPI_STATUS      0x04
@@ -18,17 +32,144 @@
 #define SPI_RX_FIFO     0x18
 #define SPI_IRQ_EN      0x1C
 #define SPI_VERSION     0x20
+#define SPI_IRQ_STAT    0x24
+#define SPI_CMD         0x28
+#define SPI_FIFO_INFO   0x2C
+#define SPI_FIFO_THRESH 0x30
+#define SPI_CS_TIMING   0x34
+#define SPI_AUTO_CS     0x38
+#define SPI_DMA_SRC     0x40
+#define SPI_DMA_DST     0x44
+#define SPI_DMA_LEN     0x48
+#define SPI_DMA_CTRL    0x4C
+#define SPI_XIP_CTRL    0x54
+#define SPI_PERF_BYTES      0x60
+#define SPI_PERF_BUSY       0x64
+#define SPI_PERF_IDLE       0x68
+#define SPI_PERF_UNDERRUN   0x6C
+#define SPI_PERF_OVERRUN    0x70
+#define SPI_PERF_IRQ_CNT    0x74
+#define SPI_PERF_IRQ_LAT    0x78
+#define SPI_PERF_CTRL       0x7C
+#define SPI_CS_CFG(cs)      (0x80 + 4 * (cs))  // Per chip select configuration
+#define SPI_PROFILE(n)      (0x90 + 4 * (n))   // Device profiles
+#define SPI_FILL_DATA       0xB0
+#define SPI_FILL_COUNT      0xB4
+#define SPI_CRC_CTRL        0xB8
+#define SPI_CRC_POLY        0xBC
+#define SPI_CRC_INIT        0xC0
+#define SPI_CRC_TX          0xC4
+#define SPI_CRC_RX          0xC8
+#define SPI_TRACE_CTRL      0xCC
+#define SPI_TRACE_STAT      0xD0
+#define SPI_TRACE_DATA      0xD4
+#define SPI_FIFO_WIN        0xE0               // TX/RX FIFO alias for incrementing bursts
+#define SPI_FIFO_WIN_WORDS  8
+
+// Default FIFO depth, used only if FIFO_INFO does not report a valid depth
+#define SPI_FIFO_DEPTH  8
+
+// Device profile slots, matching SPI_NUM_PROFILES in top (at most 8)
+#define SPI_NUM_PROFILES 4
+
+// FIFO Info Register Fields (read-only)
+#define FIFO_INFO_TX_LEVEL(v)   ((v) & 0xFF)
+#define FIFO_INFO_RX_LEVEL(v)   (((v) >> 8) & 0xFF)
+#define FIFO_INFO_DEPTH(v)      (((v) >> 16) & 0xFFFF)
+
+// FIFO Threshold Register Fields
+#define FIFO_THRESH(tx_low, rx_high)  ((uint32_t)(tx_low) | ((uint32_t)(rx_high) << 8))
+
+// CS Timing Register Fields (controller clock cycles)
+#define CS_TIMING(setup, hold, gap)  ((uint32_t)(setup) | ((uint32_t)(hold) << 8) | \
+                                      ((uint32_t)(gap) << 16))
+
+// Auto-CS Register Fields
+#define AUTO_CS_FRAMES(n)   ((uint32_t)(n) & 0xFFFF)
+#define AUTO_CS_EN          (1u << 31)
+#define AUTO_CS_MAX_FRAMES  0xFFFF
+
+// Sleeping completion waits (spi_set_wfi) only sleep when at least this
+// many controller cycles of shifting are left. Shorter waits poll, so they
+// never pay the core's wake-up latency.
+#ifndef SPI_WFI_MIN_CYCLES
+#define SPI_WFI_MIN_CYCLES  256
+#endif
+
+// TX Fill Count Register: frames of FILL_DATA to send after the TX FIFO
+// contents (write to start, read for frames not yet started)
+#define FILL_COUNT_MAX      0xFFFF
+
+// CRC Control Register Fields
+// Completed frames are folded into CRC_TX/CRC_RX in wire order; the
+// registers hold the unreflected CRC, right-aligned in WIDTH bits.
+#define CRC_CTRL_TX_EN      (1 << 0)
+#define CRC_CTRL_RX_EN      (1 << 1)
+#define CRC_CTRL_REFIN      (1 << 2)   // Bytes enter LSB first
+#define CRC_CTRL_CLEAR      (1 << 3)   // Strobe: load CRC_INIT into both
+#define CRC_CTRL_WIDTH(w)   ((((uint32_t)(w) - 1) & 0x1F) << 8)
+
+// Trace Buffer Fields
+// Each entry reads out of TRACE_DATA as two words, stamp then payload;
+// TRACE_STAT reports a depth of 0 when the controller has no trace buffer.
+#define TRACE_CTRL_EN         (1 << 0)
+#define TRACE_CTRL_CLEAR      (1 << 1)   // Strobe: empty the buffer, restart the stamp
+#define TRACE_CTRL_ONESHOT    (1 << 2)   // Stop when full instead of wrapping
+#define TRACE_CTRL_FRAME      (1 << 8)   // Record completed frames
+#define TRACE_CTRL_CS         (1 << 9)   // Record chip select changes
+#define TRACE_CTRL_STALL      (1 << 10)  // Record stall reason changes
+#define TRACE_CTRL_EVENTS     (7 << 8)
+#define TRACE_CTRL_WRAPPED    (1 << 16)  // Read-only: oldest entries overwritten
+#define TRACE_CTRL_LOST       (1 << 17)  // Read-only: events not recorded
+#define TRACE_STAT_COUNT(v)   ((v) & 0xFFFF)
+#define TRACE_STAT_DEPTH(v)   (((v) >> 16) & 0xFFFF)
+
+// Clock Divider Register Fields
+// SCK half period is INT + FRAC/256 controller clock cycles (INT >= 1);
+// FAST runs SCK at the controller clock rate instead.
+#define CLK_DIV_INT(d)        ((uint32_t)(d) & 0xFF)
+#define CLK_DIV_FRAC(f)       (((uint32_t)(f) & 0xFF) << 8)
+#define CLK_DIV_SAMPLE(n)     (((uint32_t)(n) & 0xF) << 16)  // Receive sample delay
+#define CLK_DIV_SAMPLE_MASK   (0xFu << 16)
+#define CLK_DIV_SAMPLE_MAX    15
+#define CLK_DIV_FAST          (1u << 24)
+
+// Per Chip Select Configuration Register Fields
+// With CS_CFG_EN set, selecting the line loads its mode, CS polarity and
+// divider into CONTROL/CLK_DIV, and the line idles at its own polarity.
+#define CS_CFG_MODE(m)      ((uint32_t)(m) & 0x3)
+#define CS_CFG_POL          (1 << 2)
+#define CS_CFG_DIV(d)       (((uint32_t)(d) & 0xFF) << 8)
+#define CS_CFG_EN           (1u << 31)
+
+// Device Profile Register Fields
+// CMD_PROFILE loads a profile's mode, CS polarity, chip select, frame size
+// and lanes into CONTROL and its divider into CLK_DIV in one write.
+#define PROFILE_MODE(m)     ((uint32_t)(m) & 0x3)
+#define PROFILE_CS_POL      (1 << 2)
+#define PROFILE_CS(cs)      (((uint32_t)(cs) & 0x3) << 4)
+#define PROFILE_FRAME(f)    (((uint32_t)(f) & 0x3) << 8)
+#define PROFILE_LANES(l)    (((uint32_t)(l) & 0x3) << 12)
+#define PROFILE_DIV(d)      (((uint32_t)(d) & 0xFF) << 16)
 
 // Control Register Bits
 #define CTRL_START      (1 << 0)
 #define CTRL_MODE0      (1 << 1)
 #define CTRL_MODE1      (2 << 1)
-#define CTRL_CS0        (1 << 3)
-#define CTRL_CS1        (1 << 4)
+#define CTRL_CS_SHIFT   3
+#define CTRL_CS_MASK    (3 << CTRL_CS_SHIFT)
+#define CTRL_CS(cs)     (((uint32_t)(cs) & 0x3) << CTRL_CS_SHIFT)
 #define CTRL_IRQ_EN     (1 << 5)
 #define CTRL_DMA_EN     (1 << 6)
 #define CTRL_LOOPBACK   (1 << 7)
 #define CTRL_CS_POL     (1 << 8)
+#define CTRL_CS_HOLD    (1 << 9)
+#define CTRL_FRAME_SHIFT 10
+#define CTRL_FRAME_MASK (3 << CTRL_FRAME_SHIFT)
+#define CTRL_LANES_SHIFT 12
+#define CTRL_LANES_MASK (3 << CTRL_LANES_SHIFT)
+#define CTRL_LANE_IN    (1 << 14)  // Dual/quad frames sample IO lanes
+#define CTRL_RX_DISCARD (1 << 15)  // Received frames are not stored
 
 // Status Register Bits
 #define STAT_BUSY       (1 << 0)
@@ -40,6 +181,40 @@
 #define STAT_ERROR      (1 << 6)
 #define STAT_IRQ_PEND   (1 << 7)
 
+// Command Register Bits (write-only strobes)
+#define CMD_START       (1 << 0)  // Start a transfer from TX_DATA
+#define CMD_LOAD        (1 << 1)  // Load TX_DATA from the data field first
+#define CMD_PROFILE     (1 << 2)  // Apply a device profile first
+#define CMD_DATA_SHIFT  8
+#define CMD_PROFILE_SHIFT 16
+
+// Interrupt Cause Bits (SPI_IRQ_STAT, masked by SPI_IRQ_EN)
+#define IRQ_DONE        (1 << 0)  // Master idle with TX FIFO empty
+#define IRQ_RX_HIGH     (1 << 1)  // RX level >= RX watermark (level)
+#define IRQ_ERROR       (1 << 2)
+#define IRQ_DMA_DONE    (1 << 3)
+#define IRQ_TX_LOW      (1 << 4)  // TX level <= TX watermark (level)
+
+// DMA Control Register Bits
+#define DMA_START       (1 << 0)
+#define DMA_TX_EN       (1 << 1)
+#define DMA_RX_EN       (1 << 2)
+#define DMA_SG          (1 << 3)   // SRC is a descriptor list, LEN counts descriptors
+#define DMA_BUSY        (1 << 8)
+#define DMA_DONE        (1 << 9)
+
+// XIP Control Register Fields
+#define XIP_CTRL_CMD(c)       ((uint32_t)(c) & 0xFF)
+#define XIP_CTRL_DUMMY(n)     (((uint32_t)(n) & 0xF) << 8)
+#define XIP_CTRL_CS(cs)       (((uint32_t)(cs) & 0x3) << 12)
+#define XIP_CTRL_EN           (1 << 16)
+#define XIP_CTRL_PREFETCH     (1 << 17)
+#define XIP_CTRL_ACTIVE       (1u << 31)  // Read-only: XIP owns the master
+
+// Performance Counter Control Bits
+#define PERF_CTRL_CLEAR       (1 << 0)  // Strobe: zero every counter
+#define PERF_CTRL_FREEZE      (1 << 1)  // Hold counters while reading
+
 // SPI Modes
 typedef enum {
     SPI_MODE_0 = 0,  // CPOL=0, CPHA=0
@@ -48,6 +223,51 @@ typedef enum {
     SPI_MODE_3 = 3,  // CPOL=1, CPHA=1
 } spi_mode_t;
 
+// Frame Sizes (bits per SPI frame, shifted MSB first)
+typedef enum {
+    SPI_FRAME_8  = 0,
+    SPI_FRAME_16 = 1,
+    SPI_FRAME_24 = 2,
+    SPI_FRAME_32 = 3,
+} spi_frame_size_t;
+
+// Data Lanes (dual/quad frames are half duplex)
+typedef enum {
+    SPI_LANES_SINGLE = 0,  // IO0=MOSI, IO1=MISO
+    SPI_LANES_DUAL   = 1,  // IO0-IO1
+    SPI_LANES_QUAD   = 2,  // IO0-IO3
+} spi_lanes_t;
+
+// SPI Flash Commands and Geometry
+#define SPI_FLASH_CS            SPI_CS_0
+#define FLASH_CMD_WRITE_ENABLE  0x06
+#define FLASH_CMD_READ_STATUS   0x05
+#define FLASH_CMD_READ          0x03
+#define FLASH_CMD_FAST_READ     0x0B
+#define FLASH_CMD_PAGE_PROGRAM  0x02
+#define FLASH_CMD_ERASE_4K      0x20
+#define FLASH_CMD_ERASE_32K     0x52
+#define FLASH_CMD_ERASE_64K     0xD8
+#define FLASH_CMD_READ_ID       0x9F
+#define FLASH_STATUS_WIP        (1 << 0)
+#define FLASH_PAGE_SIZE         256
+#define FLASH_SECTOR_SIZE       0x1000
+#define FLASH_BLOCK_32K         0x8000
+#define FLASH_BLOCK_64K         0x10000
+
+// Flash Busy Timeouts (typical datasheet maximums)
+#define FLASH_TIMEOUT_PROGRAM_MS    5
+#define FLASH_TIMEOUT_ERASE_4K_MS   400
+#define FLASH_TIMEOUT_ERASE_32K_MS  1600
+#define FLASH_TIMEOUT_ERASE_64K_MS  2000
+
+// Multi-I/O Flash Read Commands
+typedef enum {
+    SPI_FLASH_READ_DUAL_OUT = 0x3B,  // Fast Read Dual Output (1-1-2)
+    SPI_FLASH_READ_QUAD_OUT = 0x6B,  // Fast Read Quad Output (1-1-4)
+    SPI_FLASH_READ_QUAD_IO  = 0xEB,  // Fast Read Quad I/O (1-4-4)
+} spi_flash_read_cmd_t;
+
 // Chip Select Lines
 typedef enum {
     SPI_CS_0 = 0,
@@ -64,58 +284,289 @@ typedef enum {
     SPI_ERROR_FIFO_FULL,
     SPI_ERROR_FIFO_EMPTY,
     SPI_ERROR_INVALID_MODE,
+    SPI_ERROR_CRC,
 } spi_error_t;
 
+// Performance Counters (controller clock cycles; all wrap at 2^32)
+typedef struct {
+    uint32_t bytes;            // Payload bytes shifted
+    uint32_t busy_cycles;      // Cycles the master was shifting
+    uint32_t idle_cycles;      // Idle cycles between frames of a transfer
+    uint32_t underruns;        // Stalls under CS hold, empty RX FIFO reads
+    uint32_t overruns;         // Dropped RX frames, full TX FIFO writes
+    uint32_t irq_count;        // Interrupt assertions
+    uint32_t irq_latency;      // Total cycles irq_o was pending
+} spi_perf_stats_t;
+
+// Device Handle
+// Describes one device on the bus and the hardware profile slot that holds
+// its configuration. spi_device_init() programs the slot once; after that
+// spi_device_select() switches to the device with a single write.
+typedef struct {
+    uint8_t profile;              // Profile slot, 0 to SPI_NUM_PROFILES - 1
+    spi_cs_t cs;
+    spi_mode_t mode;
+    uint8_t clk_div;
+    bool cs_active_high;
+    spi_frame_size_t frame_size;
+    spi_lanes_t lanes;
+} spi_device_t;
+
+// Completion callback for asynchronous transfers (called from the ISR)
+typedef void (*spi_callback_t)(spi_error_t result, void *ctx);
+
+// Scatter-Gather Segment
+// One piece of a spi_transfer_sg() burst. A NULL tx_data segment sends
+// 0xFF and a NULL rx_data segment discards what it receives, so command,
+// dummy and data phases need no staging buffers. With 32-bit pointers the
+// array is also the descriptor list walked by the DMA engine (three words
+// per segment), which is what spi_transfer_sg_dma() hands it. Wider
+// pointers (host builds) do not fit that layout, so spi_transfer_sg_dma()
+// packs up to SPI_SG_DMA_MAX_SEGS segments into the bus handle instead.
+typedef struct {
+    const uint8_t *tx_data;
+    uint8_t *rx_data;
+    uint32_t length;              // Bytes, a whole number of frames
+} spi_sg_t;
+
+#define SPI_SG_DESC_BYTES  12     // Hardware descriptor size
+
+#if UINTPTR_MAX > 0xFFFFFFFFu
+#define SPI_SG_PACK_DESC          // Descriptors are packed, not the array
+#define SPI_SG_DMA_MAX_SEGS  8    // Segments per spi_transfer_sg_dma()
+#endif
+
+// CRC Algorithm
+// poly and init are given MSB first (unreflected). reflect feeds each byte
+// LSB first and reflects the result; xor_out is applied to the result.
+// Reflected CRCs are appended LSB byte first, the others MSB byte first.
+typedef struct {
+    uint8_t width;                // 1-32 bits
+    bool reflect;
+    uint32_t poly;
+    uint32_t init;
+    uint32_t xor_out;
+} spi_crc_t;
+
+#define SPI_CRC7_SD     { .width = 7, .reflect = false, .poly = 0x09, .init = 0, .xor_out = 0 }
+#define SPI_CRC16_SD    { .width = 16, .reflect = false, .poly = 0x1021, .init = 0, .xor_out = 0 }
+#define SPI_CRC32       { .width = 32, .reflect = true, .poly = 0x04C11DB7, \
+                          .init = 0xFFFFFFFF, .xor_out = 0xFFFFFFFF }
+
+// Trace Entry
+// stamp holds the kind in bits 31:28 and the controller cycles since the
+// trace started in bits 27:0 (wrapping). FRAME data: TX byte in 7:0, RX
+// byte in 15:8, TX and RX FIFO levels in 23:16 and 31:24 (low bytes of
+// wider frames). CS data: the four CS lines. STALL data: the reasons
+// active from that cycle on. scripts/trace2vcd.py turns a dump into VCD.
+typedef struct {
+    uint32_t stamp;
+    uint32_t data;
+} spi_trace_entry_t;
+
+#define SPI_TRACE_KIND(e)         ((e)->stamp >> 28)
+#define SPI_TRACE_TIME(e)         ((e)->stamp & 0x0FFFFFFF)
+#define SPI_TRACE_FRAME           1
+#define SPI_TRACE_CS              2
+#define SPI_TRACE_STALL           3
+#define SPI_TRACE_STALL_TX_EMPTY  (1 << 0)  // CS open, nothing to send
+#define SPI_TRACE_STALL_GAP       (1 << 1)  // Data waiting on CS setup or a frame gap
+#define SPI_TRACE_STALL_RX_FULL   (1 << 2)  // RX FIFO full under an open CS
+#define SPI_TRACE_STALL_UNDERRUN  (1 << 3)  // One-cycle pulses
+#define SPI_TRACE_STALL_OVERRUN   (1 << 4)
+
+// Bus Handle
+// One per controller, passed to every driver call. It holds everything the
+// driver knows about that controller, so buses are fully independent: a
+// transfer on one never waits for or reconfigures another, and each bus
+// is serviced from its own interrupt vector. spi_init() fills it in; the
+// fields are private to the driver.
+typedef struct {
+    uint32_t base;                // Register window, SPI_BUS_BASE(n)
+    bool initialized;
+    spi_mode_t mode;
+    spi_cs_t cs;                  // Selected chip select
+    uint32_t control_shadow;      // CONTROL as last written
+    uint32_t clk_div_shadow;      // CLK_DIV as last written
+    uint32_t auto_cs_shadow;      // AUTO_CS as last written
+    uint32_t fifo_depth;          // Reported by FIFO_INFO
+    uint32_t frame_bytes;
+    uint32_t cs_config[4];        // CS_CFGn as last written
+    uint32_t profile_cache[SPI_NUM_PROFILES];  // PROFILEn as last written
+    uint32_t profile_valid;       // Bit n set: profile n programmed
+    bool dma_cs_window;           // spi_dma_wait() closes an SG DMA window
+    uint32_t crc_ctrl;            // CRC_CTRL as last written, 0 = off
+    spi_crc_t crc;                // Algorithm set by spi_crc_enable()
+    uint32_t dma_saved_auto_cs;   // AUTO_CS to restore when it does
+    uint32_t dma_frames;          // Frames of the DMA transfer in flight
+#ifdef SPI_SG_PACK_DESC
+    // Descriptor list of the SG DMA transfer in flight; the DMA engine
+    // reads it, so it must be visible at its (32-bit) bus address
+    uint32_t dma_desc[SPI_SG_DMA_MAX_SEGS * SPI_SG_DESC_BYTES / 4];
+#endif
+    bool wfi;                     // Completion waits may sleep (spi_set_wfi)
+    
+    // Asynchronous transfer, owned by spi_irq_handler() while active
+    struct {
+        const uint8_t *tx_data;
+        uint8_t *rx_data;
+        uint32_t length;          // In frames
+        uint32_t tx_count;
+        uint32_t rx_count;
+        uint32_t frame_bytes;
+        spi_callback_t callback;
+        void *ctx;
+        uint32_t saved_irq_en;    // SPI_IRQ_EN to restore when it finishes
+        bool saved_irq_on;        // CONTROL.IRQ_EN was already set
+        volatile bool active;
+    } async;
+} spi_bus_t;
+
 // Function Prototypes
+// Every call except the delays takes the bus handle of the controller it
+// operates on.
 
 // Initialization
-void spi_init(spi_mode_t mode, uint8_t clk_div);
-spi_error_t spi_deinit(void);
+void spi_init(spi_bus_t *bus, uint32_t base, spi_mode_t mode, uint8_t clk_div);
+spi_error_t spi_deinit(spi_bus_t *bus);
 
 // Configuration
-spi_error_t spi_set_mode(spi_mode_t mode);
-spi_error_t spi_set_clock_divider(uint8_t divider);
-spi_error_t spi_set_cs_polarity(bool active_high);
-spi_error_t spi_enable_loopback(bool enable);
+spi_error_t spi_set_mode(spi_bus_t *bus, spi_mode_t mode);
+spi_error_t spi_set_clock_divider(spi_bus_t *bus, uint8_t divider);
+spi_error_t spi_set_cs_polarity(spi_bus_t *bus, bool active_high);
+spi_error_t spi_enable_loopback(spi_bus_t *bus, bool enable);
+spi_mode_t spi_get_mode(spi_bus_t *bus);
+spi_error_t spi_set_frame_size(spi_bus_t *bus, spi_frame_size_t size);
+spi_frame_size_t spi_get_frame_size(spi_bus_t *bus);
+spi_error_t spi_set_lanes(spi_bus_t *bus, spi_lanes_t lanes, bool input);
+uint8_t spi_get_clock_divider(spi_bus_t *bus);
+spi_error_t spi_set_sck_freq(spi_bus_t *bus, uint32_t hz);
+uint32_t spi_get_sck_freq(spi_bus_t *bus);
+spi_error_t spi_set_sample_delay(spi_bus_t *bus, uint8_t cycles);
+spi_error_t spi_set_tx_fill(spi_bus_t *bus, uint32_t frame);  // Sent by reads, default all ones
 
 // Control
-spi_error_t spi_select_device(spi_cs_t cs_line);
-spi_error_t spi_deselect_device(spi_cs_t cs_line);
+spi_error_t spi_select_device(spi_bus_t *bus, spi_cs_t cs_line);
+spi_error_t spi_deselect_device(spi_bus_t *bus, spi_cs_t cs_line);
+spi_error_t spi_set_cs_hold(spi_bus_t *bus, bool hold);  // Keep CS asserted between transfers
+spi_cs_t spi_get_selected_device(spi_bus_t *bus);
+spi_error_t spi_set_device_config(spi_bus_t *bus, spi_cs_t cs_line, spi_mode_t mode,
+                                  uint8_t clk_div, bool cs_active_high);
+spi_error_t spi_clear_device_config(spi_bus_t *bus, spi_cs_t cs_line);
+spi_error_t spi_device_init(spi_bus_t *bus, const spi_device_t *dev);
+spi_error_t spi_device_select(spi_bus_t *bus, const spi_device_t *dev);
+spi_error_t spi_set_cs_timing(spi_bus_t *bus, uint8_t setup_cycles, uint8_t hold_cycles,
+                              uint8_t gap_cycles);
+spi_error_t spi_set_auto_cs(spi_bus_t *bus, uint32_t frames);  // N-frame CS window, 0 = FIFO drains
+uint32_t spi_get_auto_cs(spi_bus_t *bus);
 
 // Data Transfer
-spi_error_t spi_transfer(uint8_t tx_data, uint8_t *rx_data);
-spi_error_t spi_transfer_blocking(uint8_t tx_data, uint8_t *rx_data, uint32_t timeout_ms);
-spi_error_t spi_write_bytes(const uint8_t *data, uint32_t length);
-spi_error_t spi_read_bytes(uint8_t *buffer, uint32_t length);
-spi_error_t spi_transfer_bytes(const uint8_t *tx_data, uint8_t *rx_data, uint32_t length);
+// Byte buffers are packed MSB first into frames of the configured size,
+// so the byte order on the wire does not depend on the frame size; lengths
+// must be a multiple of the frame size in bytes. Reads (a NULL TX buffer)
+// are clocked by the controller's TX fill, and writes (a NULL RX buffer)
+// run with RX discard, so neither moves dummy frames across the bus.
+spi_error_t spi_transfer(spi_bus_t *bus, uint8_t tx_data, uint8_t *rx_data);
+spi_error_t spi_transfer_blocking(spi_bus_t *bus, uint8_t tx_data, uint8_t *rx_data,
+                                  uint32_t timeout_ms);
+spi_error_t spi_write_bytes(spi_bus_t *bus, const uint8_t *data, uint32_t length);
+spi_error_t spi_read_bytes(spi_bus_t *bus, uint8_t *buffer, uint32_t length);
+spi_error_t spi_transfer_bytes(spi_bus_t *bus, const uint8_t *tx_data, uint8_t *rx_data,
+                               uint32_t length);
+spi_error_t spi_transfer_frames(spi_bus_t *bus, const uint32_t *tx_frames, uint32_t *rx_frames,
+                                uint32_t count);
+spi_error_t spi_transfer_sg(spi_bus_t *bus, const spi_sg_t *segs, uint32_t count);
+
+// Hardware CRC. The unit runs over every frame once enabled; the _crc
+// transfers restart it, then append the TX CRC or check a trailing RX CRC
+// (SPI_ERROR_CRC on mismatch). SD command CRC7 framing is left to the
+// caller via spi_crc_tx().
+spi_error_t spi_crc_enable(spi_bus_t *bus, const spi_crc_t *crc, bool tx, bool rx);
+spi_error_t spi_crc_disable(spi_bus_t *bus);
+spi_error_t spi_crc_reset(spi_bus_t *bus);
+uint32_t spi_crc_tx(spi_bus_t *bus);
+uint32_t spi_crc_rx(spi_bus_t *bus);
+spi_error_t spi_write_bytes_crc(spi_bus_t *bus, const uint8_t *data, uint32_t length);
+spi_error_t spi_read_bytes_crc(spi_bus_t *bus, uint8_t *buffer, uint32_t length);
+
+// DMA Transfer (8-bit frames; tx_data or rx_data may be NULL for one-directional moves)
+spi_error_t spi_transfer_dma(spi_bus_t *bus, const uint8_t *tx_data, uint8_t *rx_data,
+                             uint32_t length);
+spi_error_t spi_transfer_sg_dma(spi_bus_t *bus, const spi_sg_t *segs, uint32_t count);
+spi_error_t spi_dma_wait(spi_bus_t *bus);
+bool spi_dma_is_busy(spi_bus_t *bus);
+bool spi_dma_is_done(spi_bus_t *bus);  // DMA_CTRL.DONE, until spi_dma_wait() acknowledges it
+
+// Execute-in-place flash window. While enabled the XIP engine owns the
+// master, so no other transfer may be started until spi_xip_disable().
+spi_error_t spi_xip_enable(spi_bus_t *bus, spi_cs_t cs, uint8_t read_cmd, uint8_t dummy_bytes,
+                           bool prefetch);
+spi_error_t spi_xip_disable(spi_bus_t *bus);
+
+// Asynchronous Transfer (interrupt driven, returns immediately)
+spi_error_t spi_transfer_async(spi_bus_t *bus, const uint8_t *tx_data, uint8_t *rx_data,
+                               uint32_t length, spi_callback_t callback, void *ctx);
+bool spi_async_is_busy(spi_bus_t *bus);
 
 // FIFO Operations
-spi_error_t spi_fifo_write(uint8_t data);
-spi_error_t spi_fifo_read(uint8_t *data);
-bool spi_is_tx_fifo_full(void);
-bool spi_is_tx_fifo_empty(void);
-bool spi_is_rx_fifo_full(void);
-bool spi_is_rx_fifo_empty(void);
+spi_error_t spi_fifo_write(spi_bus_t *bus, uint8_t data);
+spi_error_t spi_fifo_read(spi_bus_t *bus, uint8_t *data);
+bool spi_is_tx_fifo_full(spi_bus_t *bus);
+bool spi_is_tx_fifo_empty(spi_bus_t *bus);
+bool spi_is_rx_fifo_full(spi_bus_t *bus);
+bool spi_is_rx_fifo_empty(spi_bus_t *bus);
+uint32_t spi_get_fifo_depth(spi_bus_t *bus);
+void spi_get_fifo_levels(spi_bus_t *bus, uint32_t *tx_level, uint32_t *rx_level);
+spi_error_t spi_set_fifo_thresholds(spi_bus_t *bus, uint8_t tx_low, uint8_t rx_high);
 
 // Status
-bool spi_is_busy(void);
-bool spi_is_done(void);
-bool spi_has_error(void);
-uint32_t spi_get_version(void);
+bool spi_is_busy(spi_bus_t *bus);
+bool spi_is_done(spi_bus_t *bus);
+bool spi_has_error(spi_bus_t *bus);
+uint32_t spi_get_version(spi_bus_t *bus);
+spi_error_t spi_get_perf_stats(spi_bus_t *bus, spi_perf_stats_t *stats);
+spi_error_t spi_reset_perf_stats(spi_bus_t *bus);
+
+// Trace Buffer. events is a mask of TRACE_CTRL_FRAME, _CS and _STALL; a
+// oneshot trace stops when the buffer fills instead of wrapping. Dumps
+// copy out the oldest entries first and should follow spi_trace_stop().
+spi_error_t spi_trace_start(spi_bus_t *bus, uint32_t events, bool oneshot);
+spi_error_t spi_trace_stop(spi_bus_t *bus);
+spi_error_t spi_trace_dump(spi_bus_t *bus, spi_trace_entry_t *entries, uint32_t max_entries,
+                           uint32_t *count);
+uint32_t spi_trace_flags(spi_bus_t *bus);  // TRACE_CTRL_WRAPPED / TRACE_CTRL_LOST
 
 // Interrupt
-spi_error_t spi_enable_interrupt(bool enable);
-spi_error_t spi_clear_interrupt(void);
-bool spi_is_interrupt_pending(void);
+// spi_set_wfi() lets the blocking calls sleep the core (CPU_WAIT_IRQ in
+// spi_hal.h) on IRQ_DONE or IRQ_DMA_DONE instead of polling, whenever at
+// least SPI_WFI_MIN_CYCLES of shifting are left. The sleep arms only that
+// cause on irq_o and restores SPI_IRQ_EN afterwards; the platform must
+// enable the bus's interrupt at the core, with a handler or masked.
+spi_error_t spi_set_wfi(spi_bus_t *bus, bool enable);
+spi_error_t spi_enable_interrupt(spi_bus_t *bus, bool enable);
+spi_error_t spi_set_irq_mask(spi_bus_t *bus, uint32_t causes);  // IRQ_* causes routed to irq_o
+uint32_t spi_get_irq_mask(spi_bus_t *bus);
+uint32_t spi_get_irq_status(spi_bus_t *bus);  // Raw IRQ_* causes, masked or not
+spi_error_t spi_clear_interrupt(spi_bus_t *bus);
+bool spi_is_interrupt_pending(spi_bus_t *bus);
+void spi_irq_handler(spi_bus_t *bus);  // Call from the vector wired to the bus's irq_o
 
-// Utility
+// Utility (backed by the timer peripheral, see timer.h)
 void spi_delay_ms(uint32_t ms);
 void spi_delay_us(uint32_t us);
 
 // Example device drivers
-spi_error_t spi_flash_read_id(uint8_t *manufacturer_id, uint8_t *device_id);
-spi_error_t spi_flash_read(uint32_t address, uint8_t *buffer, uint32_t length);
-spi_error_t spi_flash_write(uint32_t address, const uint8_t *data, uint32_t length);
-spi_error_t spi_flash_erase_sector(uint32_t address);
+spi_error_t spi_flash_read_id(spi_bus_t *bus, uint8_t *manufacturer_id, uint8_t *device_id);
+spi_error_t spi_flash_read(spi_bus_t *bus, uint32_t address, uint8_t *buffer, uint32_t length);
+spi_error_t spi_flash_read_multi(spi_bus_t *bus, spi_flash_read_cmd_t cmd, uint32_t address,
+                                 uint8_t *buffer, uint32_t length);
+spi_error_t spi_flash_write(spi_bus_t *bus, uint32_t address, const uint8_t *data, uint32_t length);
+spi_error_t spi_flash_erase(spi_bus_t *bus, uint32_t address, uint32_t length);
+spi_error_t spi_flash_erase_sector(spi_bus_t *bus, uint32_t address);
+
+// Fixed-configuration builds inline the hot path
+#ifdef SPI_STATIC_CONFIG
+#include "spi_static.h"
+#endif
 
 #endif // SPI_DRIVER_H
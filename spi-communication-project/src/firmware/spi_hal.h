@@ -0,0 +1,50 @@
+// SPI Register Access Backend
+// Every register access in the driver and timer goes through these macros.
+// Target builds map them to volatile loads and stores, exactly what the
+// driver used before, so the selection costs nothing on target. Building
+// with SPI_BUS_HOST routes each access to spi_bus_read()/spi_bus_write()
+// instead, provided by the host model (src/firmware/host) or the Verilator
+// harness, so the unmodified driver runs as a native program.
+//
+// CPU_WAIT_IRQ() stalls the core until an interrupt is pending, for the
+// driver's sleeping completion waits. WFI resumes on any interrupt enabled
+// at the core even while interrupts are globally masked, so no handler has
+// to run; on cores without it the macro does nothing and the waits poll.
+#ifndef SPI_HAL_H
+#define SPI_HAL_H
+
+#include <stdint.h>
+
+#ifdef SPI_BUS_HOST
+
+// Bus access of size bytes (1 or 4) at a physical address. Byte accesses
+// carry the value right-aligned, as a byte load/store would.
+uint32_t spi_bus_read(uint32_t addr, uint32_t size);
+void spi_bus_write(uint32_t addr, uint32_t size, uint32_t value);
+
+#define REG_READ32(addr)         spi_bus_read((uint32_t)(addr), 4)
+#define REG_WRITE32(addr, value) spi_bus_write((uint32_t)(addr), 4, (uint32_t)(value))
+#define REG_READ8(addr)          ((uint8_t)spi_bus_read((uint32_t)(addr), 1))
+#define REG_WRITE8(addr, value)  spi_bus_write((uint32_t)(addr), 1, (uint8_t)(value))
+
+// Runs the backend forward until some controller asserts irq_o
+void spi_bus_wait_irq(void);
+
+#define CPU_WAIT_IRQ()           spi_bus_wait_irq()
+
+#else
+
+#define REG_READ32(addr)         (*(volatile uint32_t *)(uintptr_t)(addr))
+#define REG_WRITE32(addr, value) (*(volatile uint32_t *)(uintptr_t)(addr) = (uint32_t)(value))
+#define REG_READ8(addr)          (*(volatile uint8_t *)(uintptr_t)(addr))
+#define REG_WRITE8(addr, value)  (*(volatile uint8_t *)(uintptr_t)(addr) = (uint8_t)(value))
+
+#if defined(__riscv) || defined(__arm__)
+#define CPU_WAIT_IRQ()           __asm__ volatile ("wfi" ::: "memory")
+#else
+#define CPU_WAIT_IRQ()           ((void)0)
+#endif
+
+#endif
+
+#endif // SPI_HAL_H
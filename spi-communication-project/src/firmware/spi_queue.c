@@ -0,0 +1,176 @@
+// SPI Transaction Queue Implementation
+// Runs queued descriptors back-to-back, reprogramming the controller only
+// when chip select, mode or clock divider change between descriptors.
+// Descriptors naming a device switch with a single profile write.
+// Each CS window is a counted auto-CS window covering the descriptor or
+// chain, so CS needs no explicit assert/release writes.
+
+#include "spi_queue.h"
+#include <stddef.h>
+
+// Abort a CS window left open by a failed descriptor
+static void spi_queue_release_cs(spi_queue_t *queue) {
+    if (queue->cs_held) {
+        if (queue->cs_hold_bit) {
+            spi_set_cs_hold(queue->bus, false);
+            queue->cs_hold_bit = false;
+        } else {
+            spi_set_auto_cs(queue->bus, 0);
+        }
+        queue->cs_held = false;
+    }
+}
+
+// Frames in the CS window starting at xfer: the descriptor itself plus
+// every descriptor chained to it with SPI_XFER_CS_HOLD
+static uint32_t spi_queue_window_frames(spi_queue_t *queue, const spi_xfer_t *xfer) {
+    uint32_t frame_bytes = (uint32_t)spi_get_frame_size(queue->bus) + 1;
+    uint32_t frames = xfer->length / frame_bytes;
+    
+    while ((xfer->flags & SPI_XFER_CS_HOLD) && xfer->next != NULL) {
+        xfer = xfer->next;
+        frames += xfer->length / frame_bytes;
+    }
+    
+    return frames;
+}
+
+// Open a CS window for the descriptor (and its chain)
+static spi_error_t spi_queue_open_window(spi_queue_t *queue, const spi_xfer_t *xfer) {
+    uint32_t frames = spi_queue_window_frames(queue, xfer);
+    spi_error_t error;
+    
+    if (frames > AUTO_CS_MAX_FRAMES) {
+        // Too long to count: hold CS in software for this window
+        spi_set_auto_cs(queue->bus, 0);
+        error = spi_set_cs_hold(queue->bus, true);
+        queue->cs_hold_bit = (error == SPI_OK);
+    } else {
+        error = spi_set_auto_cs(queue->bus, frames);
+    }
+    
+    queue->cs_held = (error == SPI_OK);
+    return error;
+}
+
+// Bring the controller to the descriptor's settings, touching only the
+// registers whose value actually differs from the active configuration
+static spi_error_t spi_queue_apply(spi_queue_t *queue, const spi_xfer_t *xfer) {
+    spi_error_t error = SPI_OK;
+    
+    if (xfer->dev != NULL) {
+        if (xfer->dev->cs != spi_get_selected_device(queue->bus)) {
+            spi_queue_release_cs(queue);
+        }
+        return spi_device_select(queue->bus, xfer->dev);
+    }
+    
+    if (xfer->cs != spi_get_selected_device(queue->bus)) {
+        spi_queue_release_cs(queue);
+        error = spi_select_device(queue->bus, xfer->cs);
+        if (error != SPI_OK) {
+            return error;
+        }
+    }
+    
+    if (xfer->mode != spi_get_mode(queue->bus)) {
+        error = spi_set_mode(queue->bus, xfer->mode);
+        if (error != SPI_OK) {
+            return error;
+        }
+    }
+    
+    if (xfer->clk_div != spi_get_clock_divider(queue->bus)) {
+        error = spi_set_clock_divider(queue->bus, xfer->clk_div);
+    }
+    
+    return error;
+}
+
+// Reset the queue and bind it to a bus
+void spi_queue_init(spi_queue_t *queue, spi_bus_t *bus) {
+    queue->bus = bus;
+    queue->head = NULL;
+    queue->tail = NULL;
+    queue->cs_held = false;
+    queue->cs_hold_bit = false;
+}
+
+// Append a descriptor to the queue
+spi_error_t spi_queue_submit(spi_queue_t *queue, spi_xfer_t *xfer) {
+    if (xfer == NULL) {
+        return SPI_ERROR_INVALID_MODE;
+    }
+    
+    xfer->next = NULL;
+    xfer->result = SPI_ERROR_BUSY;  // Pending
+    
+    if (queue->tail == NULL) {
+        queue->head = xfer;
+    } else {
+        queue->tail->next = xfer;
+    }
+    queue->tail = xfer;
+    
+    return SPI_OK;
+}
+
+// Run every queued descriptor in order. A descriptor flagged
+// SPI_XFER_CS_HOLD keeps its CS asserted so the next one (typically the
+// data phase after a command) continues the same CS window. Returns the
+// first error seen; each descriptor's own result is stored in it.
+//
+// The window is programmed as an auto-CS frame count when it opens, the
+// master releases CS after the last frame, and the count register is only
+// rewritten when the window size changes. The caller's own auto-CS
+// setting is restored once the queue has drained.
+spi_error_t spi_queue_run(spi_queue_t *queue) {
+    spi_error_t status = SPI_OK;
+    uint32_t saved_auto_cs = spi_get_auto_cs(queue->bus);
+    
+    while (queue->head != NULL) {
+        spi_xfer_t *xfer = queue->head;
+        queue->head = xfer->next;
+        if (queue->head == NULL) {
+            queue->tail = NULL;
+        }
+        
+        xfer->result = spi_queue_apply(queue, xfer);
+        
+        if (xfer->result == SPI_OK && !queue->cs_held) {
+            xfer->result = spi_queue_open_window(queue, xfer);
+        }
+        
+        if (xfer->result == SPI_OK) {
+            xfer->result = spi_transfer_bytes(queue->bus, xfer->tx_data, xfer->rx_data,
+                                              xfer->length);
+        }
+        
+        // End of the CS window unless this descriptor chains into the next.
+        // A counted window has already closed in hardware.
+        if (xfer->result != SPI_OK) {
+            spi_queue_release_cs(queue);
+        } else if (!(xfer->flags & SPI_XFER_CS_HOLD)) {
+            if (queue->cs_hold_bit) {
+                spi_queue_release_cs(queue);
+            }
+            queue->cs_held = false;
+        }
+        
+        if (xfer->result != SPI_OK && status == SPI_OK) {
+            status = xfer->result;
+        }
+    }
+    
+    // Never leave CS asserted once the queue has drained, and hand the
+    // controller back with the caller's auto-CS window
+    spi_queue_release_cs(queue);
+    spi_set_auto_cs(queue->bus, saved_auto_cs);
+    
+    return status;
+}
+
+// Check if any descriptors are pending
+bool spi_queue_is_empty(const spi_queue_t *queue) {
+    return queue->head == NULL;
+}
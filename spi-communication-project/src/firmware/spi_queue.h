@@ -0,0 +1,44 @@
+// SPI Transaction Queue Header File
+// Queued transfers across chip selects on one controller
+#ifndef SPI_QUEUE_H
+#define SPI_QUEUE_H
+
+#include "spi_driver.h"
+
+// Descriptor Flags
+#define SPI_XFER_CS_HOLD    (1 << 0)  // Keep CS asserted into the next descriptor
+
+// Transaction Descriptor
+// Descriptors are owned by the caller and linked into the queue in place,
+// so they must stay valid until spi_queue_run() has processed them.
+typedef struct spi_xfer {
+    const spi_device_t *dev;  // Device profile; NULL uses cs/mode/clk_div
+    spi_cs_t cs;
+    spi_mode_t mode;
+    uint8_t clk_div;
+    uint32_t flags;
+    const uint8_t *tx_data;   // NULL sends 0xFF
+    uint8_t *rx_data;         // NULL discards received data
+    uint32_t length;
+    spi_error_t result;       // Filled in when the descriptor completes
+    struct spi_xfer *next;
+} spi_xfer_t;
+
+// Transaction Queue
+// One per bus: its descriptors run on that bus only, so queues on
+// different buses are independent.
+typedef struct {
+    spi_bus_t *bus;
+    spi_xfer_t *head;
+    spi_xfer_t *tail;
+    bool cs_held;             // A CS window is open
+    bool cs_hold_bit;         // Window held with CS_HOLD (too long to count)
+} spi_queue_t;
+
+// Function Prototypes
+void spi_queue_init(spi_queue_t *queue, spi_bus_t *bus);
+spi_error_t spi_queue_submit(spi_queue_t *queue, spi_xfer_t *xfer);
+spi_error_t spi_queue_run(spi_queue_t *queue);
+bool spi_queue_is_empty(const spi_queue_t *queue);
+
+#endif // SPI_QUEUE_H
@@ -0,0 +1,99 @@
+// SPI Fixed-Configuration Build
+// Included by spi_driver.h when SPI_STATIC_CONFIG is defined, for images
+// that run every controller in one mode, at one divider and on one chip
+// select. spi_init() programs that configuration from the constants below
+// (its mode and divider arguments are ignored), and the per-byte calls
+// become inline code with no initialization or busy pre-checks:
+//
+//   spi_transfer()  - one CMD store, the completion poll and the RX read.
+//                     The error bit comes from the last poll, and the call
+//                     always waits for its frame, so the next call finds
+//                     the master idle and never needs SPI_ERROR_BUSY.
+//   spi_fifo_write(), spi_fifo_read(), spi_is_busy()
+//                   - one status read and one FIFO access.
+//
+// spi_init() must run before any of them. The rest of the API is unchanged.
+#ifndef SPI_STATIC_H
+#define SPI_STATIC_H
+
+#include <stddef.h>
+
+// Fixed configuration, override with -D
+#ifndef SPI_STATIC_MODE
+#define SPI_STATIC_MODE     0   // SPI_MODE_0
+#endif
+#ifndef SPI_STATIC_CLK_DIV
+#define SPI_STATIC_CLK_DIV  4
+#endif
+#ifndef SPI_STATIC_CS
+#define SPI_STATIC_CS       0   // SPI_CS_0
+#endif
+
+_Static_assert(SPI_STATIC_MODE >= 0 && SPI_STATIC_MODE <= 3, "SPI_STATIC_MODE must be 0-3");
+_Static_assert(SPI_STATIC_CLK_DIV >= 1 && SPI_STATIC_CLK_DIV <= 255, "SPI_STATIC_CLK_DIV must be 1-255");
+_Static_assert(SPI_STATIC_CS >= 0 && SPI_STATIC_CS <= 3, "SPI_STATIC_CS must be 0-3");
+
+// CONTROL value written by spi_init(): mode bits [2:1] are the mode number
+#define SPI_STATIC_CONTROL  (((uint32_t)SPI_STATIC_MODE << 1) | CTRL_CS(SPI_STATIC_CS))
+
+// Register access for the inline paths
+#define SPI_STATIC_READ(bus, offset)          REG_READ32((bus)->base + (offset))
+#define SPI_STATIC_WRITE(bus, offset, value)  REG_WRITE32((bus)->base + (offset), (value))
+
+// Single byte transfer: load and start in one store, then poll to the end
+static inline spi_error_t spi_static_transfer(spi_bus_t *bus, uint8_t tx_data, uint8_t *rx_data) {
+    uint32_t status;
+    
+    SPI_STATIC_WRITE(bus, SPI_CMD, CMD_START | CMD_LOAD | ((uint32_t)tx_data << CMD_DATA_SHIFT));
+    
+    // A pending start already reads as busy
+    do {
+        status = SPI_STATIC_READ(bus, SPI_STATUS);
+    } while (status & STAT_BUSY);
+    
+    if (status & STAT_ERROR) {
+        return SPI_ERROR_TIMEOUT;
+    }
+    
+    if (rx_data != NULL) {
+        *rx_data = REG_READ8(bus->base + SPI_RX_DATA);
+    }
+    
+    return SPI_OK;
+}
+
+// Write to TX FIFO
+static inline spi_error_t spi_static_fifo_write(spi_bus_t *bus, uint8_t data) {
+    if (SPI_STATIC_READ(bus, SPI_STATUS) & STAT_TX_FULL) {
+        return SPI_ERROR_FIFO_FULL;
+    }
+    
+    REG_WRITE8(bus->base + SPI_TX_FIFO, data);
+    return SPI_OK;
+}
+
+// Read from RX FIFO
+static inline spi_error_t spi_static_fifo_read(spi_bus_t *bus, uint8_t *data) {
+    if (SPI_STATIC_READ(bus, SPI_STATUS) & STAT_RX_EMPTY) {
+        return SPI_ERROR_FIFO_EMPTY;
+    }
+    
+    *data = REG_READ8(bus->base + SPI_RX_FIFO);
+    return SPI_OK;
+}
+
+// Check if SPI is busy
+static inline bool spi_static_is_busy(spi_bus_t *bus) {
+    return (SPI_STATIC_READ(bus, SPI_STATUS) & STAT_BUSY) != 0;
+}
+
+// Callers get the inline versions; spi_driver.c still defines the out of
+// line functions, so taking their address keeps working
+#ifndef SPI_DRIVER_IMPL
+#define spi_transfer(bus, tx_data, rx_data)  spi_static_transfer((bus), (tx_data), (rx_data))
+#define spi_fifo_write(bus, data)            spi_static_fifo_write((bus), (data))
+#define spi_fifo_read(bus, data)             spi_static_fifo_read((bus), (data))
+#define spi_is_busy(bus)                     spi_static_is_busy(bus)
+#endif
+
+#endif // SPI_STATIC_H
@@ -0,0 +1,56 @@
+// Timer Driver Implementation
+
+#include "timer.h"
+#include "spi_hal.h"
+
+// Register access through the backend selected in spi_hal.h
+#define TIMER_READ(offset) REG_READ32(TIMER_BASE_ADDR + (offset))
+
+// Read the 64-bit cycle count (COUNT_LO snapshots both halves)
+uint64_t timer_get_cycles(void) {
+    uint32_t lo = TIMER_READ(TIMER_COUNT_LO);
+    uint32_t hi = TIMER_READ(TIMER_COUNT_HI);
+    
+    return ((uint64_t)hi << 32) | lo;
+}
+
+// Counter frequency in Hz
+uint32_t timer_get_freq(void) {
+    return TIMER_READ(TIMER_FREQ);
+}
+
+// Deadline us microseconds from now, rounded up to a whole cycle
+uint64_t timer_deadline_us(uint32_t us) {
+    uint64_t cycles = ((uint64_t)us * timer_get_freq() + 999999) / 1000000;
+    
+    return timer_get_cycles() + cycles;
+}
+
+// Deadline ms milliseconds from now
+uint64_t timer_deadline_ms(uint32_t ms) {
+    uint64_t cycles = ((uint64_t)ms * timer_get_freq() + 999) / 1000;
+    
+    return timer_get_cycles() + cycles;
+}
+
+// Check whether a deadline has passed
+bool timer_expired(uint64_t deadline) {
+    return timer_get_cycles() >= deadline;
+}
+
+// Busy-wait delays
+void timer_delay_us(uint32_t us) {
+    uint64_t deadline = timer_deadline_us(us);
+    
+    while (!timer_expired(deadline)) {
+        // Busy wait
+    }
+}
+
+void timer_delay_ms(uint32_t ms) {
+    uint64_t deadline = timer_deadline_ms(ms);
+    
+    while (!timer_expired(deadline)) {
+        // Busy wait
+    }
+}
@@ -0,0 +1,29 @@
+// Timer Driver Header File
+// Free-running cycle counter used for timeouts and delays
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Timer Base Address
+#define TIMER_BASE_ADDR 0x40001000
+
+// Register Offsets
+#define TIMER_COUNT_LO  0x00  // Reading snapshots the full 64-bit count
+#define TIMER_COUNT_HI  0x04  // Upper half of the last COUNT_LO snapshot
+#define TIMER_FREQ      0x08  // Counter frequency in Hz
+
+// Function Prototypes
+uint64_t timer_get_cycles(void);
+uint32_t timer_get_freq(void);
+
+// Deadlines are absolute cycle counts
+uint64_t timer_deadline_us(uint32_t us);
+uint64_t timer_deadline_ms(uint32_t ms);
+bool timer_expired(uint64_t deadline);
+
+void timer_delay_us(uint32_t us);
+void timer_delay_ms(uint32_t ms);
+
+#endif // TIMER_H
@@ -2,7 +2,15 @@
 // Provides memory-mapped interface for SPI operations
 
 module spi_controller #(
-    parameter BASE_ADDR = 32'h4000_0000
+    parameter BASE_ADDR = 32'h4000_0000,
+    parameter FIFO_DEPTH = 8,            // Master TX/RX FIFO depth (1-255)
+    parameter XIP_BASE = 32'h6000_0000,  // Memory-mapped flash window
+    parameter XIP_ADDR_BITS = 24,        // XIP window size (16 MB, at most 24)
+    parameter NUM_PROFILES = 4,          // Device profiles (1-8)
+    parameter WB_PIPELINED = 0,          // 1: Wishbone B4 pipelined slave
+    parameter TRACE_DEPTH = 0,           // Trace entries (0: none, else power of two)
+    parameter CLOCK_GATING = 0,          // Master/FIFO idle: 0 clock enables, 1 gated clocks
+    parameter SCK_IO = 0                 // SCK pad register: 0 behavioural, 1 iCE40 SB_IO
 )(
     // Clock and Reset
     input wire clk,
@@ -15,18 +23,35 @@ module spi_controller #(
     input wire wb_we_i,
     input wire wb_stb_i,
     input wire wb_cyc_i,
+    input wire [2:0] wb_cti_i,           // Classic burst cycle type
+    input wire [1:0] wb_bte_i,           // Classic burst wrap type
     output reg wb_ack_o,
+    output wire wb_stall_o,              // Pipelined mode only
     
     // Interrupt
     output wire irq_o,
     
+    // DMA Wishbone Master Interface
+    output wire [31:0] dma_addr_o,
+    output wire [31:0] dma_data_o,
+    input wire [31:0] dma_data_i,
+    output wire dma_we_o,
+    output wire [3:0] dma_sel_o,
+    output wire dma_stb_o,
+    output wire dma_cyc_o,
+    input wire dma_ack_i,
+    
     // SPI Interface
     output wire spi_sck,
-    output wire spi_mosi,
-    input wire spi_miso,
+    output wire [3:0] spi_io_o,          // IO0=MOSI, IO1=MISO, IO2=WP#, IO3=HOLD#
+    output wire [3:0] spi_io_oe,
+    input wire [3:0] spi_io_i,
     output wire [3:0] spi_cs_n
 );
 
+    localparam LEVEL_WIDTH = $clog2(FIFO_DEPTH+1);
+    localparam [15:0] FIFO_DEPTH_INFO = FIFO_DEPTH;
+    
     // Register addresses
     localparam REG_CONTROL  = 8'h00;
     localparam REG_STATUS   = 8'h04;
@@ -37,6 +62,48 @@ module spi_controller #(
     localparam REG_RX_FIFO  = 8'h18;
     localparam REG_IRQ_EN   = 8'h1C;
     localparam REG_VERSION  = 8'h20;
+    localparam REG_IRQ_STAT = 8'h24;
+    localparam REG_CMD      = 8'h28;
+    localparam REG_FIFO_INFO   = 8'h2C;
+    localparam REG_FIFO_THRESH = 8'h30;
+    localparam REG_CS_TIMING   = 8'h34;
+    localparam REG_AUTO_CS     = 8'h38;
+    localparam REG_DMA_SRC  = 8'h40;
+    localparam REG_DMA_DST  = 8'h44;
+    localparam REG_DMA_LEN  = 8'h48;
+    localparam REG_DMA_CTRL = 8'h4C;
+    localparam REG_XIP_CTRL = 8'h54;
+    localparam REG_PERF_BYTES    = 8'h60;
+    localparam REG_PERF_BUSY     = 8'h64;
+    localparam REG_PERF_IDLE     = 8'h68;
+    localparam REG_PERF_UNDERRUN = 8'h6C;
+    localparam REG_PERF_OVERRUN  = 8'h70;
+    localparam REG_PERF_IRQ_CNT  = 8'h74;
+    localparam REG_PERF_IRQ_LAT  = 8'h78;
+    localparam REG_PERF_CTRL     = 8'h7C;
+    localparam REG_CS_CFG0  = 8'h80;     // Per chip select stored configuration
+    localparam REG_CS_CFG1  = 8'h84;
+    localparam REG_CS_CFG2  = 8'h88;
+    localparam REG_CS_CFG3  = 8'h8C;
+    localparam REG_PROFILE0 = 8'h90;     // Device profiles, one word each
+    localparam REG_FILL_DATA  = 8'hB0;   // Frame sent by TX fill
+    localparam REG_FILL_COUNT = 8'hB4;   // TX fill frames (write starts)
+    localparam REG_CRC_CTRL = 8'hB8;
+    localparam REG_CRC_POLY = 8'hBC;
+    localparam REG_CRC_INIT = 8'hC0;
+    localparam REG_CRC_TX   = 8'hC4;     // Running CRC of sent frames
+    localparam REG_CRC_RX   = 8'hC8;     // Running CRC of received frames
+    localparam REG_TRACE_CTRL = 8'hCC;
+    localparam REG_TRACE_STAT = 8'hD0;   // {depth, entries held}
+    localparam REG_TRACE_DATA = 8'hD4;   // Read pops: stamp word, then payload
+    localparam REG_FIFO_WIN = 8'hE0;     // 8-word FIFO alias for incrementing bursts
+    
+    // Wishbone cycle types and burst wraps
+    localparam CTI_CONST = 3'b001;
+    localparam CTI_INCR  = 3'b010;
+    localparam BTE_LINEAR = 2'b00;
+    localparam BTE_WRAP4  = 2'b01;
+    localparam BTE_WRAP8  = 2'b10;
     
     // Control register bits
     localparam CTRL_START     = 0;
@@ -48,6 +115,13 @@ module spi_controller #(
     localparam CTRL_DMA_EN    = 6;
     localparam CTRL_LOOPBACK  = 7;
     localparam CTRL_CS_POL    = 8;
+    localparam CTRL_CS_HOLD   = 9;
+    localparam CTRL_FRAME0    = 10;  // Frame size: 0=8, 1=16, 2=24, 3=32 bits
+    localparam CTRL_FRAME1    = 11;
+    localparam CTRL_LANES0    = 12;  // Data lanes: 0=single, 1=dual, 2=quad
+    localparam CTRL_LANES1    = 13;
+    localparam CTRL_LANE_IN   = 14;  // Dual/quad frames sample the lanes
+    localparam CTRL_RX_DISCARD = 15; // Received frames skip the RX FIFO
     
     // Status register bits
     localparam STAT_BUSY      = 0;
@@ -59,6 +133,79 @@ module spi_controller #(
     localparam STAT_ERROR     = 6;
     localparam STAT_IRQ_PEND  = 7;
     
+    // Command register bits (write-only strobes)
+    localparam CMD_START      = 0;  // Start a TX_DATA transfer
+    localparam CMD_LOAD       = 1;  // Load TX_DATA from bits [15:8] first
+    localparam CMD_PROFILE    = 2;  // Apply profile [18:16] first
+    localparam CMD_PROFILE_LSB = 16;
+    
+    // Interrupt cause bits (IRQ_STAT, masked by IRQ_EN)
+    localparam IRQ_DONE       = 0;  // Master went idle with TX FIFO empty
+    localparam IRQ_RX_HIGH    = 1;  // RX level >= RX watermark (level)
+    localparam IRQ_ERROR      = 2;  // Transfer error
+    localparam IRQ_DMA_DONE   = 3;  // DMA transfer complete
+    localparam IRQ_TX_LOW     = 4;  // TX level <= TX watermark (level)
+    localparam IRQ_CAUSES     = 5;
+    
+    // DMA control register bits
+    localparam DMA_START      = 0;
+    localparam DMA_TX_EN      = 1;
+    localparam DMA_RX_EN      = 2;
+    localparam DMA_SG         = 3;  // SRC is a descriptor list, LEN counts descriptors
+    localparam DMA_BUSY       = 8;
+    localparam DMA_DONE       = 9;
+    
+    // XIP control register fields
+    localparam XIP_CMD_LSB    = 0;   // [7:0] read command
+    localparam XIP_DUMMY_LSB  = 8;   // [11:8] dummy bytes after the address
+    localparam XIP_CS_LSB     = 12;  // [13:12] chip select
+    localparam XIP_EN         = 16;
+    localparam XIP_PREFETCH   = 17;
+    localparam XIP_ACTIVE     = 31;  // Read-only: engine owns the master
+    
+    // Auto-CS register fields
+    localparam AUTO_CS_EN     = 31;  // [15:0] frames per CS window
+    
+    // CLK_DIV register bits
+    localparam CLK_DIV_LSB    = 0;   // [7:0] SCK half period in cycles (>= 1)
+    localparam CLK_FRAC_LSB   = 8;   // [15:8] fractional half period, 1/256
+    localparam CLK_SAMPLE_LSB = 16;  // [19:16] receive sample delay
+    localparam CLK_FAST       = 24;  // SCK at the controller clock rate
+    localparam [31:0] CLK_DIV_MASK = 32'h010F_FFFF;
+    
+    // CS_CFGn register bits
+    localparam CS_CFG_MODE_LSB = 0;  // [1:0] SPI mode
+    localparam CS_CFG_POL      = 2;  // CS active high
+    localparam CS_CFG_DIV_LSB  = 8;  // [15:8] clock divider
+    localparam CS_CFG_EN       = 31; // Apply on select; own CS polarity
+    
+    // PROFILEn register bits
+    localparam PROF_MODE_LSB  = 0;   // [1:0] SPI mode
+    localparam PROF_POL       = 2;   // CS active high
+    localparam PROF_CS_LSB    = 4;   // [5:4] chip select
+    localparam PROF_FRAME_LSB = 8;   // [9:8] frame size
+    localparam PROF_LANES_LSB = 12;  // [13:12] data lanes
+    localparam PROF_DIV_LSB   = 16;  // [23:16] clock divider
+    localparam [23:0] PROF_MASK = 24'hFF_3337;
+    
+    // CRC control register fields
+    localparam CRC_TX_EN      = 0;   // Accumulate sent frames
+    localparam CRC_RX_EN      = 1;   // Accumulate received frames
+    localparam CRC_REFIN      = 2;   // Each byte enters LSB first
+    localparam CRC_CLEAR      = 3;   // Strobe: load INIT into both CRCs
+    localparam CRC_WIDTH_LSB  = 8;   // [12:8] CRC width - 1
+    
+    // Trace control register fields
+    localparam TRACE_EN       = 0;
+    localparam TRACE_CLEAR    = 1;   // Strobe: empty the buffer, restart the stamp
+    localparam TRACE_ONESHOT  = 2;   // Stop when full instead of wrapping
+    localparam TRACE_MASK_LSB = 8;   // [10:8] record FRAME, CS, STALL events
+    localparam [15:0] TRACE_DEPTH_INFO = TRACE_DEPTH;
+    
+    // Performance counter control bits
+    localparam PERF_CLEAR     = 0;   // Strobe: zero every counter
+    localparam PERF_FREEZE    = 1;   // Hold counters for a consistent read
+    
     // Internal registers
     reg [31:0] control_reg;
     reg [31:0] status_reg;
@@ -67,48 +214,253 @@ module spi_controller #(
     reg [31:0] clk_div_reg;
     reg [31:0] irq_en_reg;
     reg [31:0] version_reg;
+    reg [7:0] tx_low_reg;
+    reg [7:0] rx_high_reg;
+    reg [31:0] dma_src_reg;
+    reg [31:0] dma_dst_reg;
+    reg [31:0] dma_len_reg;
+    reg [3:0] dma_ctrl_reg;
+    reg [17:0] xip_ctrl_reg;
+    reg [23:0] cs_timing_reg;        // {gap, hold, setup} in clock cycles
+    reg [15:0] auto_cs_count;
+    reg auto_cs_en;
+    reg [3:0] cs_cfg_en;             // One bit per chip select line
+    reg [3:0] cs_cfg_pol;
+    reg [7:0] cs_cfg_mode;           // 2 bits per line
+    reg [31:0] cs_cfg_div;           // 8 bits per line
+    reg [NUM_PROFILES*24-1:0] profile_reg;  // 24 bits per profile
+    reg [31:0] fill_data_reg;
+    reg [15:0] fill_frames_reg;
+    reg fill_load;
+    reg [2:0] crc_en_reg;            // {REFIN, RX_EN, TX_EN}
+    reg [4:0] crc_width_m1;
+    reg [31:0] crc_poly_reg;
+    reg [31:0] crc_init_reg;
+    reg [31:0] crc_tx_reg;
+    reg [31:0] crc_rx_reg;
+    reg trace_en;
+    reg trace_oneshot;
+    reg [2:0] trace_mask;            // {STALL, CS, FRAME}
+    reg trace_clear;
+    reg trace_read_en;
+    
+    // Performance counters (free running, wrap at 2^32)
+    reg [31:0] perf_bytes;
+    reg [31:0] perf_busy;
+    reg [31:0] perf_idle;
+    reg [31:0] perf_underrun;
+    reg [31:0] perf_overrun;
+    reg [31:0] perf_irq_cnt;
+    reg [31:0] perf_irq_lat;
+    reg perf_freeze;
+    reg perf_clear;
+    reg irq_q;
+    reg dma_done_flag;
+    reg irq_done_flag;
+    reg irq_error_flag;
+    reg spi_busy_q;
+    reg start_req;
     
     // Internal signals
     wire spi_busy;
     wire spi_done;
     wire spi_error;
-    wire [7:0] spi_data_rx;
+    wire [31:0] spi_data_rx;
+    wire [31:0] spi_tx_frame;
     wire tx_fifo_full;
     wire tx_fifo_empty;
     wire rx_fifo_full;
     wire rx_fifo_empty;
-    wire [7:0] fifo_data_out;
+    wire [LEVEL_WIDTH-1:0] tx_fifo_level;
+    wire [LEVEL_WIDTH-1:0] rx_fifo_level;
+    wire tx_underrun;
+    wire rx_overrun;
+    wire [31:0] fifo_data_out;
+    wire [15:0] fill_left;
     
     // SPI mode
     wire [1:0] spi_mode = {control_reg[CTRL_MODE1], control_reg[CTRL_MODE0]};
     
+    // Frame size
+    wire [1:0] frame_size = {control_reg[CTRL_FRAME1], control_reg[CTRL_FRAME0]};
+    
+    // Data lanes
+    wire [1:0] lanes = {control_reg[CTRL_LANES1], control_reg[CTRL_LANES0]};
+    
     // Chip select
     wire [1:0] cs_sel = {control_reg[CTRL_CS_SEL1], control_reg[CTRL_CS_SEL0]};
+    wire [1:0] cs_sel_new = wb_data_i[CTRL_CS_SEL1:CTRL_CS_SEL0];
+    
+    // Each configured line idles at its own polarity, so selecting one
+    // device never glitches the others; the rest follow CTRL_CS_POL
+    wire [3:0] cs_line_pol = (cs_cfg_en & cs_cfg_pol) |
+                             (~cs_cfg_en & {4{control_reg[CTRL_CS_POL]}});
     
-    // FIFO signals
+    // FIFO signals (bus side)
     reg fifo_write_en;
     reg fifo_read_en;
-    wire [7:0] fifo_data_in = wb_data_i[7:0];
     
-    // Wishbone address match
+    // Pipelined mode: request latched at accept for its data phase
+    reg [31:0] dp_addr_q;
+    reg [31:0] dp_wdata_q;
+    reg [31:0] dp_xip_rdata_q;
+    
+    // DMA signals
+    reg dma_start;
+    wire dma_busy;
+    wire dma_done;
+    wire dma_tx_push;
+    wire [7:0] dma_tx_data;
+    wire dma_rx_pop;
+    
+    // XIP signals
+    wire xip_active;
+    wire xip_hit;
+    wire [31:0] xip_rdata;
+    wire [1:0] xip_frame_size;
+    wire xip_cs_hold;
+    wire xip_tx_push;
+    wire [31:0] xip_tx_data;
+    wire xip_rx_pop;
+    
+    // The DMA engine owns the FIFO ports while it is running (byte frames),
+    // then the XIP engine while it has a flash read open
+    wire master_fifo_write_en = dma_busy ? dma_tx_push :
+                                xip_active ? xip_tx_push : fifo_write_en;
+    wire master_fifo_read_en = dma_busy ? dma_rx_pop :
+                               xip_active ? xip_rx_pop : fifo_read_en;
+    wire [31:0] fifo_data_in = dma_busy ? {24'h0, dma_tx_data} :
+                               xip_active ? xip_tx_data :
+                               WB_PIPELINED ? dp_wdata_q : wb_data_i;
+    
+    // DMA frames are always bytes, whatever CONTROL selects; XIP reads use
+    // single-lane frames on their own chip select
+    wire [1:0] master_frame_size = dma_busy ? 2'b00 :
+                                   xip_active ? xip_frame_size : frame_size;
+    wire [1:0] master_lanes = xip_active ? 2'b00 : lanes;
+    wire master_lane_in = !xip_active && control_reg[CTRL_LANE_IN];
+    wire [1:0] master_cs_sel = xip_active ? xip_ctrl_reg[XIP_CS_LSB +: 2] : cs_sel;
+    wire master_cs_hold = xip_active ? xip_cs_hold : control_reg[CTRL_CS_HOLD];
+    
+    // The engines count every received frame, so they never see it dropped
+    wire master_rx_discard = control_reg[CTRL_RX_DISCARD] && !dma_busy && !xip_active;
+    wire fill_pending = (fill_left != 0);
+    
+    // Wishbone address match: register window and XIP flash window
     wire addr_match = (wb_addr_i[31:8] == BASE_ADDR[31:8]);
     wire [7:0] reg_addr = wb_addr_i[7:0];
+    wire [1:0] cs_cfg_idx = reg_addr[3:2];   // CS_CFGn line
+    
+    // Device profile register window and the profile named by a CMD write
+    wire [7:0] profile_off = reg_addr - REG_PROFILE0;
+    wire [2:0] profile_idx = profile_off[4:2];
+    wire profile_hit = (reg_addr >= REG_PROFILE0) &&
+                       (reg_addr < REG_PROFILE0 + 4 * NUM_PROFILES);
+    wire [2:0] cmd_profile_idx = wb_data_i[CMD_PROFILE_LSB +: 3];
+    wire cmd_profile_ok = (cmd_profile_idx < NUM_PROFILES);
+    wire [23:0] cmd_profile = cmd_profile_ok ? profile_reg[cmd_profile_idx*24 +: 24] : 24'h0;
+    wire xip_match = (wb_addr_i[31:XIP_ADDR_BITS] == XIP_BASE[31:XIP_ADDR_BITS]);
+    wire xip_enabled = xip_ctrl_reg[XIP_EN];
+    wire xip_req = wb_cyc_i && wb_stb_i && xip_match && !wb_we_i && xip_enabled &&
+                   (WB_PIPELINED || !wb_ack_o);
+    
+    // FIFO data ports: TX_FIFO pushes on write, RX_FIFO pops on read, and
+    // every word of the FIFO window does both
+    wire fifo_win_hit = (reg_addr[7:5] == REG_FIFO_WIN[7:5]);
+    
+    // Classic bursts: address of the beat after this one
+    reg [8:0] burst_next_addr;
+    always @(*) begin
+        burst_next_addr = {1'b0, reg_addr};
+        if (wb_cti_i == CTI_INCR) begin
+            case (wb_bte_i)
+                BTE_LINEAR: burst_next_addr = {1'b0, reg_addr} + 9'd4;
+                BTE_WRAP4:  burst_next_addr[3:2] = reg_addr[3:2] + 2'd1;
+                BTE_WRAP8:  burst_next_addr[4:2] = reg_addr[4:2] + 3'd1;
+                default:    burst_next_addr[5:2] = reg_addr[5:2] + 4'd1;
+            endcase
+        end
+    end
+    wire burst_next_port = !burst_next_addr[8] &&
+                           ((burst_next_addr[7:5] == REG_FIFO_WIN[7:5]) ||
+                            (wb_we_i ? burst_next_addr[7:0] == REG_TX_FIFO
+                                     : burst_next_addr[7:0] == REG_RX_FIFO ||
+                                       burst_next_addr[7:0] == REG_TRACE_DATA));
+    
+    // A classic master moves to the next beat as it samples this ack, so
+    // when that beat is another FIFO port access it is acked in the very
+    // next cycle, and its push or pop runs in that ack cycle using the data
+    // then on the bus. Other beats fall back to one ack per two clocks.
+    wire burst_continue = !WB_PIPELINED && wb_ack_o && wb_cyc_i && wb_stb_i && addr_match &&
+                          (wb_cti_i == CTI_CONST || wb_cti_i == CTI_INCR) && burst_next_port;
+    
+    // Pipelined mode accepts a request in every unstalled cycle and acks it
+    // in the next one, so the read data and TX FIFO push of the acked
+    // request use its address and data latched at accept. Only an XIP read
+    // waiting for its line stalls.
+    assign wb_stall_o = WB_PIPELINED && wb_cyc_i && wb_stb_i && xip_match && !wb_we_i &&
+                        xip_enabled && !xip_hit;
+    wire wb_accept = wb_cyc_i && wb_stb_i && !wb_stall_o && (WB_PIPELINED || !wb_ack_o);
+    always @(posedge clk or posedge reset) begin
+        if (reset) begin
+            dp_addr_q <= 32'h0;
+            dp_wdata_q <= 32'h0;
+            dp_xip_rdata_q <= 32'h0;
+        end else if (wb_accept) begin
+            dp_addr_q <= wb_addr_i;
+            dp_wdata_q <= wb_data_i;
+            dp_xip_rdata_q <= xip_rdata;
+        end
+    end
+    
+    // Data phase address: the bus address itself for a classic slave
+    wire [31:0] dp_addr = WB_PIPELINED ? dp_addr_q : wb_addr_i;
+    wire [7:0] dp_reg_addr = dp_addr[7:0];
+    wire dp_match = (dp_addr[31:8] == BASE_ADDR[31:8]);
+    wire dp_xip_match = (dp_addr[31:XIP_ADDR_BITS] == XIP_BASE[31:XIP_ADDR_BITS]);
+    wire [31:0] dp_xip_rdata = WB_PIPELINED ? dp_xip_rdata_q : xip_rdata;
+    wire [1:0] dp_cs_cfg_idx = dp_reg_addr[3:2];
+    wire [7:0] dp_profile_off = dp_reg_addr - REG_PROFILE0;
+    wire [2:0] dp_profile_idx = dp_profile_off[4:2];
+    wire dp_profile_hit = (dp_reg_addr >= REG_PROFILE0) &&
+                          (dp_reg_addr < REG_PROFILE0 + 4 * NUM_PROFILES);
+    wire dp_fifo_win_hit = (dp_reg_addr[7:5] == REG_FIFO_WIN[7:5]);
     
     // SPI Master instance
     spi_master #(
         .CLK_DIV_WIDTH(8),
-        .FIFO_DEPTH(8)
+        .FIFO_DEPTH(FIFO_DEPTH),
+        .CLOCK_GATING(CLOCK_GATING),
+        .SCK_IO(SCK_IO)
     ) spi_master_inst (
         .clk(clk),
         .reset(reset),
-        .start(control_reg[CTRL_START]),
-        .data_tx(tx_data_reg[7:0]),
+        .start(start_req),
+        .data_tx(tx_data_reg),
         .cpol_cpha(spi_mode),
-        .clk_div(clk_div_reg[7:0]),
-        .cs_polarity(control_reg[CTRL_CS_POL]),
-        .cs_select(cs_sel),
+        .frame_size(master_frame_size),
+        .lanes(master_lanes),
+        .lane_in(master_lane_in),
+        .clk_div(clk_div_reg[CLK_DIV_LSB +: 8]),
+        .clk_frac(clk_div_reg[CLK_FRAC_LSB +: 8]),
+        .sck_fast(clk_div_reg[CLK_FAST]),
+        .sample_delay(clk_div_reg[CLK_SAMPLE_LSB +: 4]),
+        .cs_polarity(cs_line_pol),
+        .cs_select(master_cs_sel),
+        .cs_hold(master_cs_hold),
+        .auto_cs_en(auto_cs_en && !xip_active),
+        .auto_cs_count(auto_cs_count),
+        .cs_setup_cycles(cs_timing_reg[7:0]),
+        .cs_hold_cycles(cs_timing_reg[15:8]),
+        .frame_gap_cycles(cs_timing_reg[23:16]),
         .loopback(control_reg[CTRL_LOOPBACK]),
+        .fill_load(fill_load),
+        .fill_frames(fill_frames_reg),
+        .fill_data(fill_data_reg),
+        .rx_discard(master_rx_discard),
+        .fill_left(fill_left),
         .data_rx(spi_data_rx),
+        .tx_frame(spi_tx_frame),
         .busy(spi_busy),
         .done(spi_done),
         .error(spi_error),
@@ -116,17 +468,204 @@ module spi_controller #(
         .tx_fifo_empty(tx_fifo_empty),
         .rx_fifo_full(rx_fifo_full),
         .rx_fifo_empty(rx_fifo_empty),
+        .tx_fifo_level(tx_fifo_level),
+        .rx_fifo_level(rx_fifo_level),
+        .tx_underrun(tx_underrun),
+        .rx_overrun(rx_overrun),
         .sck(spi_sck),
-        .mosi(spi_mosi),
-        .miso(spi_miso),
+        .sio_o(spi_io_o),
+        .sio_oe(spi_io_oe),
+        .sio_i(spi_io_i),
         .cs_n(spi_cs_n),
-        .fifo_write_en(fifo_write_en),
+        .fifo_write_en(master_fifo_write_en),
         .fifo_data_in(fifo_data_in),
-        .fifo_read_en(fifo_read_en),
+        .fifo_read_en(master_fifo_read_en),
         .fifo_data_out(fifo_data_out),
-        .irq(irq_o)
+        .irq()
+    );
+    
+    // DMA engine: streams between memory and the master FIFOs
+    spi_dma #(
+        .FIFO_DEPTH(FIFO_DEPTH)
+    ) spi_dma_inst (
+        .clk(clk),
+        .reset(reset),
+        .start(dma_start),
+        .src_addr(dma_src_reg),
+        .dst_addr(dma_dst_reg),
+        .length(dma_len_reg),
+        .tx_en(dma_ctrl_reg[DMA_TX_EN]),
+        .rx_en(dma_ctrl_reg[DMA_RX_EN]),
+        .sg(dma_ctrl_reg[DMA_SG]),
+        .busy(dma_busy),
+        .done(dma_done),
+        .tx_push(dma_tx_push),
+        .tx_data(dma_tx_data),
+        .tx_full(tx_fifo_full),
+        .rx_pop(dma_rx_pop),
+        .rx_data(fifo_data_out[7:0]),
+        .rx_empty(rx_fifo_empty),
+        .wb_addr_o(dma_addr_o),
+        .wb_data_o(dma_data_o),
+        .wb_data_i(dma_data_i),
+        .wb_we_o(dma_we_o),
+        .wb_sel_o(dma_sel_o),
+        .wb_stb_o(dma_stb_o),
+        .wb_cyc_o(dma_cyc_o),
+        .wb_ack_i(dma_ack_i)
+    );
+    
+    // XIP engine: serves reads in the flash window through the master
+    spi_xip #(
+        .FIFO_DEPTH(FIFO_DEPTH),
+        .ADDR_BITS(XIP_ADDR_BITS)
+    ) spi_xip_inst (
+        .clk(clk),
+        .reset(reset),
+        .enable(xip_enabled),
+        .prefetch(xip_ctrl_reg[XIP_PREFETCH]),
+        .read_cmd(xip_ctrl_reg[XIP_CMD_LSB +: 8]),
+        .dummy_bytes(xip_ctrl_reg[XIP_DUMMY_LSB +: 4]),
+        .req(xip_req),
+        .req_addr(wb_addr_i[XIP_ADDR_BITS-1:0]),
+        .hit(xip_hit),
+        .rdata(xip_rdata),
+        .active(xip_active),
+        .frame_size(xip_frame_size),
+        .cs_hold(xip_cs_hold),
+        .tx_push(xip_tx_push),
+        .tx_data(xip_tx_data),
+        .rx_pop(xip_rx_pop),
+        .rx_data(fifo_data_out),
+        .rx_empty(rx_fifo_empty)
     );
     
+    // Interrupt causes: latched events plus the FIFO watermark levels
+    wire [7:0] tx_level_info = tx_fifo_level;
+    wire [7:0] rx_level_info = rx_fifo_level;
+    wire tx_low = (tx_fifo_level <= tx_low_reg);
+    wire rx_high = (rx_fifo_level >= rx_high_reg);
+    wire [IRQ_CAUSES-1:0] irq_cause = {tx_low, dma_done_flag, irq_error_flag,
+                                       rx_high, irq_done_flag};
+    
+    assign irq_o = control_reg[CTRL_IRQ_EN] &&
+                   |(irq_cause & irq_en_reg[IRQ_CAUSES-1:0]);
+    
+    // Performance counters. IDLE counts cycles the master sits idle while a
+    // transfer is still in progress (CS held, frames queued or a start
+    // pending), i.e. gaps between frames rather than true bus idle time.
+    // IRQ_LAT accumulates the cycles irq_o stays asserted until software
+    // services it, so IRQ_LAT / IRQ_CNT is the mean service latency.
+    wire [2:0] frame_bytes = {1'b0, master_frame_size} + 3'd1;
+    wire frame_gap = !spi_busy && (master_cs_hold || !tx_fifo_empty || start_req || fill_pending);
+    wire fifo_underrun = (tx_underrun && !xip_active) ||
+                         (master_fifo_read_en && rx_fifo_empty);
+    wire fifo_overrun = rx_overrun || (master_fifo_write_en && tx_fifo_full);
+    
+    // Trace stall reasons: CS open with nothing to send, data waiting on
+    // the master (CS setup, frame gap), RX FIFO full under an open CS, and
+    // the underrun and overrun pulses counted above
+    wire cs_active = |(~(spi_cs_n ^ cs_line_pol));
+    wire stall_tx_empty = cs_active && !spi_busy && tx_fifo_empty && !start_req && !fill_pending;
+    wire stall_gap = !spi_busy && (!tx_fifo_empty || start_req || fill_pending);
+    wire stall_rx_full = cs_active && rx_fifo_full;
+    
+    wire [31:0] trace_rdata;
+    wire [15:0] trace_count;
+    wire trace_wrapped;
+    wire trace_lost;
+    
+    generate
+        if (TRACE_DEPTH > 0) begin : g_trace
+            spi_trace #(
+                .DEPTH(TRACE_DEPTH)
+            ) spi_trace_inst (
+                .clk(clk),
+                .reset(reset),
+                .enable(trace_en),
+                .clear(trace_clear),
+                .oneshot(trace_oneshot),
+                .mask(trace_mask),
+                .frame_done(spi_done),
+                .frame_info({rx_level_info, tx_level_info, spi_data_rx[7:0], spi_tx_frame[7:0]}),
+                .cs_n(spi_cs_n),
+                .stall({fifo_overrun, fifo_underrun, stall_rx_full, stall_gap, stall_tx_empty}),
+                .pop(trace_read_en),
+                .rdata(trace_rdata),
+                .count(trace_count),
+                .wrapped(trace_wrapped),
+                .lost(trace_lost)
+            );
+        end else begin : g_no_trace
+            assign trace_rdata = 32'h0;
+            assign trace_count = 16'h0;
+            assign trace_wrapped = 1'b0;
+            assign trace_lost = 1'b0;
+        end
+    endgenerate
+    
+    // CRC unit: folds each completed frame into the running CRC in wire
+    // order, MSB first (LSB first within each byte with REFIN). Registers
+    // hold the CRC right-aligned in width bits, unreflected.
+    function [31:0] crc_frame;
+        input [31:0] crc;
+        input [31:0] frame;
+        input [2:0] nbytes;
+        input [4:0] width_m1;
+        input [31:0] poly;
+        input refin;
+        integer k, j;
+        reg [31:0] acc;
+        reg [7:0] data_byte;
+        reg bit_in;
+        begin
+            acc = crc;
+            for (k = 3; k >= 0; k = k - 1) begin
+                if (k < nbytes) begin
+                    data_byte = frame[k*8 +: 8];
+                    for (j = 7; j >= 0; j = j - 1) begin
+                        bit_in = refin ? data_byte[7 - j] : data_byte[j];
+                        acc = (acc[width_m1] ^ bit_in) ? ((acc << 1) ^ poly) : (acc << 1);
+                    end
+                end
+            end
+            crc_frame = acc & (32'hFFFF_FFFF >> (5'd31 - width_m1));
+        end
+    endfunction
+    
+    always @(posedge clk or posedge reset) begin
+        if (reset) begin
+            perf_bytes <= 32'h0;
+            perf_busy <= 32'h0;
+            perf_idle <= 32'h0;
+            perf_underrun <= 32'h0;
+            perf_overrun <= 32'h0;
+            perf_irq_cnt <= 32'h0;
+            perf_irq_lat <= 32'h0;
+            irq_q <= 1'b0;
+        end else begin
+            irq_q <= irq_o;
+            
+            if (perf_clear) begin
+                perf_bytes <= 32'h0;
+                perf_busy <= 32'h0;
+                perf_idle <= 32'h0;
+                perf_underrun <= 32'h0;
+                perf_overrun <= 32'h0;
+                perf_irq_cnt <= 32'h0;
+                perf_irq_lat <= 32'h0;
+            end else if (!perf_freeze) begin
+                if (spi_done) perf_bytes <= perf_bytes + frame_bytes;
+                if (spi_busy) perf_busy <= perf_busy + 1;
+                if (frame_gap) perf_idle <= perf_idle + 1;
+                if (fifo_underrun) perf_underrun <= perf_underrun + 1;
+                if (fifo_overrun) perf_overrun <= perf_overrun + 1;
+                if (irq_o && !irq_q) perf_irq_cnt <= perf_irq_cnt + 1;
+                if (irq_o) perf_irq_lat <= perf_irq_lat + 1;
+            end
+        end
+    end
+    
     // Register initialization
     initial begin
         control_reg = 32'h0000_0000;
@@ -135,7 +674,35 @@ module spi_controller #(
         rx_data_reg = 32'h0000_0000;
         clk_div_reg = 32'h0000_0004; // Default divider = 4
         irq_en_reg = 32'h0000_0000;
+        tx_low_reg = FIFO_DEPTH / 2;
+        rx_high_reg = FIFO_DEPTH / 2;
         version_reg = 32'h0001_0000; // Version 1.0
+        dma_src_reg = 32'h0000_0000;
+        dma_dst_reg = 32'h0000_0000;
+        dma_len_reg = 32'h0000_0000;
+        dma_ctrl_reg = 4'h0;
+        dma_done_flag = 1'b0;
+        xip_ctrl_reg = 18'h0_010B;   // FAST READ, one dummy byte, CS0
+        perf_freeze = 1'b0;
+        cs_timing_reg = 24'h0;
+        auto_cs_count = 16'h0;
+        auto_cs_en = 1'b0;
+        cs_cfg_en = 4'h0;
+        cs_cfg_pol = 4'h0;
+        cs_cfg_mode = 8'h0;
+        cs_cfg_div = 32'h0404_0404;
+        profile_reg = {NUM_PROFILES{24'h04_0000}};
+        fill_data_reg = 32'hFFFF_FFFF;
+        fill_frames_reg = 16'h0;
+        crc_en_reg = 3'b000;
+        crc_width_m1 = 5'd15;        // CRC-16/XMODEM until configured
+        crc_poly_reg = 32'h0000_1021;
+        crc_init_reg = 32'h0000_0000;
+        crc_tx_reg = 32'h0000_0000;
+        crc_rx_reg = 32'h0000_0000;
+        trace_en = 1'b0;
+        trace_oneshot = 1'b0;
+        trace_mask = 3'b000;
     end
     
     // Wishbone write cycle
@@ -145,34 +712,168 @@ module spi_controller #(
             tx_data_reg <= 32'h0000_0000;
             clk_div_reg <= 32'h0000_0004;
             irq_en_reg <= 32'h0000_0000;
+            tx_low_reg <= FIFO_DEPTH / 2;
+            rx_high_reg <= FIFO_DEPTH / 2;
             fifo_write_en <= 1'b0;
             fifo_read_en <= 1'b0;
             wb_ack_o <= 1'b0;
+            dma_src_reg <= 32'h0000_0000;
+            dma_dst_reg <= 32'h0000_0000;
+            dma_len_reg <= 32'h0000_0000;
+            dma_ctrl_reg <= 4'h0;
+            xip_ctrl_reg <= 18'h0_010B;
+            perf_freeze <= 1'b0;
+            perf_clear <= 1'b0;
+            cs_timing_reg <= 24'h0;
+            auto_cs_count <= 16'h0;
+            auto_cs_en <= 1'b0;
+            cs_cfg_en <= 4'h0;
+            cs_cfg_pol <= 4'h0;
+            cs_cfg_mode <= 8'h0;
+            cs_cfg_div <= 32'h0404_0404;
+            profile_reg <= {NUM_PROFILES{24'h04_0000}};
+            fill_data_reg <= 32'hFFFF_FFFF;
+            fill_frames_reg <= 16'h0;
+            fill_load <= 1'b0;
+            crc_en_reg <= 3'b000;
+            crc_width_m1 <= 5'd15;
+            crc_poly_reg <= 32'h0000_1021;
+            crc_init_reg <= 32'h0000_0000;
+            crc_tx_reg <= 32'h0000_0000;
+            crc_rx_reg <= 32'h0000_0000;
+            trace_en <= 1'b0;
+            trace_oneshot <= 1'b0;
+            trace_mask <= 3'b000;
+            trace_clear <= 1'b0;
+            trace_read_en <= 1'b0;
+            dma_start <= 1'b0;
+            dma_done_flag <= 1'b0;
+            irq_done_flag <= 1'b0;
+            irq_error_flag <= 1'b0;
+            spi_busy_q <= 1'b0;
+            start_req <= 1'b0;
         end else begin
             // Default values
             fifo_write_en <= 1'b0;
             fifo_read_en <= 1'b0;
             wb_ack_o <= 1'b0;
+            dma_start <= 1'b0;
+            perf_clear <= 1'b0;
+            fill_load <= 1'b0;
+            trace_clear <= 1'b0;
+            trace_read_en <= 1'b0;
+            
+            // Sticky completion flag, cleared by writing DMA_DONE
+            if (dma_done) begin
+                dma_done_flag <= 1'b1;
+            end
+            
+            // CRCs of the frame that just completed
+            if (spi_done) begin
+                if (crc_en_reg[CRC_TX_EN]) begin
+                    crc_tx_reg <= crc_frame(crc_tx_reg, spi_tx_frame, frame_bytes, crc_width_m1,
+                                            crc_poly_reg, crc_en_reg[CRC_REFIN]);
+                end
+                if (crc_en_reg[CRC_RX_EN]) begin
+                    crc_rx_reg <= crc_frame(crc_rx_reg, spi_data_rx, frame_bytes, crc_width_m1,
+                                            crc_poly_reg, crc_en_reg[CRC_REFIN]);
+                end
+            end
+            
+            // Start request is held until the master picks it up
+            if (start_req && spi_busy) begin
+                start_req <= 1'b0;
+            end
+            
+            // Latched interrupt events
+            spi_busy_q <= spi_busy;
+            if (spi_busy_q && !spi_busy && tx_fifo_empty && !fill_pending) begin
+                irq_done_flag <= 1'b1;
+            end
+            if (spi_error) begin
+                irq_error_flag <= 1'b1;
+            end
+            
+            // XIP window: reads ack once the line buffer holds the word;
+            // writes, and reads while XIP is disabled, ack immediately
+            if (wb_accept && xip_match && (xip_hit || wb_we_i || !xip_enabled)) begin
+                wb_ack_o <= 1'b1;
+            end
+            
+            // Next beat of a classic FIFO port burst
+            if (burst_continue) begin
+                wb_ack_o <= 1'b1;
+                if (wb_we_i) begin
+                    fifo_write_en <= 1'b1;
+                end else if (burst_next_addr[7:0] == REG_TRACE_DATA) begin
+                    trace_read_en <= 1'b1;
+                end else begin
+                    fifo_read_en <= 1'b1;
+                end
+            end
             
-            // Wishbone transaction
-            if (wb_cyc_i && wb_stb_i && addr_match) begin
+            // Wishbone transaction (a classic slave acks once per cycle so
+            // FIFO pushes and pops are not repeated while the master still
+            // holds STB)
+            if (wb_accept && addr_match) begin
                 wb_ack_o <= 1'b1;
                 
+                if (!wb_we_i && (reg_addr == REG_RX_FIFO || fifo_win_hit)) begin
+                    // Pop on read; the head entry stays on wb_data_o
+                    // through the ack cycle
+                    fifo_read_en <= 1'b1;
+                end
+                
+                if (wb_we_i && fifo_win_hit) begin
+                    fifo_write_en <= 1'b1;
+                end
+                
+                if (!wb_we_i && reg_addr == REG_TRACE_DATA) begin
+                    trace_read_en <= 1'b1;
+                end
+                
                 if (wb_we_i) begin
                     // Write operation
                     case (reg_addr)
                         REG_CONTROL: begin
-                            control_reg <= wb_data_i;
-                            // Auto-clear start bit after setting
+                            // START is a strobe, not a stored setting
+                            control_reg <= {wb_data_i[31:1], 1'b0};
+                            // Switching to a configured chip select brings
+                            // its mode, polarity and divider along
+                            if (cs_sel_new != cs_sel && cs_cfg_en[cs_sel_new]) begin
+                                control_reg[CTRL_MODE1:CTRL_MODE0] <= cs_cfg_mode[cs_sel_new*2 +: 2];
+                                control_reg[CTRL_CS_POL] <= cs_cfg_pol[cs_sel_new];
+                                clk_div_reg <= {12'h0, clk_div_reg[CLK_SAMPLE_LSB +: 4], 8'h0,
+                                                cs_cfg_div[cs_sel_new*8 +: 8]};
+                            end
                             if (wb_data_i[CTRL_START]) begin
-                                control_reg[CTRL_START] <= 1'b1;
+                                start_req <= 1'b1;
+                            end
+                        end
+                        REG_CMD: begin
+                            // Single store: optional device profile, TX
+                            // byte and start, applied in that order
+                            if (wb_data_i[CMD_PROFILE] && cmd_profile_ok) begin
+                                control_reg[CTRL_MODE1:CTRL_MODE0] <= cmd_profile[PROF_MODE_LSB +: 2];
+                                control_reg[CTRL_CS_POL] <= cmd_profile[PROF_POL];
+                                control_reg[CTRL_CS_SEL1:CTRL_CS_SEL0] <= cmd_profile[PROF_CS_LSB +: 2];
+                                control_reg[CTRL_FRAME1:CTRL_FRAME0] <= cmd_profile[PROF_FRAME_LSB +: 2];
+                                control_reg[CTRL_LANES1:CTRL_LANES0] <= cmd_profile[PROF_LANES_LSB +: 2];
+                                clk_div_reg <= {12'h0, clk_div_reg[CLK_SAMPLE_LSB +: 4], 8'h0,
+                                                cmd_profile[PROF_DIV_LSB +: 8]};
+                            end
+                            if (wb_data_i[CMD_LOAD]) begin
+                                tx_data_reg <= {24'h0, wb_data_i[15:8]};
+                            end
+                            if (wb_data_i[CMD_START]) begin
+                                start_req <= 1'b1;
                             end
                         end
                         REG_TX_DATA: begin
                             tx_data_reg <= wb_data_i;
                         end
                         REG_CLK_DIV: begin
-                            clk_div_reg <= wb_data_i;
+                            clk_div_reg <= wb_data_i & CLK_DIV_MASK;
                         end
                         REG_TX_FIFO: begin
                             fifo_write_en <= 1'b1;
@@ -183,23 +884,105 @@ module spi_controller #(
                         REG_IRQ_EN: begin
                             irq_en_reg <= wb_data_i;
                         end
+                        REG_FIFO_THRESH: begin
+                            tx_low_reg <= wb_data_i[7:0];
+                            rx_high_reg <= wb_data_i[15:8];
+                        end
+                        REG_CS_TIMING: begin
+                            cs_timing_reg <= wb_data_i[23:0];
+                        end
+                        REG_AUTO_CS: begin
+                            auto_cs_count <= wb_data_i[15:0];
+                            auto_cs_en <= wb_data_i[AUTO_CS_EN];
+                        end
+                        REG_CS_CFG0, REG_CS_CFG1, REG_CS_CFG2, REG_CS_CFG3: begin
+                            cs_cfg_mode[cs_cfg_idx*2 +: 2] <= wb_data_i[CS_CFG_MODE_LSB +: 2];
+                            cs_cfg_pol[cs_cfg_idx] <= wb_data_i[CS_CFG_POL];
+                            cs_cfg_div[cs_cfg_idx*8 +: 8] <= wb_data_i[CS_CFG_DIV_LSB +: 8];
+                            cs_cfg_en[cs_cfg_idx] <= wb_data_i[CS_CFG_EN];
+                        end
+                        REG_IRQ_STAT: begin
+                            // Write 1 to clear latched causes
+                            if (wb_data_i[IRQ_DONE]) irq_done_flag <= 1'b0;
+                            if (wb_data_i[IRQ_ERROR]) irq_error_flag <= 1'b0;
+                            if (wb_data_i[IRQ_DMA_DONE]) dma_done_flag <= 1'b0;
+                        end
+                        REG_DMA_SRC: begin
+                            if (!dma_busy) dma_src_reg <= wb_data_i;
+                        end
+                        REG_DMA_DST: begin
+                            if (!dma_busy) dma_dst_reg <= wb_data_i;
+                        end
+                        REG_DMA_LEN: begin
+                            if (!dma_busy) dma_len_reg <= wb_data_i;
+                        end
+                        REG_DMA_CTRL: begin
+                            if (wb_data_i[DMA_DONE]) begin
+                                dma_done_flag <= 1'b0;
+                            end
+                            if (!dma_busy) begin
+                                dma_ctrl_reg <= {wb_data_i[DMA_SG:DMA_TX_EN], 1'b0};
+                                // DMA is only armed while CTRL_DMA_EN is set
+                                if (wb_data_i[DMA_START] && control_reg[CTRL_DMA_EN]) begin
+                                    dma_start <= 1'b1;
+                                    dma_done_flag <= 1'b0;
+                                end
+                            end
+                        end
+                        REG_XIP_CTRL: begin
+                            xip_ctrl_reg <= wb_data_i[17:0];
+                        end
+                        REG_FILL_DATA: begin
+                            fill_data_reg <= wb_data_i;
+                        end
+                        REG_CRC_CTRL: begin
+                            crc_en_reg <= wb_data_i[CRC_REFIN:CRC_TX_EN];
+                            crc_width_m1 <= wb_data_i[CRC_WIDTH_LSB +: 5];
+                            if (wb_data_i[CRC_CLEAR]) begin
+                                crc_tx_reg <= crc_init_reg;
+                                crc_rx_reg <= crc_init_reg;
+                            end
+                        end
+                        REG_CRC_POLY: begin
+                            crc_poly_reg <= wb_data_i;
+                        end
+                        REG_CRC_INIT: begin
+                            crc_init_reg <= wb_data_i;
+                        end
+                        REG_FILL_COUNT: begin
+                            // The engines own the master while they run
+                            if (!dma_busy && !xip_active) begin
+                                fill_frames_reg <= wb_data_i[15:0];
+                                fill_load <= 1'b1;
+                            end
+                        end
+                        REG_TRACE_CTRL: begin
+                            trace_en <= wb_data_i[TRACE_EN];
+                            trace_oneshot <= wb_data_i[TRACE_ONESHOT];
+                            trace_mask <= wb_data_i[TRACE_MASK_LSB +: 3];
+                            trace_clear <= wb_data_i[TRACE_CLEAR];
+                        end
+                        REG_PERF_CTRL: begin
+                            perf_clear <= wb_data_i[PERF_CLEAR];
+                            perf_freeze <= wb_data_i[PERF_FREEZE];
+                        end
                         default: begin
-                            // Do nothing for unknown registers
+                            if (profile_hit) begin
+                                profile_reg[profile_idx*24 +: 24] <= wb_data_i[23:0] & PROF_MASK;
+                            end
+                            // Other addresses are ignored
                         end
                     endcase
                 end
-                
-                // Auto-clear start bit
-                if (control_reg[CTRL_START] && spi_busy) begin
-                    control_reg[CTRL_START] <= 1'b0;
-                end
             end
         end
     end
     
     // Status register update
     always @(posedge clk) begin
-        status_reg[STAT_BUSY] <= spi_busy;
+        // A pending start already counts as busy, so a poll issued right
+        // after the start strobe cannot see a stale idle
+        status_reg[STAT_BUSY] <= spi_busy || start_req || fill_pending;
         status_reg[STAT_DONE] <= spi_done;
         status_reg[STAT_TX_FULL] <= tx_fifo_full;
         status_reg[STAT_TX_EMPTY] <= tx_fifo_empty;
@@ -208,16 +991,16 @@ module spi_controller #(
         status_reg[STAT_ERROR] <= spi_error;
         
         // Interrupt pending
-        status_reg[STAT_IRQ_PEND] <= irq_o && control_reg[CTRL_IRQ_EN];
+        status_reg[STAT_IRQ_PEND] <= irq_o;
         
         // Update RX data register when transfer completes
         if (spi_done) begin
-            rx_data_reg <= {24'h0, spi_data_rx};
+            rx_data_reg <= spi_data_rx;
         end
         
         // Update from FIFO read
         if (fifo_read_en) begin
-            rx_data_reg <= {24'h0, fifo_data_out};
+            rx_data_reg <= fifo_data_out;
         end
     end
     
@@ -225,18 +1008,707 @@ module spi_controller #(
     always @(*) begin
         wb_data_o = 32'h0000_0000;
         
-        if (addr_match) begin
-            case (reg_addr)
-                REG_CONTROL:  wb_data_o = control_reg;
+        if (dp_match) begin
+            case (dp_reg_addr)
+                REG_CONTROL:  wb_data_o = control_reg | start_req;
                 REG_STATUS:   wb_data_o = status_reg;
                 REG_TX_DATA:  wb_data_o = tx_data_reg;
                 REG_RX_DATA:  wb_data_o = rx_data_reg;
                 REG_CLK_DIV:  wb_data_o = clk_div_reg;
+                REG_RX_FIFO:  wb_data_o = fifo_data_out;
                 REG_IRQ_EN:   wb_data_o = irq_en_reg;
                 REG_VERSION:  wb_data_o = version_reg;
-                default:      wb_data_o = 32'hDEAD_BEEF;
+                REG_IRQ_STAT: wb_data_o = {{(32-IRQ_CAUSES){1'b0}}, irq_cause};
+                REG_FIFO_INFO: wb_data_o = {FIFO_DEPTH_INFO, rx_level_info, tx_level_info};
+                REG_FIFO_THRESH: wb_data_o = {16'h0, rx_high_reg, tx_low_reg};
+                REG_CS_TIMING: wb_data_o = {8'h0, cs_timing_reg};
+                REG_AUTO_CS:   wb_data_o = {auto_cs_en, 15'h0, auto_cs_count};
+                REG_FILL_DATA: wb_data_o = fill_data_reg;
+                REG_FILL_COUNT: wb_data_o = {16'h0, fill_left};
+                REG_CRC_CTRL:  wb_data_o = {19'h0, crc_width_m1, 5'h0, crc_en_reg};
+                REG_CRC_POLY:  wb_data_o = crc_poly_reg;
+                REG_CRC_INIT:  wb_data_o = crc_init_reg;
+                REG_CRC_TX:    wb_data_o = crc_tx_reg;
+                REG_CRC_RX:    wb_data_o = crc_rx_reg;
+                REG_TRACE_CTRL: wb_data_o = {14'h0, trace_lost, trace_wrapped, 5'h0, trace_mask,
+                                             5'h0, trace_oneshot, 1'b0, trace_en};
+                REG_TRACE_STAT: wb_data_o = {TRACE_DEPTH_INFO, trace_count};
+                REG_TRACE_DATA: wb_data_o = trace_rdata;
+                REG_DMA_SRC:  wb_data_o = dma_src_reg;
+                REG_DMA_DST:  wb_data_o = dma_dst_reg;
+                REG_DMA_LEN:  wb_data_o = dma_len_reg;
+                REG_DMA_CTRL: wb_data_o = {22'h0, dma_done_flag, dma_busy,
+                                           4'h0, dma_ctrl_reg};
+                REG_XIP_CTRL: wb_data_o = {xip_active, 13'h0, xip_ctrl_reg};
+                REG_PERF_BYTES:    wb_data_o = perf_bytes;
+                REG_PERF_BUSY:     wb_data_o = perf_busy;
+                REG_PERF_IDLE:     wb_data_o = perf_idle;
+                REG_PERF_UNDERRUN: wb_data_o = perf_underrun;
+                REG_PERF_OVERRUN:  wb_data_o = perf_overrun;
+                REG_PERF_IRQ_CNT:  wb_data_o = perf_irq_cnt;
+                REG_PERF_IRQ_LAT:  wb_data_o = perf_irq_lat;
+                REG_PERF_CTRL:     wb_data_o = {30'h0, perf_freeze, 1'b0};
+                REG_CS_CFG0, REG_CS_CFG1, REG_CS_CFG2, REG_CS_CFG3:
+                    wb_data_o = {cs_cfg_en[dp_cs_cfg_idx], 15'h0,
+                                 cs_cfg_div[dp_cs_cfg_idx*8 +: 8], 5'h0,
+                                 cs_cfg_pol[dp_cs_cfg_idx],
+                                 cs_cfg_mode[dp_cs_cfg_idx*2 +: 2]};
+                default:      wb_data_o = dp_fifo_win_hit ? fifo_data_out :
+                                          dp_profile_hit ? {8'h0, profile_reg[dp_profile_idx*24 +: 24]}
+                                                         : 32'hDEAD_BEEF;
+            endcase
+        end else if (dp_xip_match) begin
+            wb_data_o = xip_enabled ? dp_xip_rdata : 32'hDEAD_BEEF;
+        end
+    end
+    
+endmodule
+
+// SPI DMA Engine
+// Wishbone bus master that moves a byte buffer from memory into the master
+// TX FIFO and stores received bytes from the RX FIFO back to memory.
+// Memory is accessed one 32-bit word at a time (little-endian byte lanes);
+// unaligned buffers are handled with byte selects on the store side.
+//
+// In scatter-gather mode src_addr points at a list of length descriptors of
+// three words each: TX address, RX address and byte count. A zero TX
+// address sends 0xFF and a zero RX address discards, so the list matches an
+// spi_sg_t array on the 32-bit target. Each segment finishes storing before
+// the next descriptor is fetched.
+module spi_dma #(
+    parameter FIFO_DEPTH = 8
+)(
+    input wire clk,
+    input wire reset,
+    
+    // Configuration
+    input wire start,
+    input wire [31:0] src_addr,
+    input wire [31:0] dst_addr,
+    input wire [31:0] length,      // Transfer length in bytes
+    input wire tx_en,              // 0: send 0xFF instead of fetching
+    input wire rx_en,              // 0: discard received bytes
+    input wire sg,                 // 1: walk a descriptor list (see above)
+    
+    // Status
+    output reg busy,
+    output reg done,
+    
+    // Master FIFO Interface
+    output wire tx_push,
+    output wire [7:0] tx_data,
+    input wire tx_full,
+    output wire rx_pop,
+    input wire [7:0] rx_data,
+    input wire rx_empty,
+    
+    // Wishbone Master Interface
+    output reg [31:0] wb_addr_o,
+    output reg [31:0] wb_data_o,
+    input wire [31:0] wb_data_i,
+    output reg wb_we_o,
+    output reg [3:0] wb_sel_o,
+    output reg wb_stb_o,
+    output reg wb_cyc_o,
+    input wire wb_ack_i
+);
+
+    // TX side: current fetched word and bytes left in it
+    reg [31:0] tx_addr;
+    reg [31:0] tx_left;
+    reg [31:0] tx_word;
+    reg [2:0] tx_bytes;
+    
+    // RX side: word being assembled and its byte lanes
+    reg [31:0] rx_addr;
+    reg [31:0] rx_left;
+    reg [31:0] rx_word;
+    reg [3:0] rx_sel;
+    reg rx_flush;
+    reg [31:0] rx_flush_addr;
+    
+    // Frames pushed but not yet popped; bounded by the FIFO depth so the
+    // RX FIFO can never overflow
+    reg [7:0] inflight;
+    
+    // Directions enabled for the current segment
+    reg seg_tx_en;
+    reg seg_rx_en;
+    
+    // Descriptor list: next descriptor, descriptors left, word being read
+    reg [31:0] desc_addr;
+    reg [31:0] desc_left;
+    reg [1:0] desc_word;
+    reg desc_fetch;
+    
+    wire tx_need_fetch = seg_tx_en && (tx_left != 0) && (tx_bytes == 0);
+    
+    assign tx_push = busy && (tx_left != 0) && (!seg_tx_en || tx_bytes != 0) &&
+                     (inflight < FIFO_DEPTH) && !tx_full;
+    assign tx_data = seg_tx_en ? tx_word[7:0] : 8'hFF;
+    assign rx_pop = busy && (rx_left != 0) && !rx_empty && !rx_flush;
+    
+    always @(posedge clk or posedge reset) begin
+        if (reset) begin
+            busy <= 1'b0;
+            done <= 1'b0;
+            tx_addr <= 32'h0;
+            tx_left <= 32'h0;
+            tx_word <= 32'h0;
+            tx_bytes <= 3'd0;
+            rx_addr <= 32'h0;
+            rx_left <= 32'h0;
+            rx_word <= 32'h0;
+            rx_sel <= 4'h0;
+            rx_flush <= 1'b0;
+            rx_flush_addr <= 32'h0;
+            inflight <= 8'h0;
+            seg_tx_en <= 1'b0;
+            seg_rx_en <= 1'b0;
+            desc_addr <= 32'h0;
+            desc_left <= 32'h0;
+            desc_word <= 2'd0;
+            desc_fetch <= 1'b0;
+            wb_addr_o <= 32'h0;
+            wb_data_o <= 32'h0;
+            wb_we_o <= 1'b0;
+            wb_sel_o <= 4'h0;
+            wb_stb_o <= 1'b0;
+            wb_cyc_o <= 1'b0;
+        end else begin
+            done <= 1'b0;
+            
+            if (!busy) begin
+                if (start) begin
+                    busy <= (length != 0);
+                    done <= (length == 0);
+                    tx_bytes <= 3'd0;
+                    rx_sel <= 4'h0;
+                    rx_flush <= 1'b0;
+                    inflight <= 8'h0;
+                    desc_word <= 2'd0;
+                    if (sg) begin
+                        // Segments are loaded by the descriptor fetch
+                        tx_left <= 32'h0;
+                        rx_left <= 32'h0;
+                        desc_addr <= src_addr;
+                        desc_left <= length;
+                        desc_fetch <= (length != 0);
+                    end else begin
+                        tx_addr <= src_addr;
+                        tx_left <= length;
+                        rx_addr <= dst_addr;
+                        rx_left <= length;
+                        seg_tx_en <= tx_en;
+                        seg_rx_en <= rx_en;
+                        desc_left <= 32'h0;
+                        desc_fetch <= 1'b0;
+                    end
+                end
+            end else begin
+                // TX: hand one byte per cycle to the master
+                if (tx_push) begin
+                    tx_word <= {8'h00, tx_word[31:8]};
+                    tx_bytes <= tx_bytes - 1;
+                    tx_left <= tx_left - 1;
+                end
+                
+                // RX: collect bytes into the word for the current address
+                if (rx_pop) begin
+                    rx_left <= rx_left - 1;
+                    rx_addr <= rx_addr + 1;
+                    if (seg_rx_en) begin
+                        rx_word[rx_addr[1:0]*8 +: 8] <= rx_data;
+                        rx_sel[rx_addr[1:0]] <= 1'b1;
+                        if (rx_addr[1:0] == 2'd3 || rx_left == 1) begin
+                            rx_flush <= 1'b1;
+                            rx_flush_addr <= {rx_addr[31:2], 2'b00};
+                        end
+                    end
+                end
+                
+                case ({tx_push, rx_pop})
+                    2'b10: inflight <= inflight + 1;
+                    2'b01: inflight <= inflight - 1;
+                    default: ;
+                endcase
+                
+                // Bus: stores take priority so the RX side keeps draining
+                if (!wb_cyc_o) begin
+                    if (rx_flush) begin
+                        wb_addr_o <= rx_flush_addr;
+                        wb_data_o <= rx_word;
+                        wb_sel_o <= rx_sel;
+                        wb_we_o <= 1'b1;
+                        wb_stb_o <= 1'b1;
+                        wb_cyc_o <= 1'b1;
+                    end else if (desc_fetch) begin
+                        wb_addr_o <= desc_addr;
+                        wb_sel_o <= 4'hF;
+                        wb_we_o <= 1'b0;
+                        wb_stb_o <= 1'b1;
+                        wb_cyc_o <= 1'b1;
+                    end else if (tx_need_fetch) begin
+                        wb_addr_o <= {tx_addr[31:2], 2'b00};
+                        wb_sel_o <= 4'hF;
+                        wb_we_o <= 1'b0;
+                        wb_stb_o <= 1'b1;
+                        wb_cyc_o <= 1'b1;
+                    end
+                end else if (wb_ack_i) begin
+                    wb_stb_o <= 1'b0;
+                    wb_cyc_o <= 1'b0;
+                    if (wb_we_o) begin
+                        rx_flush <= 1'b0;
+                        rx_sel <= 4'h0;
+                    end else if (desc_fetch) begin
+                        // Descriptor words: TX address, RX address, length
+                        desc_addr <= desc_addr + 4;
+                        desc_word <= desc_word + 1;
+                        case (desc_word)
+                            2'd0: begin
+                                tx_addr <= wb_data_i;
+                                seg_tx_en <= tx_en && (wb_data_i != 0);
+                            end
+                            2'd1: begin
+                                rx_addr <= wb_data_i;
+                                seg_rx_en <= rx_en && (wb_data_i != 0);
+                            end
+                            default: begin
+                                tx_left <= wb_data_i;
+                                rx_left <= wb_data_i;
+                                tx_bytes <= 3'd0;
+                                desc_left <= desc_left - 1;
+                                desc_word <= 2'd0;
+                                desc_fetch <= 1'b0;
+                            end
+                        endcase
+                    end else begin
+                        // Skip leading bytes of an unaligned source
+                        tx_word <= wb_data_i >> {tx_addr[1:0], 3'b000};
+                        tx_bytes <= 3'd4 - tx_addr[1:0];
+                        tx_addr <= {tx_addr[31:2] + 30'd1, 2'b00};
+                    end
+                end
+                
+                // Segment finished once every byte is stored and the bus is
+                // free; then fetch the next descriptor or complete
+                if (tx_left == 0 && rx_left == 0 && !rx_flush && !wb_cyc_o && !desc_fetch) begin
+                    if (desc_left != 0) begin
+                        desc_fetch <= 1'b1;
+                    end else begin
+                        busy <= 1'b0;
+                        done <= 1'b1;
+                    end
+                end
+            end
+        end
+    end
+    
+endmodule
+
+// SPI XIP Engine
+// Serves CPU reads from a memory-mapped flash window. Reads hit in a
+// two-line buffer; a miss streams the whole line from flash as 32-bit
+// frames through the master FIFOs. CS stays asserted after a fill, so a
+// fetch of the following line continues the same read command without
+// sending a new command and address. With prefetch enabled, the line
+// after the one the CPU is executing from is fetched in the background.
+module spi_xip #(
+    parameter FIFO_DEPTH = 8,
+    parameter ADDR_BITS = 24,      // Flash window size (3-byte addresses, <= 24)
+    parameter LINE_WORDS = 4       // Words per line buffer (power of 2, >= 2)
+)(
+    input wire clk,
+    input wire reset,
+    
+    // Configuration
+    input wire enable,
+    input wire prefetch,
+    input wire [7:0] read_cmd,     // e.g. 0x03 READ or 0x0B FAST READ
+    input wire [3:0] dummy_bytes,  // Dummy bytes after the address
+    
+    // CPU Read Port
+    input wire req,
+    input wire [ADDR_BITS-1:0] req_addr,
+    output wire hit,
+    output wire [31:0] rdata,
+    
+    // Master Control (valid while active)
+    output wire active,
+    output wire [1:0] frame_size,
+    output wire cs_hold,
+    
+    // Master FIFO Interface
+    output wire tx_push,
+    output wire [31:0] tx_data,
+    output wire rx_pop,
+    input wire [31:0] rx_data,
+    input wire rx_empty
+);
+
+    localparam WORD_BITS = $clog2(LINE_WORDS);
+    localparam LINE_SHIFT = WORD_BITS + 2;
+    localparam TAG_W = ADDR_BITS - LINE_SHIFT;
+    localparam CS_GAP = 4;           // Cycles CS stays high between commands
+    
+    // The read command carries a 3-byte address in one 32-bit frame, so a
+    // window wider than that cannot be addressed
+    generate
+        if (ADDR_BITS > 24) begin : g_addr_check
+            $error("spi_xip: ADDR_BITS = %0d exceeds the 24-bit flash address", ADDR_BITS);
+        end
+    endgenerate
+    
+    typedef enum logic [2:0] {
+        X_IDLE  = 3'b000,
+        X_CLOSE = 3'b001,
+        X_CMD   = 3'b010,
+        X_DUMMY = 3'b011,
+        X_DATA  = 3'b100
+    } xip_state_t;
+    
+    xip_state_t state;
+    
+    // Line buffers: entry {buffer, word}
+    reg [31:0] line_data [0:2*LINE_WORDS-1];
+    reg [TAG_W-1:0] line_tag [0:1];
+    reg [1:0] line_live;             // Tag valid (filled or filling)
+    reg [2*LINE_WORDS-1:0] word_valid;
+    reg mru;                         // Buffer of the last CPU hit
+    reg fill_buf;                    // Buffer being (or last) filled
+    reg [WORD_BITS-1:0] fill_word;
+    
+    // Open read session: CS asserted, flash positioned at next_line
+    reg session_open;
+    reg [TAG_W-1:0] next_line;
+    
+    // Frames left to push/pop in the current phase
+    reg [4:0] push_left;
+    reg [4:0] pop_left;
+    reg [7:0] inflight;
+    reg [2:0] gap_count;
+    
+    // CPU lookup
+    wire [TAG_W-1:0] req_line = req_addr[ADDR_BITS-1:LINE_SHIFT];
+    wire [WORD_BITS-1:0] req_word = req_addr[LINE_SHIFT-1:2];
+    wire match0 = line_live[0] && (line_tag[0] == req_line);
+    wire match1 = line_live[1] && (line_tag[1] == req_line);
+    wire [WORD_BITS:0] req_index = {match1, req_word};
+    wire miss = req && !match0 && !match1;
+    
+    assign hit = req && (match0 || match1) && word_valid[req_index];
+    assign rdata = line_data[req_index];
+    
+    // Prefetch the next line once the CPU runs from the line filled last,
+    // unless the other buffer already holds it
+    wire victim = ~mru;
+    wire want_prefetch = prefetch && session_open && (fill_buf == mru) &&
+                         (line_tag[mru] + 1'b1 == next_line) &&
+                         !(line_live[victim] && line_tag[victim] == next_line);
+    
+    // Line the engine is filling, as a byte address, zero-extended to the
+    // 3-byte command address for windows smaller than 16 MB
+    wire [ADDR_BITS-1:0] line_addr = {line_tag[fill_buf], {LINE_SHIFT{1'b0}}};
+    wire [23:0] fill_addr = line_addr;
+    
+    wire streaming = (state == X_CMD) || (state == X_DUMMY) || (state == X_DATA);
+    
+    assign active = (state != X_IDLE) || session_open;
+    assign frame_size = (state == X_DUMMY) ? 2'b00 : 2'b11;
+    assign cs_hold = streaming || (state == X_IDLE && session_open);
+    
+    assign tx_push = streaming && (push_left != 0) && (inflight < FIFO_DEPTH);
+    assign tx_data = (state == X_CMD) ? {read_cmd, fill_addr} : 32'hFFFF_FFFF;
+    assign rx_pop = streaming && (pop_left != 0) && !rx_empty;
+    
+    always @(posedge clk or posedge reset) begin
+        if (reset) begin
+            state <= X_IDLE;
+            line_tag[0] <= 0;
+            line_tag[1] <= 0;
+            line_live <= 2'b00;
+            word_valid <= 0;
+            mru <= 1'b0;
+            fill_buf <= 1'b0;
+            fill_word <= 0;
+            session_open <= 1'b0;
+            next_line <= 0;
+            push_left <= 5'd0;
+            pop_left <= 5'd0;
+            inflight <= 8'h0;
+            gap_count <= 3'd0;
+        end else begin
+            if (hit) begin
+                mru <= match1;
+            end
+            
+            if (tx_push) begin
+                push_left <= push_left - 1;
+            end
+            if (rx_pop) begin
+                pop_left <= pop_left - 1;
+            end
+            case ({tx_push, rx_pop})
+                2'b10: inflight <= inflight + 1;
+                2'b01: inflight <= inflight - 1;
+                default: ;
+            endcase
+            
+            case (state)
+                X_IDLE: begin
+                    if (!enable) begin
+                        // Drop the buffers and end any open session
+                        line_live <= 2'b00;
+                        word_valid <= 0;
+                        if (session_open) begin
+                            session_open <= 1'b0;
+                            gap_count <= CS_GAP;
+                            state <= X_CLOSE;
+                        end
+                    end else if (miss || want_prefetch) begin
+                        line_tag[victim] <= miss ? req_line : next_line;
+                        line_live[victim] <= 1'b1;
+                        word_valid[victim*LINE_WORDS +: LINE_WORDS] <= 0;
+                        fill_buf <= victim;
+                        fill_word <= 0;
+                        
+                        if (session_open && (!miss || req_line == next_line)) begin
+                            // Sequential: keep streaming the open command
+                            push_left <= LINE_WORDS;
+                            pop_left <= LINE_WORDS;
+                            state <= X_DATA;
+                        end else if (session_open) begin
+                            session_open <= 1'b0;
+                            gap_count <= CS_GAP;
+                            state <= X_CLOSE;
+                        end else begin
+                            push_left <= 5'd1;
+                            pop_left <= 5'd1;
+                            state <= X_CMD;
+                        end
+                    end
+                end
+                
+                X_CLOSE: begin
+                    // CS is released while the master sits idle
+                    if (gap_count != 0) begin
+                        gap_count <= gap_count - 1;
+                    end else if (enable && line_live[fill_buf]) begin
+                        push_left <= 5'd1;
+                        pop_left <= 5'd1;
+                        state <= X_CMD;
+                    end else begin
+                        state <= X_IDLE;
+                    end
+                end
+                
+                X_CMD: begin
+                    // Command byte and 3-byte address in one frame
+                    if (rx_pop && pop_left == 1) begin
+                        if (dummy_bytes != 0) begin
+                            push_left <= {1'b0, dummy_bytes};
+                            pop_left <= {1'b0, dummy_bytes};
+                            state <= X_DUMMY;
+                        end else begin
+                            push_left <= LINE_WORDS;
+                            pop_left <= LINE_WORDS;
+                            state <= X_DATA;
+                        end
+                    end
+                end
+                
+                X_DUMMY: begin
+                    // Byte frames; the master is idle between phases, so the
+                    // frame size only changes with no frame in flight
+                    if (rx_pop && pop_left == 1) begin
+                        push_left <= LINE_WORDS;
+                        pop_left <= LINE_WORDS;
+                        state <= X_DATA;
+                    end
+                end
+                
+                X_DATA: begin
+                    if (rx_pop) begin
+                        // Flash bytes arrive in address order, MSB first;
+                        // store them little-endian for the CPU
+                        line_data[{fill_buf, fill_word}] <= {rx_data[7:0], rx_data[15:8],
+                                                             rx_data[23:16], rx_data[31:24]};
+                        word_valid[{fill_buf, fill_word}] <= 1'b1;
+                        fill_word <= fill_word + 1;
+                        
+                        if (pop_left == 1) begin
+                            session_open <= 1'b1;
+                            next_line <= line_tag[fill_buf] + 1'b1;
+                            state <= X_IDLE;
+                        end
+                    end
+                end
+                
+                default: begin
+                    state <= X_IDLE;
+                end
             endcase
         end
     end
     
 endmodule
+
+// SPI Trace Buffer
+// Ring of timestamped events for field debugging. Each entry is two words:
+// {kind, 28-bit cycle stamp} then the payload. FRAME events carry the low
+// TX and RX bytes of each completed frame and both FIFO levels, CS events
+// the chip select lines after a change, and STALL events the stall reason
+// vector whenever it changes (underrun and overrun are one-cycle pulses).
+// Events waiting for the single write port are held one per kind; a second
+// event of a kind still waiting is dropped and flagged as lost. CLEAR
+// restarts the stamp and records the current CS and stall state, so every
+// dump starts from a known level. When the ring is full new entries replace
+// the oldest (WRAPPED), or with ONESHOT recording stops (LOST).
+//
+// Readout pops through one register: the first read of an entry returns
+// the stamp word, the second the payload. The buffer is a synchronous-read
+// RAM so it maps to block RAM; tracing should be stopped before a dump, as
+// a wrapping writer may replace the entry being read.
+module spi_trace #(
+    parameter DEPTH = 64                 // Entries, a power of two (2-32768)
+)(
+    input wire clk,
+    input wire reset,
+    input wire enable,
+    input wire clear,
+    input wire oneshot,
+    input wire [2:0] mask,               // Recorded kinds: STALL, CS, FRAME
+    input wire frame_done,
+    input wire [31:0] frame_info,
+    input wire [3:0] cs_n,
+    input wire [4:0] stall,
+    input wire pop,                      // One TRACE_DATA read
+    output wire [31:0] rdata,
+    output reg [15:0] count,
+    output reg wrapped,
+    output reg lost
+);
+
+    localparam PTR_BITS = $clog2(DEPTH);
+    localparam [3:0] KIND_FRAME = 4'd1;
+    localparam [3:0] KIND_CS    = 4'd2;
+    localparam [3:0] KIND_STALL = 4'd3;
+    
+    reg [63:0] mem [0:DEPTH-1];
+    reg [63:0] rd_q;
+    reg rd_half;                         // Stamp word already read
+    reg [PTR_BITS-1:0] wr_ptr;
+    reg [PTR_BITS-1:0] rd_ptr;
+    reg [27:0] stamp;
+    reg [3:0] cs_q;
+    reg [2:0] stall_q;
+    
+    // Pending entries, one per kind: {STALL, CS, FRAME}
+    reg [2:0] pend;
+    reg [63:0] frame_entry;
+    reg [63:0] cs_entry;
+    reg [63:0] stall_entry;
+    
+    wire [2:0] event_hit = {stall[2:0] != stall_q || stall[4:3] != 2'b00,
+                            cs_n != cs_q, frame_done} & mask & {3{enable}};
+    
+    // CS first, then STALL, then FRAME: state changes keep their order
+    wire [2:0] grant = pend[1] ? 3'b010 : pend[2] ? 3'b100 : pend[0] ? 3'b001 : 3'b000;
+    wire [63:0] wr_entry = pend[1] ? cs_entry : pend[2] ? stall_entry : frame_entry;
+    wire [2:0] slot_free = ~(pend & ~grant);
+    wire [2:0] event_take = event_hit & slot_free;
+    
+    wire full = (count == DEPTH);
+    wire entry_pop = pop && rd_half && count != 0;
+    wire do_write = (pend != 3'b000) && !(full && oneshot);
+    wire drop_oldest = do_write && full && !entry_pop;
+    wire [PTR_BITS-1:0] rd_next = clear ? {PTR_BITS{1'b0}} :
+                                  (entry_pop || drop_oldest) ? rd_ptr + 1'b1 : rd_ptr;
+    
+    assign rdata = (count == 0) ? 32'h0 : rd_half ? rd_q[31:0] : rd_q[63:32];
+    
+    always @(posedge clk) begin
+        if (do_write && !clear) begin
+            mem[wr_ptr] <= wr_entry;
+        end
+        rd_q <= mem[rd_next];
+    end
+    
+    always @(posedge clk or posedge reset) begin
+        if (reset) begin
+            count <= 16'h0;
+            wrapped <= 1'b0;
+            lost <= 1'b0;
+            rd_half <= 1'b0;
+            wr_ptr <= {PTR_BITS{1'b0}};
+            rd_ptr <= {PTR_BITS{1'b0}};
+            stamp <= 28'h0;
+            cs_q <= 4'hF;
+            stall_q <= 3'b000;
+            pend <= 3'b000;
+            frame_entry <= 64'h0;
+            cs_entry <= 64'h0;
+            stall_entry <= 64'h0;
+        end else begin
+            cs_q <= cs_n;
+            stall_q <= stall[2:0];
+            
+            if (clear) begin
+                count <= 16'h0;
+                wrapped <= 1'b0;
+                lost <= 1'b0;
+                rd_half <= 1'b0;
+                wr_ptr <= {PTR_BITS{1'b0}};
+                rd_ptr <= {PTR_BITS{1'b0}};
+                stamp <= 28'h0;
+                pend <= {mask[2:1] & {2{enable}}, 1'b0};
+                cs_entry <= {KIND_CS, 28'h0, 28'h0, cs_n};
+                stall_entry <= {KIND_STALL, 28'h0, 27'h0, stall};
+            end else begin
+                if (enable) begin
+                    stamp <= stamp + 1'b1;
+                end
+                
+                // Write port
+                if (do_write) begin
+                    wr_ptr <= wr_ptr + 1'b1;
+                end
+                if (drop_oldest) begin
+                    wrapped <= 1'b1;
+                end
+                if ((pend != 3'b000) && full && oneshot) begin
+                    lost <= 1'b1;
+                end
+                
+                // Read port
+                if (entry_pop || drop_oldest) begin
+                    rd_ptr <= rd_ptr + 1'b1;
+                end
+                if (drop_oldest) begin
+                    rd_half <= 1'b0;
+                end else if (pop && count != 0) begin
+                    rd_half <= !rd_half;
+                end
+                
+                count <= count + (do_write && !drop_oldest) - entry_pop;
+                
+                // New events take their slot once the old entry has gone
+                if ((event_hit & ~slot_free) != 3'b000) begin
+                    lost <= 1'b1;
+                end
+                pend <= (pend & ~grant) | event_hit;
+                if (event_take[0]) begin
+                    frame_entry <= {KIND_FRAME, stamp, frame_info};
+                end
+                if (event_take[1]) begin
+                    cs_entry <= {KIND_CS, stamp, 28'h0, cs_n};
+                end
+                if (event_take[2]) begin
+                    stall_entry <= {KIND_STALL, stamp, 27'h0, stall};
+                end
+            end
+        end
+    end
+    
+endmodule
@@ -1,9 +1,36 @@
 // SPI Master Module
 // Implements SPI master functionality with configurable modes
+// Frames are 8, 16, 24 or 32 bits, shifted MSB first; FIFO entries and
+// data_tx/data_rx hold one frame right-aligned in a 32-bit word.
+// Frames shift over 1, 2 or 4 data lanes (IO0-IO3). Single-lane frames
+// are full duplex on IO0 (MOSI) / IO1 (MISO); dual and quad frames are
+// half duplex, with lane_in selecting whether the master drives the
+// lanes or samples them. IO2/IO3 idle high (WP#/HOLD#) outside quad frames.
+// CS opens a window at the first frame and closes once the TX FIFO drains,
+// or after auto_cs_count frames when auto_cs_en is set. Programmable setup,
+// hold and inter-frame gap cycles are inserted around frames in a window.
+// SCK half periods last clk_div + clk_frac/256 clock cycles on average
+// (clk_div >= 1, so SCK can run at clk/2). With sck_fast set SCK instead
+// runs at the full clock rate: data launches on every rising clk edge
+// and SCK is phased so the device samples half a cycle later. The mode is
+// taken from sck_fast only while CS is deasserted. SCK leaves through a
+// DDR output register (sck_ddr_out) in both modes, so the clock never
+// passes through logic on its way to the pin. sample_delay moves the receive sample that many cycles later to
+// cover the round trip through pads and the device at high SCK rates.
+// fill_load queues fill_frames frames of fill_data behind the TX FIFO
+// contents, so read phases need no TX FIFO writes; a fill frame waits for
+// RX FIFO space (CS stays asserted meanwhile) unless rx_discard is set,
+// which keeps received frames out of the RX FIFO for write-only phases.
+// Once IDLE has settled the state machine registers are held until a wake
+// condition (start, TX data, a fill load, a CPOL or CS change), and each
+// FIFO only updates on a push or pop. CLOCK_GATING=0 does this with clock
+// enables; 1 stops the clock of those registers through clock_gate.
 
 module spi_master #(
     parameter CLK_DIV_WIDTH = 8,
-    parameter FIFO_DEPTH = 8
+    parameter FIFO_DEPTH = 8,
+    parameter CLOCK_GATING = 0,
+    parameter SCK_IO = 0           // SCK pad register: 0 behavioural, 1 iCE40 SB_IO
 )(
     // Clock and Reset
     input wire clk,
@@ -11,15 +38,33 @@ module spi_master #(
     
     // Control Interface
     input wire start,
-    input wire [7:0] data_tx,
+    input wire [31:0] data_tx,
     input wire [1:0] cpol_cpha,    // {CPOL, CPHA}
+    input wire [1:0] frame_size,   // Frame width: 0=8, 1=16, 2=24, 3=32 bits
+    input wire [1:0] lanes,        // Data lanes: 0=single, 1=dual, 2/3=quad
+    input wire lane_in,            // Dual/quad frames: 1=sample lanes, 0=drive them
     input wire [CLK_DIV_WIDTH-1:0] clk_div,
-    input wire cs_polarity,        // 0=active low, 1=active high
+    input wire [7:0] clk_frac,     // Fractional half period, 1/256 cycles
+    input wire sck_fast,           // SCK at the clock rate (clk_div ignored)
+    input wire [3:0] sample_delay, // Receive sample delay in clock cycles
+    input wire [3:0] cs_polarity,  // Per line: 0=active low, 1=active high
     input wire [1:0] cs_select,    // Chip select lines
+    input wire cs_hold,            // Keep CS asserted while idle
+    input wire auto_cs_en,         // Hold CS across auto_cs_count frames
+    input wire [15:0] auto_cs_count, // Frames per CS window (0 = until drained)
+    input wire [7:0] cs_setup_cycles,  // CS assert to first SCK edge
+    input wire [7:0] cs_hold_cycles,   // Last frame to CS deassert
+    input wire [7:0] frame_gap_cycles, // Idle cycles between frames
     input wire loopback,           // Loopback mode for testing
+    input wire fill_load,          // Load fill_frames into the fill count
+    input wire [15:0] fill_frames,
+    input wire [31:0] fill_data,   // Frame sent for each fill frame
+    input wire rx_discard,         // Do not store received frames
+    output reg [15:0] fill_left,   // Fill frames not yet started
     
     // Status Outputs
-    output reg [7:0] data_rx,
+    output reg [31:0] data_rx,
+    output reg [31:0] tx_frame,    // Frame being shifted out, right-aligned
     output reg busy,
     output reg done,
     output reg error,
@@ -29,18 +74,23 @@ module spi_master #(
     output wire tx_fifo_empty,
     output wire rx_fifo_full,
     output wire rx_fifo_empty,
+    output wire [$clog2(FIFO_DEPTH+1)-1:0] tx_fifo_level,
+    output wire [$clog2(FIFO_DEPTH+1)-1:0] rx_fifo_level,
+    output wire tx_underrun,       // Frame ended under cs_hold with no next frame
+    output wire rx_overrun,        // Received frame dropped on a full RX FIFO
     
     // SPI Physical Interface
-    output reg sck,
-    output reg mosi,
-    input wire miso,
-    output reg [3:0] cs_n,
+    output wire sck,
+    output reg [3:0] sio_o,        // IO0-IO3 output values
+    output wire [3:0] sio_oe,      // IO0-IO3 output enables
+    input wire [3:0] sio_i,        // IO0-IO3 pin values
+    output wire [3:0] cs_n,
     
     // FIFO Interface
     input wire fifo_write_en,
-    input wire [7:0] fifo_data_in,
+    input wire [31:0] fifo_data_in,
     input wire fifo_read_en,
-    output wire [7:0] fifo_data_out,
+    output wire [31:0] fifo_data_out,
     
     // Interrupt
     output reg irq
@@ -48,34 +98,98 @@ module spi_master #(
 
     // Internal signals
     reg [CLK_DIV_WIDTH-1:0] clk_counter;
-    reg [3:0] bit_counter;
-    reg [7:0] shift_tx;
-    reg [7:0] shift_rx;
+    reg [5:0] bit_counter;
+    reg [31:0] shift_tx;
+    reg [31:0] shift_rx;
     reg sck_int;
     reg last_sck;
+    reg sck_reg;
+    reg sck_fast_en;               // Full-rate SCK pulse this cycle
+    reg fast_mode;                 // sck_fast, sampled while CS is deasserted
+    reg [7:0] frac_acc;            // Fractional divider phase
+    reg sck_stretch;               // Current half period is one cycle longer
+    reg [3:0] rx_wait;             // Cycles until a delayed sample
+    reg [5:0] rx_bits;             // Bits captured in fast mode
+    reg reg_frame;                 // Frame started from data_tx, not a FIFO
+    
+    // A delayed sample must land before the next SCK edge
+    wire [3:0] rx_dly = (sample_delay >= clk_div) ? clk_div - 1 : sample_delay;
+    
+    // CS window
+    reg cs_asserted;
+    reg [15:0] frames_left;        // Frames left in a counted window
+    reg [7:0] wait_count;          // Setup/gap/hold cycles left
+    
+    assign cs_n = cs_asserted ? (~(4'b0001 << cs_select) ^ cs_polarity)
+                              : (4'b1111 ^ cs_polarity);
+    
+    // A counted window stays open while it has frames left
+    wire window_counted = auto_cs_en && (frames_left != 0);
+    wire window_last = auto_cs_en && (frames_left == 1);
+    
+    // Frame geometry: bits per frame, and the left shift that puts the
+    // frame MSB at shift_tx[31]
+    wire [5:0] frame_bits = {frame_size + 3'd1, 3'b000};
+    wire [4:0] frame_align = {~frame_size, 3'b000};
+    
+    // TX sources: the FIFO first, then fill frames. A fill frame needs RX
+    // FIFO room for what it will receive; while it waits CS stays asserted.
+    wire fill_ready = (fill_left != 0) && (rx_discard || !rx_fifo_full);
+    wire fill_hold = (fill_left != 0);
+    wire tx_avail = !tx_fifo_empty || fill_ready;
+    
+    // Lane geometry
+    wire quad = lanes[1];
+    wire dual = (lanes == 2'b01);
+    
+    // IO0 is MOSI and IO1 MISO in single mode; WP#/HOLD# stay driven high
+    // unless a quad frame owns them
+    assign sio_oe = quad ? (lane_in ? 4'b0000 : 4'b1111) :
+                    dual ? (lane_in ? 4'b1100 : 4'b1111) :
+                           4'b1101;
+    
+    // Next lane values and shift register contents for one SCK period.
+    // Outputs always follow shift_tx so loopback returns the sent frame
+    // whether or not the lanes are enabled.
+    wire [3:0] sio_next = quad ? shift_tx[31:28] :
+                          dual ? {2'b11, shift_tx[31:30]} :
+                                 {2'b11, 1'b0, shift_tx[31]};
+    wire [31:0] shift_tx_next = quad ? {shift_tx[27:0], 4'b0000} :
+                                dual ? {shift_tx[29:0], 2'b00} :
+                                       {shift_tx[30:0], 1'b0};
+    wire [3:0] rx_lanes = loopback ? sio_o : sio_i;
+    wire rx_bit = loopback ? sio_o[0] : sio_i[1];
+    wire [31:0] shift_rx_next = quad ? {shift_rx[27:0], rx_lanes} :
+                                dual ? {shift_rx[29:0], rx_lanes[1:0]} :
+                                       {shift_rx[30:0], rx_bit};
+    wire [5:0] lane_step = quad ? 6'd4 : dual ? 6'd2 : 6'd1;
     
     // FIFO signals
-    wire [7:0] tx_fifo_out;
+    wire [31:0] tx_fifo_out;
     wire tx_fifo_read_en;
     wire tx_fifo_write_en;
     wire rx_fifo_write_en;
     
     // State machine
-    typedef enum logic [2:0] {
-        IDLE        = 3'b000,
-        LOAD_DATA   = 3'b001,
-        TRANSFER    = 3'b010,
-        SAMPLE      = 3'b011,
-        COMPLETE    = 3'b100,
-        ERROR_STATE = 3'b101
+    typedef enum logic [3:0] {
+        IDLE        = 4'b0000,
+        LOAD_DATA   = 4'b0001,
+        TRANSFER    = 4'b0010,
+        SAMPLE      = 4'b0011,
+        COMPLETE    = 4'b0100,
+        ERROR_STATE = 4'b0101,
+        CS_SETUP    = 4'b0110,
+        FRAME_GAP   = 4'b0111,
+        CS_END      = 4'b1000
     } state_t;
     
-    state_t current_state, next_state;
+    state_t current_state;
     
     // FIFO Instances
     fifo #(
-        .WIDTH(8),
-        .DEPTH(FIFO_DEPTH)
+        .WIDTH(32),
+        .DEPTH(FIFO_DEPTH),
+        .CLOCK_GATING(CLOCK_GATING)
     ) tx_fifo (
         .clk(clk),
         .reset(reset),
@@ -84,117 +198,297 @@ module spi_master #(
         .read_en(tx_fifo_read_en),
         .data_out(tx_fifo_out),
         .full(tx_fifo_full),
-        .empty(tx_fifo_empty)
+        .empty(tx_fifo_empty),
+        .level(tx_fifo_level)
     );
     
     fifo #(
-        .WIDTH(8),
-        .DEPTH(FIFO_DEPTH)
+        .WIDTH(32),
+        .DEPTH(FIFO_DEPTH),
+        .CLOCK_GATING(CLOCK_GATING)
     ) rx_fifo (
         .clk(clk),
         .reset(reset),
         .write_en(rx_fifo_write_en),
-        .data_in(data_rx),
+        .data_in(shift_rx),
         .read_en(fifo_read_en),
         .data_out(fifo_data_out),
         .full(rx_fifo_full),
-        .empty(rx_fifo_empty)
+        .empty(rx_fifo_empty),
+        .level(rx_fifo_level)
     );
     
     // FIFO control
     assign tx_fifo_write_en = fifo_write_en;
     assign tx_fifo_read_en = (current_state == LOAD_DATA) && !tx_fifo_empty;
-    assign rx_fifo_write_en = (current_state == COMPLETE) && done;
+    assign rx_fifo_write_en = (current_state == COMPLETE) && !rx_discard;
+    
+    // Event pulses for the controller performance counters
+    assign tx_underrun = (current_state == COMPLETE) && tx_fifo_empty && !fill_hold &&
+                         (cs_hold || (window_counted && !window_last));
+    // A frame started from data_tx is read back through data_rx, so its RX
+    // FIFO copy is dropped silently when the FIFO is full
+    assign rx_overrun = (current_state == COMPLETE) && !rx_discard && rx_fifo_full &&
+                        !fifo_read_en && !reg_frame;
+    
+    // Idle gating. A cycle in IDLE that neither leaves it nor finds the
+    // idle outputs out of date assigns every register its current value,
+    // so those cycles are skipped: the first IDLE cycle (idle_settled
+    // clear) and the one after it (last_sck catching up) still run, then
+    // only a wake term below clocks the state machine again.
+    reg idle_settled;
+    wire cs_idle = (cs_hold || fill_hold) ? 1'b1 : window_counted ? cs_asserted : 1'b0;
+    wire fsm_run = (current_state != IDLE) || !idle_settled || start || tx_avail ||
+                   fill_load || (sck_reg != cpol_cpha[1]) || (last_sck != sck_int) ||
+                   (cs_asserted != cs_idle);
+    wire fsm_clk;
+    
+    clock_gate #(
+        .ENABLE(CLOCK_GATING)
+    ) fsm_gate (
+        .clk(clk),
+        .en(fsm_run),
+        .gclk(fsm_clk)
+    );
+    
+    // On divided clocks SCK is sck_reg for the whole cycle. A fast-mode
+    // beat is one clock-rate SCK period, inverted for modes 0 and 3, so it
+    // starts with a launch edge on the rising clk edge and the device
+    // samples on the falling one. The pad register takes the first half of
+    // a cycle at the rising edge that starts it, so that half comes from
+    // the next-state values of sck_fast_en and sck_reg; the second half is
+    // taken at the falling edge from their current values.
+    wire sck_edge = (clk_counter == (clk_div - 1) + sck_stretch);
+    wire sck_fast_next = (current_state == TRANSFER) && fast_mode &&
+                         (bit_counter != frame_bits);
+    wire sck_reg_next = (current_state == IDLE) ? cpol_cpha[1] :
+                        ((current_state == TRANSFER) && !fast_mode && sck_edge) ?
+                        sck_int : sck_reg;
+    wire sck_rise = sck_fast_next ? (cpol_cpha[1] ^ cpol_cpha[0]) : sck_reg_next;
+    wire sck_fall = sck_fast_en ? (cpol_cpha[1] ~^ cpol_cpha[0]) : sck_reg;
+    
+    sck_ddr_out #(
+        .SB_IO_CELL(SCK_IO)
+    ) sck_out (
+        .clk(clk),
+        .d_rise(sck_rise),
+        .d_fall(sck_fall),
+        .pad(sck)
+    );
     
     // Main state machine
-    always @(posedge clk or posedge reset) begin
+    always @(posedge fsm_clk or posedge reset) begin
         if (reset) begin
             current_state <= IDLE;
-            sck <= 1'b0;
-            mosi <= 1'b0;
-            cs_n <= 4'b1111;
+            sck_reg <= 1'b0;
+            sck_fast_en <= 1'b0;
+            fast_mode <= 1'b0;
+            frac_acc <= 8'h0;
+            sck_stretch <= 1'b0;
+            rx_wait <= 4'h0;
+            rx_bits <= 6'h0;
+            sio_o <= 4'b1100;
+            cs_asserted <= 1'b0;
+            frames_left <= 16'h0;
+            fill_left <= 16'h0;
+            wait_count <= 8'h0;
             busy <= 1'b0;
             done <= 1'b0;
             error <= 1'b0;
             irq <= 1'b0;
             clk_counter <= 0;
             bit_counter <= 0;
-            shift_tx <= 8'h00;
-            shift_rx <= 8'h00;
+            shift_tx <= 32'h0;
+            shift_rx <= 32'h0;
+            data_rx <= 32'h0;
+            tx_frame <= 32'h0;
+            reg_frame <= 1'b0;
             sck_int <= 1'b0;
             last_sck <= 1'b0;
-        end else begin
-            current_state <= next_state;
+            idle_settled <= 1'b0;
+        end else if (fsm_run) begin
             last_sck <= sck_int;
             
             case (current_state)
                 IDLE: begin
                     sck_int <= cpol_cpha[1]; // Set idle state based on CPOL
-                    sck <= cpol_cpha[1];
-                    mosi <= 1'b0;
-                    cs_n <= 4'b1111 ^ {4{cs_polarity}}; // Invert if active high
+                    sck_reg <= cpol_cpha[1];
+                    sck_fast_en <= 1'b0;
+                    sio_o <= 4'b1100;
+                    // SCK changes mode only between CS windows
+                    if (!cs_asserted) begin
+                        fast_mode <= sck_fast;
+                    end
+                    // Close the window unless software holds CS, a fill is
+                    // waiting for RX room or a counted window still
+                    // expects frames
+                    if (cs_hold || fill_hold) begin
+                        cs_asserted <= 1'b1;
+                    end else if (!window_counted) begin
+                        cs_asserted <= 1'b0;
+                    end
                     busy <= 1'b0;
                     done <= 1'b0;
                     error <= 1'b0;
                     irq <= 1'b0;
                     clk_counter <= 0;
                     bit_counter <= 0;
+                    idle_settled <= 1'b1;
                     
-                    if (start || !tx_fifo_empty) begin
-                        next_state <= LOAD_DATA;
+                    if (start || tx_avail) begin
+                        idle_settled <= 1'b0;
+                        cs_asserted <= 1'b1;
+                        if (!cs_asserted) begin
+                            // New window: arm the frame count, then setup time
+                            frames_left <= auto_cs_count;
+                            wait_count <= cs_setup_cycles;
+                            current_state <= (cs_setup_cycles != 0) ? CS_SETUP : LOAD_DATA;
+                        end else begin
+                            current_state <= LOAD_DATA;
+                        end
+                    end
+                end
+                
+                CS_SETUP: begin
+                    busy <= 1'b1;
+                    if (wait_count <= 1) begin
+                        current_state <= LOAD_DATA;
+                    end else begin
+                        wait_count <= wait_count - 1;
+                    end
+                end
+                
+                FRAME_GAP: begin
+                    done <= 1'b0;
+                    if (wait_count <= 1) begin
+                        current_state <= LOAD_DATA;
+                    end else begin
+                        wait_count <= wait_count - 1;
+                    end
+                end
+                
+                CS_END: begin
+                    // Hold time, then release CS
+                    done <= 1'b0;
+                    if (wait_count <= 1) begin
+                        cs_asserted <= 1'b0;
+                        current_state <= IDLE;
+                    end else begin
+                        wait_count <= wait_count - 1;
                     end
                 end
                 
                 LOAD_DATA: begin
-                    // Activate chip select
-                    cs_n <= ~(1 << cs_select) ^ {4{cs_polarity}};
+                    cs_asserted <= 1'b1;
                     busy <= 1'b1;
+                    done <= 1'b0;
+                    
+                    // Restart the bit clock for every frame so FIFO reloads
+                    // from COMPLETE shift a full frame in the right phase
+                    sck_int <= cpol_cpha[1];
+                    sck_fast_en <= 1'b0;
+                    clk_counter <= 0;
+                    bit_counter <= 0;
+                    rx_bits <= 0;
+                    rx_wait <= 0;
+                    frac_acc <= 8'h0;
+                    sck_stretch <= 1'b0;
+                    shift_rx <= 32'h0;
                     
                     if (!tx_fifo_empty) begin
-                        shift_tx <= tx_fifo_out;
-                        next_state <= TRANSFER;
+                        shift_tx <= tx_fifo_out << frame_align;
+                        tx_frame <= tx_fifo_out;
+                        reg_frame <= 1'b0;
+                        current_state <= TRANSFER;
+                    end else if (fill_ready) begin
+                        shift_tx <= fill_data << frame_align;
+                        tx_frame <= fill_data;
+                        reg_frame <= 1'b0;
+                        fill_left <= fill_left - 1;
+                        current_state <= TRANSFER;
                     end else if (start) begin
-                        shift_tx <= data_tx;
-                        next_state <= TRANSFER;
+                        shift_tx <= data_tx << frame_align;
+                        tx_frame <= data_tx;
+                        reg_frame <= 1'b1;
+                        current_state <= TRANSFER;
                     end else begin
-                        next_state <= IDLE;
+                        current_state <= IDLE;
                     end
                 end
                 
                 TRANSFER: begin
                     clk_counter <= clk_counter + 1;
                     
-                    // Generate SCK
-                    if (clk_counter == (clk_div - 1)) begin
-                        clk_counter <= 0;
-                        sck_int <= ~sck_int;
-                        sck <= sck_int;
+                    if (fast_mode) begin
+                        // One beat per clock; beat n is captured at the end
+                        // of cycle n + sample_delay
+                        if (bit_counter != frame_bits) begin
+                            sio_o <= sio_next;
+                            shift_tx <= shift_tx_next;
+                            bit_counter <= bit_counter + lane_step;
+                            sck_fast_en <= 1'b1;
+                        end else begin
+                            sck_fast_en <= 1'b0;
+                        end
                         
-                        // Data handling based on CPHA
-                        if (cpol_cpha[0] == 0) begin // CPHA=0
-                            if (sck_int == cpol_cpha[1]) begin
-                                // Output data on first edge
-                                mosi <= shift_tx[7];
-                                shift_tx <= {shift_tx[6:0], 1'b0};
-                            end else begin
-                                // Sample data on second edge
-                                shift_rx <= {shift_rx[6:0], (loopback ? mosi : miso)};
-                                bit_counter <= bit_counter + 1;
+                        if (clk_counter > sample_delay) begin
+                            shift_rx <= shift_rx_next;
+                            rx_bits <= rx_bits + lane_step;
+                            if (rx_bits + lane_step == frame_bits) begin
+                                current_state <= COMPLETE;
                             end
-                        end else begin // CPHA=1
-                            if (sck_int == cpol_cpha[1]) begin
-                                // Sample data on first edge
-                                shift_rx <= {shift_rx[6:0], (loopback ? mosi : miso)};
-                                bit_counter <= bit_counter + 1;
-                            end else begin
-                                // Output data on second edge
-                                mosi <= shift_tx[7];
-                                shift_tx <= {shift_tx[6:0], 1'b0};
+                        end
+                    end else begin
+                        // Delayed receive sample
+                        if (rx_wait != 0) begin
+                            rx_wait <= rx_wait - 1;
+                            if (rx_wait == 1) begin
+                                shift_rx <= shift_rx_next;
                             end
                         end
                         
-                        if (bit_counter == 8) begin
-                            next_state <= COMPLETE;
+                        // Generate SCK; the fractional phase stretches
+                        // some half periods by one cycle
+                        if (sck_edge) begin
+                            clk_counter <= 0;
+                            sck_int <= ~sck_int;
+                            sck_reg <= sck_int;
+                            {sck_stretch, frac_acc} <= frac_acc + clk_frac;
+                            
+                            // Data handling based on CPHA
+                            if (cpol_cpha[0] == 0) begin // CPHA=0
+                                if (sck_int == cpol_cpha[1]) begin
+                                    // Output data on first edge
+                                    sio_o <= sio_next;
+                                    shift_tx <= shift_tx_next;
+                                end else begin
+                                    // Sample data on second edge
+                                    if (rx_dly == 0) begin
+                                        shift_rx <= shift_rx_next;
+                                    end else begin
+                                        rx_wait <= rx_dly;
+                                    end
+                                    bit_counter <= bit_counter + lane_step;
+                                end
+                            end else begin // CPHA=1
+                                if (sck_int == cpol_cpha[1]) begin
+                                    // Sample data on first edge
+                                    if (rx_dly == 0) begin
+                                        shift_rx <= shift_rx_next;
+                                    end else begin
+                                        rx_wait <= rx_dly;
+                                    end
+                                    bit_counter <= bit_counter + lane_step;
+                                end else begin
+                                    // Output data on second edge
+                                    sio_o <= sio_next;
+                                    shift_tx <= shift_tx_next;
+                                end
+                            end
+                            
+                            if (bit_counter == frame_bits) begin
+                                current_state <= COMPLETE;
+                            end
                         end
                     end
                 end
@@ -204,37 +498,53 @@ module spi_master #(
                     done <= 1'b1;
                     irq <= 1'b1;
                     
-                    if (!tx_fifo_empty) begin
-                        next_state <= LOAD_DATA;
+                    if (window_counted) begin
+                        frames_left <= frames_left - 1;
+                    end
+                    
+                    // Back-to-back burst: reload straight from the TX FIFO
+                    // without returning to IDLE, keeping CS asserted. A
+                    // window ends once the FIFO drains or its count is used
+                    // up, unless software holds CS.
+                    // LOAD_DATA rechecks RX room for a fill frame once
+                    // this frame has been stored
+                    if ((!tx_fifo_empty || fill_hold) && !window_last) begin
+                        wait_count <= frame_gap_cycles;
+                        current_state <= (frame_gap_cycles != 0) ? FRAME_GAP : LOAD_DATA;
+                    end else if (cs_hold || fill_hold || (window_counted && !window_last)) begin
+                        current_state <= IDLE;
                     end else begin
-                        next_state <= IDLE;
+                        wait_count <= cs_hold_cycles;
+                        current_state <= CS_END;
                     end
                 end
                 
                 ERROR_STATE: begin
                     error <= 1'b1;
                     irq <= 1'b1;
-                    next_state <= IDLE;
+                    current_state <= IDLE;
                 end
                 
                 default: begin
-                    next_state <= IDLE;
+                    current_state <= IDLE;
                 end
             endcase
+            
+            // A new fill count replaces whatever was left
+            if (fill_load) begin
+                fill_left <= fill_frames;
+            end
         end
     end
     
-    // Continuous assignment for next_state (combinational)
-    always @(*) begin
-        next_state = current_state;
-    end
-    
 endmodule
 
 // Simple FIFO module
 module fifo #(
     parameter WIDTH = 8,
-    parameter DEPTH = 8
+    parameter DEPTH = 8,
+    parameter CLOCK_GATING = 0,
+    parameter SCK_IO = 0           // SCK pad register: 0 behavioural, 1 iCE40 SB_IO
 )(
     input wire clk,
     input wire reset,
@@ -242,42 +552,142 @@ module fifo #(
     input wire [WIDTH-1:0] data_in,
     input wire read_en,
     output wire [WIDTH-1:0] data_out,
-    output reg full,
-    output reg empty
+    output wire full,
+    output wire empty,
+    output wire [$clog2(DEPTH+1)-1:0] level
 );
     
+    localparam PTR_WIDTH = (DEPTH > 1) ? $clog2(DEPTH) : 1;
+    
     reg [WIDTH-1:0] memory [0:DEPTH-1];
-    reg [3:0] write_ptr;
-    reg [3:0] read_ptr;
-    reg [3:0] count;
+    reg [PTR_WIDTH-1:0] write_ptr;
+    reg [PTR_WIDTH-1:0] read_ptr;
+    reg [$clog2(DEPTH+1)-1:0] count;
+    
+    // Qualified strobes so a push and a pop can land in the same cycle
+    wire do_write = write_en && !full;
+    wire do_read = read_en && !empty;
     
     assign data_out = memory[read_ptr];
     
-    always @(posedge clk or posedge reset) begin
+    // Flags follow the count directly so a burst producer sees FULL on the
+    // same cycle the last slot is taken
+    assign full = (count == DEPTH);
+    assign empty = (count == 0);
+    assign level = count;
+    
+    // Nothing changes without a strobe, so a gated FIFO is only clocked in
+    // cycles that push or pop
+    wire fifo_clk;
+    
+    clock_gate #(
+        .ENABLE(CLOCK_GATING)
+    ) gate (
+        .clk(clk),
+        .en(write_en || read_en),
+        .gclk(fifo_clk)
+    );
+    
+    always @(posedge fifo_clk or posedge reset) begin
         if (reset) begin
             write_ptr <= 0;
             read_ptr <= 0;
             count <= 0;
-            full <= 1'b0;
-            empty <= 1'b1;
         end else begin
             // Write operation
-            if (write_en && !full) begin
+            if (do_write) begin
                 memory[write_ptr] <= data_in;
                 write_ptr <= (write_ptr == DEPTH-1) ? 0 : write_ptr + 1;
-                count <= count + 1;
             end
             
             // Read operation
-            if (read_en && !empty) begin
+            if (do_read) begin
                 read_ptr <= (read_ptr == DEPTH-1) ? 0 : read_ptr + 1;
-                count <= count - 1;
             end
             
-            // Update flags
-            full <= (count == DEPTH);
-            empty <= (count == 0);
+            // Update occupancy
+            if (do_write && !do_read) begin
+                count <= count + 1;
+            end else if (do_read && !do_write) begin
+                count <= count - 1;
+            end
         end
     end
     
 endmodule
+
+// SCK pad register: a DDR output register clocked by clk. d_rise is taken
+// at the rising edge and drives the pad while clk is high, d_fall is taken
+// at the falling edge and drives it while clk is low. SB_IO_CELL=1 uses the
+// iCE40 SB_IO in PIN_OUTPUT_DDR mode, whose PACKAGE_PIN must reach a top
+// level port directly; 0 is the behavioural model for simulation and other
+// targets, where the output select should map onto the pad's DDR register.
+module sck_ddr_out #(
+    parameter SB_IO_CELL = 0
+)(
+    input wire clk,
+    input wire d_rise,
+    input wire d_fall,
+    output wire pad
+);
+    
+    generate
+        if (SB_IO_CELL) begin : g_sb_io
+            SB_IO #(
+                .PIN_TYPE(6'b010000),  // PIN_OUTPUT_DDR, input unused
+                .PULLUP(1'b0)
+            ) sck_io (
+                .PACKAGE_PIN(pad),
+                .CLOCK_ENABLE(1'b1),
+                .OUTPUT_CLK(clk),
+                .OUTPUT_ENABLE(1'b1),
+                .D_OUT_0(d_rise),
+                .D_OUT_1(d_fall)
+            );
+        end else begin : g_model
+            reg q_rise;
+            reg q_fall;
+            
+            always @(posedge clk) begin
+                q_rise <= d_rise;
+            end
+            
+            always @(negedge clk) begin
+                q_fall <= d_fall;
+            end
+            
+            assign pad = clk ? q_rise : q_fall;
+        end
+    endgenerate
+    
+endmodule
+
+// Clock gate: the classic latch-based integrated clock gate. The enable is
+// captured while clk is low, so gclk only ever carries whole clock pulses.
+// ASIC flows should map it onto the library ICG cell. With ENABLE=0 gclk
+// is clk and the caller's enable acts as a plain clock enable instead.
+module clock_gate #(
+    parameter ENABLE = 1
+)(
+    input wire clk,
+    input wire en,
+    output wire gclk
+);
+    
+    generate
+        if (ENABLE) begin : g_gate
+            reg en_latch;
+            
+            always @(*) begin
+                if (!clk) begin
+                    en_latch = en;
+                end
+            end
+            
+            assign gclk = clk & en_latch;
+        end else begin : g_pass
+            assign gclk = clk;
+        end
+    endgenerate
+    
+endmodule
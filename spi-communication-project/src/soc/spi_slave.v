@@ -1,18 +1,46 @@
 // SPI Slave Module
 // Implements SPI slave functionality
+// Received bytes are pushed into an RX FIFO and transmitted bytes are taken
+// from a TX FIFO (both the `fifo` module from spi_master.v), so bursts of
+// any length stream at full rate as long as the host keeps each FIFO away
+// from its limit. Watermark flags tell the host when to service them; bytes
+// lost to a full RX FIFO or sent from an empty TX FIFO are counted.
+//
+// SCK_CLOCKED selects the datapath. 0 oversamples SCK/MOSI/CS in clk, so
+// SCK must stay below about clk/4. 1 clocks the shift registers directly on
+// SCK and crosses into clk once per byte through async FIFOs, so SCK is
+// limited only by the pads. FIFO_DEPTH must then be a power of two. The
+// external master must allow 4 clk cycles from CS assert to the first SCK
+// falling edge. A first byte that finds the TX FIFO empty is sent as
+// TX_FILL; bytes queued after that go out from the next byte on.
 
-module spi_slave (
+module spi_slave #(
+    parameter FIFO_DEPTH = 16,  // RX/TX FIFO depth in bytes (1-255)
+    parameter TX_FILL = 8'hFF,  // Sent when the TX FIFO is empty
+    parameter SCK_CLOCKED = 0   // 0 = oversampled in clk, 1 = clocked on SCK
+)(
     // Clock and Reset
     input wire clk,
     input wire reset,
     
-    // Control Interface
+    // Control Interface (FIFO push/pop)
     input wire [7:0] data_tx,
-    input wire tx_valid,
-    output reg tx_ready,
-    output reg [7:0] data_rx,
-    output reg rx_valid,
-    input wire rx_read,
+    input wire tx_valid,        // Push data_tx while tx_ready
+    output wire tx_ready,       // TX FIFO has room
+    output wire [7:0] data_rx,  // RX FIFO head
+    output wire rx_valid,       // RX FIFO not empty
+    input wire rx_read,         // Pop the RX FIFO head
+    
+    // FIFO Status
+    input wire [7:0] tx_watermark,
+    input wire [7:0] rx_watermark,
+    output wire [$clog2(FIFO_DEPTH+1)-1:0] tx_level,
+    output wire [$clog2(FIFO_DEPTH+1)-1:0] rx_level,
+    output wire tx_low,         // TX level <= tx_watermark
+    output wire rx_high,        // RX level >= rx_watermark
+    output reg [31:0] rx_overflow_count,   // Bytes dropped on a full RX FIFO
+    output reg [31:0] tx_underflow_count,  // Bytes sent from an empty TX FIFO
+    input wire clear_counters,
     
     // SPI Physical Interface
     input wire sck,
@@ -24,15 +52,16 @@ module spi_slave (
     output reg busy,
     output reg error
 );
-
+    
     // Internal signals
     reg [7:0] shift_tx;
     reg [7:0] shift_rx;
     reg [2:0] bit_counter;
+    reg [2:0] tx_bit_counter;
     reg last_cs_n;
     reg last_sck;
-    reg sck_rising;
-    reg sck_falling;
+    wire sck_rising;
+    wire sck_falling;
     
     // Synchronizers for external signals
     reg cs_n_sync;
@@ -63,91 +92,676 @@ module spi_slave (
     assign sck_rising = (sck_sync && !last_sck);
     assign sck_falling = (!sck_sync && last_sck);
     
-    // Main state machine
+    // Main state machine (oversampled implementation)
     typedef enum logic [1:0] {
         IDLE        = 2'b00,
-        TRANSFER    = 2'b01,
-        COMPLETE    = 2'b10
+        TRANSFER    = 2'b01
     } state_t;
     
-    state_t current_state;
+    // Watermarks
+    assign tx_low = (tx_level <= tx_watermark);
+    assign rx_high = (rx_level >= rx_watermark);
     
-    always @(posedge clk or posedge reset) begin
-        if (reset) begin
-            current_state <= IDLE;
-            shift_tx <= 8'h00;
-            shift_rx <= 8'h00;
-            bit_counter <= 3'h0;
-            miso <= 1'b0;
-            data_rx <= 8'h00;
-            rx_valid <= 1'b0;
-            tx_ready <= 1'b1;
-            busy <= 1'b0;
-            error <= 1'b0;
-        end else begin
-            case (current_state)
-                IDLE: begin
-                    tx_ready <= 1'b1;
-                    busy <= 1'b0;
-                    error <= 1'b0;
-                    rx_valid <= 1'b0;
-                    bit_counter <= 3'h0;
-                    
-                    // Load transmit data if available
-                    if (tx_valid && tx_ready) begin
-                        shift_tx <= data_tx;
-                        tx_ready <= 1'b0;
+    generate
+    if (SCK_CLOCKED == 0) begin : g_oversampled
+        
+        state_t current_state;
+        
+        // FIFO signals
+        wire tx_fifo_full;
+        wire tx_fifo_empty;
+        wire rx_fifo_full;
+        wire rx_fifo_empty;
+        wire [7:0] tx_fifo_out;
+        wire [7:0] rx_byte = {shift_rx[6:0], mosi_sync};
+        
+        // A TX byte is taken from the FIFO on the falling edge that shifts out
+        // its first bit, so only bytes the master actually clocks are consumed
+        wire cs_start = (current_state == IDLE) && !cs_n_sync && last_cs_n;
+        wire tx_take = (current_state == TRANSFER) && sck_falling && (tx_bit_counter == 3'd0);
+        wire rx_push = (current_state == TRANSFER) && sck_rising && (bit_counter == 3'd7);
+        
+        // FIFO Instances
+        fifo #(
+            .WIDTH(8),
+            .DEPTH(FIFO_DEPTH)
+        ) tx_fifo (
+            .clk(clk),
+            .reset(reset),
+            .write_en(tx_valid),
+            .data_in(data_tx),
+            .read_en(tx_take),
+            .data_out(tx_fifo_out),
+            .full(tx_fifo_full),
+            .empty(tx_fifo_empty),
+            .level(tx_level)
+        );
+        
+        fifo #(
+            .WIDTH(8),
+            .DEPTH(FIFO_DEPTH)
+        ) rx_fifo (
+            .clk(clk),
+            .reset(reset),
+            .write_en(rx_push),
+            .data_in(rx_byte),
+            .read_en(rx_read),
+            .data_out(data_rx),
+            .full(rx_fifo_full),
+            .empty(rx_fifo_empty),
+            .level(rx_level)
+        );
+        
+        assign tx_ready = !tx_fifo_full;
+        assign rx_valid = !rx_fifo_empty;
+        
+        wire [7:0] tx_next = tx_fifo_empty ? TX_FILL : tx_fifo_out;
+        
+        always @(posedge clk or posedge reset) begin
+            if (reset) begin
+                current_state <= IDLE;
+                shift_tx <= 8'h00;
+                shift_rx <= 8'h00;
+                bit_counter <= 3'h0;
+                tx_bit_counter <= 3'h0;
+                miso <= 1'b0;
+                busy <= 1'b0;
+                error <= 1'b0;
+                rx_overflow_count <= 32'h0;
+                tx_underflow_count <= 32'h0;
+            end else begin
+                // Loss counters (a pop on the same cycle frees a slot)
+                if (clear_counters) begin
+                    rx_overflow_count <= 32'h0;
+                    tx_underflow_count <= 32'h0;
+                end else begin
+                    if (rx_push && rx_fifo_full && !rx_read) begin
+                        rx_overflow_count <= rx_overflow_count + 1;
                     end
-                    
-                    // CS falling edge starts transfer
-                    if (cs_n_sync == 0 && last_cs_n == 1) begin
-                        current_state <= TRANSFER;
-                        busy <= 1'b1;
+                    if (tx_take && tx_fifo_empty) begin
+                        tx_underflow_count <= tx_underflow_count + 1;
                     end
                 end
                 
-                TRANSFER: begin
-                    // Handle SCK edges
-                    if (sck_rising) begin
-                        // Sample MOSI on rising edge (for CPHA=0)
-                        shift_rx <= {shift_rx[6:0], mosi_sync};
-                        bit_counter <= bit_counter + 1;
-                    end
-                    
-                    if (sck_falling) begin
-                        // Output MISO on falling edge (for CPHA=0)
-                        miso <= shift_tx[7];
-                        shift_tx <= {shift_tx[6:0], 1'b0};
+                case (current_state)
+                    IDLE: begin
+                        busy <= 1'b0;
+                        bit_counter <= 3'h0;
+                        tx_bit_counter <= 3'h0;
+                        
+                        // CS falling edge starts transfer
+                        if (cs_start) begin
+                            current_state <= TRANSFER;
+                            busy <= 1'b1;
+                            error <= 1'b0;
+                        end
                     end
                     
-                    // Check for completion
-                    if (bit_counter == 8) begin
-                        current_state <= COMPLETE;
-                        data_rx <= shift_rx;
+                    TRANSFER: begin
+                        // Handle SCK edges
+                        if (sck_rising) begin
+                            // Sample MOSI on rising edge (for CPHA=0); every
+                            // eighth bit completes a byte into the RX FIFO
+                            shift_rx <= rx_byte;
+                            bit_counter <= bit_counter + 1;
+                        end
+                        
+                        if (sck_falling) begin
+                            // Output MISO on falling edge (for CPHA=0); the first
+                            // bit of each byte comes straight from the FIFO
+                            tx_bit_counter <= tx_bit_counter + 1;
+                            if (tx_take) begin
+                                miso <= tx_next[7];
+                                shift_tx <= {tx_next[6:0], 1'b0};
+                            end else begin
+                                miso <= shift_tx[7];
+                                shift_tx <= {shift_tx[6:0], 1'b0};
+                            end
+                        end
+                        
+                        // CS rising edge ends the burst; mid-byte it is an error
+                        if (cs_n_sync == 1 && last_cs_n == 0) begin
+                            current_state <= IDLE;
+                            if (bit_counter != 0) begin
+                                error <= 1'b1;
+                            end
+                        end
                     end
                     
-                    // CS rising edge aborts transfer
-                    if (cs_n_sync == 1 && last_cs_n == 0) begin
+                    default: begin
                         current_state <= IDLE;
-                        error <= 1'b1;
                     end
+                endcase
+            end
+        end
+
+    end else begin : g_sck_clocked
+        
+        // Shift registers run on SCK itself, so SCK is not limited by
+        // oversampling in clk. Each byte crosses clock domains once, through
+        // the async FIFOs below. CS high holds the bit counters in reset,
+        // so every burst starts byte-aligned.
+        localparam AW = $clog2(FIFO_DEPTH);
+        
+        wire rx_afifo_full;
+        wire rx_afifo_empty;
+        wire tx_afifo_full;
+        wire tx_afifo_empty;
+        wire [7:0] tx_afifo_out;
+        wire [AW:0] tx_rptr_seen;       // TX read pointer seen by clk
+        
+        reg [31:0] sck_rx_overflow;     // SCK domain loss counters
+        reg [31:0] sck_tx_underflow;
+        reg sck_first;                  // First TX byte of the burst
+        reg [2:0] sck_bits;             // Bits clocked in, never reset by CS
+        reg [2:0] cs_bits_start;        // sck_bits at CS assert / deassert
+        reg [2:0] cs_bits_end;
+        reg tx_freeze;
+        reg [AW:0] tx_rptr_at_cs;
+        reg [2:0] sck_started_sync;     // !sck_first in clk, and its last value
+        reg [31:0] rx_ovf_base;
+        reg [31:0] tx_unf_base;
+        reg clear_pending;
+        
+        wire [7:0] rx_byte = {shift_rx[6:0], mosi};
+        wire rx_push = !cs_n && (bit_counter == 3'd7);
+        wire tx_take = !cs_n && (tx_bit_counter == 3'd0);
+        wire [7:0] tx_next = tx_afifo_empty ? TX_FILL : tx_afifo_out;
+        
+        // Receive: sample MOSI on the rising edge (for CPHA=0)
+        always @(posedge sck or posedge cs_n) begin
+            if (cs_n) begin
+                bit_counter <= 3'h0;
+            end else begin
+                bit_counter <= bit_counter + 1;
+            end
+        end
+        
+        always @(posedge sck) begin
+            shift_rx <= rx_byte;
+        end
+        
+        always @(posedge sck or posedge reset) begin
+            if (reset) begin
+                sck_rx_overflow <= 32'h0;
+                sck_bits <= 3'h0;
+            end else if (!cs_n) begin
+                sck_bits <= sck_bits + 1;
+                if (rx_push && rx_afifo_full) begin
+                    sck_rx_overflow <= sck_rx_overflow + 1;
                 end
+            end
+        end
+        
+        // Transmit: output MISO on the falling edge (for CPHA=0); the first
+        // bit of each byte comes straight from the FIFO
+        always @(negedge sck or posedge cs_n) begin
+            if (cs_n) begin
+                tx_bit_counter <= 3'h0;
+                sck_first <= 1'b1;
+            end else begin
+                tx_bit_counter <= tx_bit_counter + 1;
+                sck_first <= 1'b0;
+            end
+        end
+        
+        always @(negedge sck) begin
+            if (tx_take) begin
+                miso <= tx_next[7];
+                shift_tx <= {tx_next[6:0], 1'b0};
+            end else begin
+                miso <= shift_tx[7];
+                shift_tx <= {shift_tx[6:0], 1'b0};
+            end
+        end
+        
+        always @(negedge sck or posedge reset) begin
+            if (reset) begin
+                sck_tx_underflow <= 32'h0;
+            end else if (tx_take && tx_afifo_empty) begin
+                sck_tx_underflow <= sck_tx_underflow + 1;
+            end
+        end
+        
+        // Bit position at each CS edge; a burst that ends mid-byte is an error
+        always @(negedge cs_n or posedge reset) begin
+            if (reset) begin
+                cs_bits_start <= 3'h0;
+            end else begin
+                cs_bits_start <= sck_bits;
+            end
+        end
+        
+        always @(posedge cs_n or posedge reset) begin
+            if (reset) begin
+                cs_bits_end <= 3'h0;
+            end else begin
+                cs_bits_end <= sck_bits;
+            end
+        end
+        
+        // RX: written on SCK, read on clk
+        async_fifo #(
+            .WIDTH(8),
+            .DEPTH(FIFO_DEPTH)
+        ) rx_afifo (
+            .wclk(sck),
+            .wrst(reset),
+            .w_en(rx_push),
+            .w_data(rx_byte),
+            .w_publish(1'b1),
+            .w_full(rx_afifo_full),
+            .w_level(),
+            .w_rptr(),
+            .rclk(clk),
+            .rrst(reset),
+            .r_en(rx_read),
+            .r_data(data_rx),
+            .r_fast(1'b0),
+            .r_empty(rx_afifo_empty),
+            .r_level(rx_level)
+        );
+        
+        // TX: written on clk, read on the SCK falling edge. The pointer the
+        // SCK side sees is frozen from CS assert until the first byte has
+        // been taken, so that byte can be judged without synchronizer
+        // latency (SCK has not run since the last burst). The freeze ends
+        // when the read pointer moves or, for a first byte sent as TX_FILL,
+        // once the first SCK falling edge is seen in clk.
+        async_fifo #(
+            .WIDTH(8),
+            .DEPTH(FIFO_DEPTH)
+        ) tx_afifo (
+            .wclk(clk),
+            .wrst(reset),
+            .w_en(tx_valid),
+            .w_data(data_tx),
+            .w_publish(!tx_freeze),
+            .w_full(tx_afifo_full),
+            .w_level(tx_level),
+            .w_rptr(tx_rptr_seen),
+            .rclk(~sck),
+            .rrst(reset),
+            .r_en(tx_take),
+            .r_data(tx_afifo_out),
+            .r_fast(sck_first),
+            .r_empty(tx_afifo_empty),
+            .r_level()
+        );
+        
+        assign tx_ready = !tx_afifo_full;
+        assign rx_valid = !rx_afifo_empty;
+        
+        // System side: status, TX pointer freeze and loss counters. The SCK
+        // domain counters are static while CS is high, so they are copied
+        // (and cleared, by rebasing) only then.
+        always @(posedge clk or posedge reset) begin
+            if (reset) begin
+                busy <= 1'b0;
+                error <= 1'b0;
+                tx_freeze <= 1'b0;
+                tx_rptr_at_cs <= 0;
+                sck_started_sync <= 3'b000;
+                rx_ovf_base <= 32'h0;
+                tx_unf_base <= 32'h0;
+                clear_pending <= 1'b0;
+                rx_overflow_count <= 32'h0;
+                tx_underflow_count <= 32'h0;
+            end else begin
+                busy <= !cs_n_sync;
+                sck_started_sync <= {sck_started_sync[1:0], !sck_first};
                 
-                COMPLETE: begin
-                    rx_valid <= 1'b1;
-                    current_state <= IDLE;
-                    
-                    // Clear rx_valid when data is read
-                    if (rx_read) begin
-                        rx_valid <= 1'b0;
+                if (!cs_n_sync && last_cs_n) begin
+                    tx_freeze <= 1'b1;
+                    tx_rptr_at_cs <= tx_rptr_seen;
+                    error <= 1'b0;
+                end else if (tx_freeze && (cs_n_sync || tx_rptr_seen != tx_rptr_at_cs ||
+                                           (sck_started_sync[1] && !sck_started_sync[2]))) begin
+                    tx_freeze <= 1'b0;
+                end
+                
+                if (cs_n_sync && !last_cs_n) begin
+                    error <= (cs_bits_end != cs_bits_start);
+                end
+                
+                if (clear_counters) begin
+                    clear_pending <= 1'b1;
+                end
+                
+                if (cs_n_sync && last_cs_n) begin
+                    if (clear_counters || clear_pending) begin
+                        rx_ovf_base <= sck_rx_overflow;
+                        tx_unf_base <= sck_tx_underflow;
+                        rx_overflow_count <= 32'h0;
+                        tx_underflow_count <= 32'h0;
+                        clear_pending <= 1'b0;
+                    end else begin
+                        rx_overflow_count <= sck_rx_overflow - rx_ovf_base;
+                        tx_underflow_count <= sck_tx_underflow - tx_unf_base;
                     end
                 end
+            end
+        end
+    end
+    endgenerate
+    
+endmodule
+
+// Wishbone wrapper for the SPI slave
+// Register map (byte offsets from BASE_ADDR):
+//   0x00 DATA     - Read pops the RX FIFO, write pushes the TX FIFO
+//   0x04 STATUS   - [0] RX_VALID [1] TX_FULL [2] RX_HIGH [3] TX_LOW
+//                   [4] BUSY [5] ERROR (sticky, write 1 to clear)
+//   0x08 LEVEL    - [7:0] TX level, [15:8] RX level, [31:16] FIFO depth
+//   0x0C THRESH   - [7:0] TX low watermark, [15:8] RX high watermark
+//   0x10 RX_OVF   - Bytes dropped on a full RX FIFO
+//   0x14 TX_UNF   - Bytes sent from an empty TX FIFO
+//   0x18 CTRL     - [0] CLEAR counters (strobe)
+//   0x1C IRQ_EN   - [0] RX_HIGH [1] TX_LOW [2] ERROR
+
+module spi_slave_wb #(
+    parameter BASE_ADDR = 32'h4000_2000,
+    parameter FIFO_DEPTH = 16,
+    parameter TX_FILL = 8'hFF,
+    parameter SCK_CLOCKED = 0
+)(
+    // Clock and Reset
+    input wire clk,
+    input wire reset,
+    
+    // Wishbone Bus Interface
+    input wire [31:0] wb_addr_i,
+    output reg [31:0] wb_data_o,
+    input wire [31:0] wb_data_i,
+    input wire wb_we_i,
+    input wire wb_stb_i,
+    input wire wb_cyc_i,
+    output reg wb_ack_o,
+    
+    // Interrupt
+    output wire irq_o,
+    
+    // SPI Physical Interface
+    input wire sck,
+    input wire mosi,
+    output wire miso,
+    input wire cs_n
+);
+    
+    localparam LEVEL_WIDTH = $clog2(FIFO_DEPTH+1);
+    localparam [15:0] FIFO_DEPTH_INFO = FIFO_DEPTH;
+    
+    // Register addresses
+    localparam REG_DATA   = 8'h00;
+    localparam REG_STATUS = 8'h04;
+    localparam REG_LEVEL  = 8'h08;
+    localparam REG_THRESH = 8'h0C;
+    localparam REG_RX_OVF = 8'h10;
+    localparam REG_TX_UNF = 8'h14;
+    localparam REG_CTRL   = 8'h18;
+    localparam REG_IRQ_EN = 8'h1C;
+    
+    // Status / interrupt bits
+    localparam STAT_RX_VALID = 0;
+    localparam STAT_TX_FULL  = 1;
+    localparam STAT_RX_HIGH  = 2;
+    localparam STAT_TX_LOW   = 3;
+    localparam STAT_BUSY     = 4;
+    localparam STAT_ERROR    = 5;
+    localparam IRQ_RX_HIGH   = 0;
+    localparam IRQ_TX_LOW    = 1;
+    localparam IRQ_ERROR     = 2;
+    localparam CTRL_CLEAR    = 0;
+    
+    // Internal registers
+    reg [7:0] tx_low_reg;
+    reg [7:0] rx_high_reg;
+    reg [2:0] irq_en_reg;
+    reg error_flag;
+    reg clear_counters;
+    reg tx_push;
+    reg rx_pop;
+    
+    // Internal signals
+    wire tx_ready;
+    wire [7:0] data_rx;
+    wire rx_valid;
+    wire [LEVEL_WIDTH-1:0] tx_level;
+    wire [LEVEL_WIDTH-1:0] rx_level;
+    wire tx_low;
+    wire rx_high;
+    wire [31:0] rx_overflow_count;
+    wire [31:0] tx_underflow_count;
+    wire busy;
+    wire error;
+    
+    wire [7:0] tx_level_info = tx_level;
+    wire [7:0] rx_level_info = rx_level;
+    wire [31:0] status = {26'h0, error_flag, busy, tx_low, rx_high,
+                          !tx_ready, rx_valid};
+    
+    // Wishbone address match
+    wire addr_match = (wb_addr_i[31:8] == BASE_ADDR[31:8]);
+    wire [7:0] reg_addr = wb_addr_i[7:0];
+    
+    // SPI Slave instance
+    spi_slave #(
+        .FIFO_DEPTH(FIFO_DEPTH),
+        .TX_FILL(TX_FILL),
+        .SCK_CLOCKED(SCK_CLOCKED)
+    ) spi_slave_inst (
+        .clk(clk),
+        .reset(reset),
+        .data_tx(wb_data_i[7:0]),
+        .tx_valid(tx_push),
+        .tx_ready(tx_ready),
+        .data_rx(data_rx),
+        .rx_valid(rx_valid),
+        .rx_read(rx_pop),
+        .tx_watermark(tx_low_reg),
+        .rx_watermark(rx_high_reg),
+        .tx_level(tx_level),
+        .rx_level(rx_level),
+        .tx_low(tx_low),
+        .rx_high(rx_high),
+        .rx_overflow_count(rx_overflow_count),
+        .tx_underflow_count(tx_underflow_count),
+        .clear_counters(clear_counters),
+        .sck(sck),
+        .mosi(mosi),
+        .miso(miso),
+        .cs_n(cs_n),
+        .busy(busy),
+        .error(error)
+    );
+    
+    assign irq_o = (irq_en_reg[IRQ_RX_HIGH] && rx_high) ||
+                   (irq_en_reg[IRQ_TX_LOW] && tx_low) ||
+                   (irq_en_reg[IRQ_ERROR] && error_flag);
+    
+    // Wishbone write cycle
+    always @(posedge clk or posedge reset) begin
+        if (reset) begin
+            tx_low_reg <= FIFO_DEPTH / 2;
+            rx_high_reg <= FIFO_DEPTH / 2;
+            irq_en_reg <= 3'h0;
+            error_flag <= 1'b0;
+            clear_counters <= 1'b0;
+            tx_push <= 1'b0;
+            rx_pop <= 1'b0;
+            wb_ack_o <= 1'b0;
+        end else begin
+            // Default values
+            tx_push <= 1'b0;
+            rx_pop <= 1'b0;
+            clear_counters <= 1'b0;
+            wb_ack_o <= 1'b0;
+            
+            if (error) begin
+                error_flag <= 1'b1;
+            end
+            
+            // Wishbone transaction (one ack per access so FIFO pushes and
+            // pops are not repeated while the master still holds STB)
+            if (wb_cyc_i && wb_stb_i && addr_match && !wb_ack_o) begin
+                wb_ack_o <= 1'b1;
+                
+                if (!wb_we_i && reg_addr == REG_DATA) begin
+                    // Pop on read; the head byte stays on wb_data_o
+                    // through the ack cycle
+                    rx_pop <= rx_valid;
+                end
                 
-                default: begin
-                    current_state <= IDLE;
+                if (wb_we_i) begin
+                    case (reg_addr)
+                        REG_DATA: begin
+                            tx_push <= 1'b1;
+                        end
+                        REG_STATUS: begin
+                            if (wb_data_i[STAT_ERROR]) error_flag <= 1'b0;
+                        end
+                        REG_THRESH: begin
+                            tx_low_reg <= wb_data_i[7:0];
+                            rx_high_reg <= wb_data_i[15:8];
+                        end
+                        REG_CTRL: begin
+                            clear_counters <= wb_data_i[CTRL_CLEAR];
+                        end
+                        REG_IRQ_EN: begin
+                            irq_en_reg <= wb_data_i[2:0];
+                        end
+                        default: begin
+                            // Do nothing for unknown registers
+                        end
+                    endcase
                 end
+            end
+        end
+    end
+    
+    // Wishbone read cycle
+    always @(*) begin
+        wb_data_o = 32'h0;
+        if (addr_match) begin
+            case (reg_addr)
+                REG_DATA:   wb_data_o = {24'h0, data_rx};
+                REG_STATUS: wb_data_o = status;
+                REG_LEVEL:  wb_data_o = {FIFO_DEPTH_INFO, rx_level_info, tx_level_info};
+                REG_THRESH: wb_data_o = {16'h0, rx_high_reg, tx_low_reg};
+                REG_RX_OVF: wb_data_o = rx_overflow_count;
+                REG_TX_UNF: wb_data_o = tx_underflow_count;
+                REG_IRQ_EN: wb_data_o = {29'h0, irq_en_reg};
+                default:    wb_data_o = 32'hDEAD_BEEF;
             endcase
         end
     end
     
 endmodule
+
+// Dual-clock FIFO for the SCK-clocked slave. Pointers cross domains in gray
+// code through two-flop synchronizers; DEPTH must be a power of two.
+// r_data shows the head entry. The write pointer seen by the read side
+// advances one entry per wclk, on the edge that writes the entry when it is
+// caught up (wclk may stop right after the last write), and holds still
+// while w_publish is low; r_fast then lets the read side use that held
+// pointer without synchronizer latency.
+module async_fifo #(
+    parameter WIDTH = 8,
+    parameter DEPTH = 16
+)(
+    // Write side
+    input wire wclk,
+    input wire wrst,
+    input wire w_en,
+    input wire [WIDTH-1:0] w_data,
+    input wire w_publish,
+    output wire w_full,
+    output wire [$clog2(DEPTH):0] w_level,
+    output wire [$clog2(DEPTH):0] w_rptr,   // Read pointer as seen by wclk
+    
+    // Read side
+    input wire rclk,
+    input wire rrst,
+    input wire r_en,
+    output wire [WIDTH-1:0] r_data,
+    input wire r_fast,
+    output wire r_empty,
+    output wire [$clog2(DEPTH):0] r_level
+);
+
+    localparam AW = $clog2(DEPTH);
+    
+    reg [WIDTH-1:0] memory [0:DEPTH-1];
+    reg [AW:0] wbin, wbin_pub, wgray_pub;
+    reg [AW:0] rbin, rgray;
+    reg [AW:0] rgray_w1, rgray_w2;      // Read pointer into wclk
+    reg [AW:0] wgray_r1, wgray_r2;      // Write pointer into rclk
+    
+    function [AW:0] gray2bin;
+        input [AW:0] g;
+        integer i;
+        begin
+            gray2bin[AW] = g[AW];
+            for (i = AW - 1; i >= 0; i = i - 1) begin
+                gray2bin[i] = gray2bin[i + 1] ^ g[i];
+            end
+        end
+    endfunction
+    
+    wire [AW:0] rbin_w = gray2bin(rgray_w2);
+    wire [AW:0] wbin_r = gray2bin(r_fast ? wgray_pub : wgray_r2);
+    wire [AW:0] wpub_next = wbin_pub + 1;
+    wire [AW:0] rbin_next = rbin + 1;
+    
+    assign w_level = wbin - rbin_w;
+    assign w_full = (w_level == DEPTH);
+    assign w_rptr = rbin_w;
+    assign r_level = wbin_r - rbin;
+    assign r_empty = (r_level == 0);
+    assign r_data = memory[rbin[AW-1:0]];
+    
+    // Write domain
+    always @(posedge wclk or posedge wrst) begin
+        if (wrst) begin
+            wbin <= 0;
+            wbin_pub <= 0;
+            wgray_pub <= 0;
+            rgray_w1 <= 0;
+            rgray_w2 <= 0;
+        end else begin
+            rgray_w1 <= rgray;
+            rgray_w2 <= rgray_w1;
+            
+            if (w_en && !w_full) begin
+                memory[wbin[AW-1:0]] <= w_data;
+                wbin <= wbin + 1;
+            end
+            
+            // One step at a time, so only one gray bit changes per cycle;
+            // a write is published with the entry itself
+            if (w_publish && (wbin_pub != wbin || (w_en && !w_full))) begin
+                wbin_pub <= wpub_next;
+                wgray_pub <= wpub_next ^ (wpub_next >> 1);
+            end
+        end
+    end
+    
+    // Read domain
+    always @(posedge rclk or posedge rrst) begin
+        if (rrst) begin
+            rbin <= 0;
+            rgray <= 0;
+            wgray_r1 <= 0;
+            wgray_r2 <= 0;
+        end else begin
+            wgray_r1 <= wgray_pub;
+            wgray_r2 <= wgray_r1;
+            
+            if (r_en && !r_empty) begin
+                rbin <= rbin_next;
+                rgray <= rbin_next ^ (rbin_next >> 1);
+            end
+        end
+    end
+    
+endmodule
@@ -1,16 +1,26 @@
 // Top-level SoC Module
-// Integrates SPI controller with minimal SoC components
+// Integrates SPI controllers with minimal SoC components. Controller n has
+// its registers at 0x4000_0000 + n * 0x1_0000, its XIP window at
+// 0x6000_0000 + n * 16 MB, its own interrupt line and its own set of SPI
+// pins (lanes and chip selects 4n to 4n+3), so the buses run independently.
 
-module top (
+module top #(
+    parameter SPI_NUM_CTRL = 2,           // SPI controllers (1-4)
+    parameter SPI_FIFO_DEPTH = 8,
+    parameter SPI_NUM_PROFILES = 4,
+    parameter SPI_TRACE_DEPTH = 256,      // Trace entries per controller, 0 = none
+    parameter SPI_CLOCK_GATING = 0,       // 1 = gated idle clocks (ASIC), 0 = clock enables
+    parameter SPI_SCK_IO = 0,             // SCK pad register: 1 = iCE40 SB_IO, 0 = behavioural
+    parameter CLK_HZ = 50_000_000
+)(
     // Clock and Reset
     input wire clk_50mhz,
     input wire reset_n,
     
-    // SPI Interface
-    output wire spi_sck,
-    output wire spi_mosi,
-    input wire spi_miso,
-    output wire [3:0] spi_cs_n,
+    // SPI Interfaces, one per controller
+    output wire [SPI_NUM_CTRL-1:0] spi_sck,
+    inout wire [4*SPI_NUM_CTRL-1:0] spi_io,    // Per controller: IO0-IO3
+    output wire [4*SPI_NUM_CTRL-1:0] spi_cs_n,
     
     // GPIO/LEDs for testing
     output wire [7:0] leds,
@@ -38,6 +48,63 @@ module top (
     wire wb_ack;
     wire wb_irq;
     
+    // Per-slave read data and acks (SPI controllers from 0x4000_0000,
+    // timer at 0x4000_1000; each slave decodes its own window)
+    localparam [31:0] SPI_BASE   = 32'h4000_0000;
+    localparam [31:0] SPI_STRIDE = 32'h0001_0000;
+    localparam [31:0] XIP_BASE   = 32'h6000_0000;
+    localparam [31:0] XIP_STRIDE = 32'h0100_0000;
+    localparam DMA_IDX_WIDTH = (SPI_NUM_CTRL > 1) ? $clog2(SPI_NUM_CTRL) : 1;
+    
+    wire [32*SPI_NUM_CTRL-1:0] spi_wb_data_all;
+    wire [SPI_NUM_CTRL-1:0] spi_wb_ack_all;
+    wire [SPI_NUM_CTRL-1:0] spi_irq;
+    reg [31:0] spi_wb_data;
+    wire spi_wb_ack = |spi_wb_ack_all;
+    wire [31:0] timer_wb_data;
+    wire timer_wb_ack;
+    wire timer_sel = (wb_addr[31:12] == 20'h4000_1);
+    
+    // A controller drives zero outside its own windows
+    integer c;
+    always @(*) begin
+        spi_wb_data = 32'h0000_0000;
+        for (c = 0; c < SPI_NUM_CTRL; c = c + 1) begin
+            spi_wb_data = spi_wb_data | spi_wb_data_all[c*32 +: 32];
+        end
+    end
+    
+    assign wb_data_s2m = timer_sel ? timer_wb_data : spi_wb_data;
+    assign wb_ack = spi_wb_ack | timer_wb_ack;
+    
+    // The placeholder CPU has one interrupt input; a real core takes each
+    // controller's line on its own vector
+    assign wb_irq = |spi_irq;
+    
+    // Per-controller DMA master ports, arbitrated onto BRAM port B
+    wire [32*SPI_NUM_CTRL-1:0] dma_addr_all;
+    wire [32*SPI_NUM_CTRL-1:0] dma_data_m2s_all;
+    wire [SPI_NUM_CTRL-1:0] dma_we_all;
+    wire [4*SPI_NUM_CTRL-1:0] dma_sel_all;
+    wire [SPI_NUM_CTRL-1:0] dma_stb_all;
+    wire [SPI_NUM_CTRL-1:0] dma_cyc_all;
+    wire [DMA_IDX_WIDTH-1:0] dma_grant;
+    wire dma_granted;
+    
+    // DMA master bus signals (the granted port)
+    wire [31:0] dma_addr;
+    wire [31:0] dma_data_m2s;
+    wire [31:0] dma_data_s2m;
+    wire dma_we;
+    wire [3:0] dma_sel;
+    wire dma_stb;
+    wire dma_cyc;
+    reg dma_ack;
+    
+    // SPI data lanes
+    wire [4*SPI_NUM_CTRL-1:0] spi_io_o;
+    wire [4*SPI_NUM_CTRL-1:0] spi_io_oe;
+    
     // Memory signals
     wire [31:0] mem_addr;
     wire [31:0] mem_data_out;
@@ -77,6 +144,7 @@ module top (
     );
     
     // Block RAM for program/data storage
+    // Port A serves the CPU, port B the SPI DMA engine
     block_ram #(
         .ADDR_WIDTH(12),
         .DATA_WIDTH(32)
@@ -86,33 +154,116 @@ module top (
         .data_in(mem_data_out),
         .data_out(mem_data_in),
         .we(mem_we),
-        .en(mem_en)
+        .en(mem_en),
+        .addr_b(dma_addr[13:2]),
+        .data_in_b(dma_data_m2s),
+        .data_out_b(dma_data_s2m),
+        .we_b((dma_cyc && dma_stb && dma_we && !dma_ack) ? dma_sel : 4'h0),
+        .en_b(dma_cyc && dma_stb)
     );
     
-    // SPI Controller instance
-    spi_controller #(
-        .BASE_ADDR(32'h4000_0000)
-    ) spi_ctrl_inst (
+    // DMA port acks one cycle after the strobe, matching the BRAM read latency
+    always @(posedge clk or posedge reset) begin
+        if (reset) begin
+            dma_ack <= 1'b0;
+        end else begin
+            dma_ack <= dma_cyc && dma_stb && !dma_ack;
+        end
+    end
+    
+    // DMA port arbitration: one bus cycle per grant, round robin, so
+    // engines running on several controllers interleave word by word
+    dma_arbiter #(
+        .NUM_MASTERS(SPI_NUM_CTRL),
+        .IDX_WIDTH(DMA_IDX_WIDTH)
+    ) dma_arb_inst (
+        .clk(clk),
+        .reset(reset),
+        .cyc_i(dma_cyc_all),
+        .grant_o(dma_grant),
+        .granted_o(dma_granted)
+    );
+    
+    assign dma_addr = dma_addr_all[dma_grant*32 +: 32];
+    assign dma_data_m2s = dma_data_m2s_all[dma_grant*32 +: 32];
+    assign dma_we = dma_we_all[dma_grant];
+    assign dma_sel = dma_sel_all[dma_grant*4 +: 4];
+    assign dma_stb = dma_granted && dma_stb_all[dma_grant];
+    assign dma_cyc = dma_granted && dma_cyc_all[dma_grant];
+    
+    // SPI Controller instances
+    genvar n;
+    generate
+        for (n = 0; n < SPI_NUM_CTRL; n = n + 1) begin : spi_ctrl
+            spi_controller #(
+                .BASE_ADDR(SPI_BASE + n * SPI_STRIDE),
+                .FIFO_DEPTH(SPI_FIFO_DEPTH),
+                .NUM_PROFILES(SPI_NUM_PROFILES),
+                .TRACE_DEPTH(SPI_TRACE_DEPTH),
+                .CLOCK_GATING(SPI_CLOCK_GATING),
+                .SCK_IO(SPI_SCK_IO),
+                .XIP_BASE(XIP_BASE + n * XIP_STRIDE)
+            ) spi_ctrl_inst (
+                .clk(clk),
+                .reset(reset),
+                
+                // Wishbone slave interface
+                .wb_addr_i(wb_addr),
+                .wb_data_o(spi_wb_data_all[n*32 +: 32]),
+                .wb_data_i(wb_data_m2s),
+                .wb_we_i(wb_we),
+                .wb_stb_i(wb_stb),
+                .wb_cyc_i(wb_cyc),
+                .wb_cti_i(3'b000),      // The CPU issues classic single cycles
+                .wb_bte_i(2'b00),
+                .wb_ack_o(spi_wb_ack_all[n]),
+                .wb_stall_o(),
+                
+                // Interrupt
+                .irq_o(spi_irq[n]),
+                
+                // DMA master interface
+                .dma_addr_o(dma_addr_all[n*32 +: 32]),
+                .dma_data_o(dma_data_m2s_all[n*32 +: 32]),
+                .dma_data_i(dma_data_s2m),
+                .dma_we_o(dma_we_all[n]),
+                .dma_sel_o(dma_sel_all[n*4 +: 4]),
+                .dma_stb_o(dma_stb_all[n]),
+                .dma_cyc_o(dma_cyc_all[n]),
+                .dma_ack_i(dma_ack && dma_granted && dma_grant == n),
+                
+                // SPI interface
+                .spi_sck(spi_sck[n]),
+                .spi_io_o(spi_io_o[n*4 +: 4]),
+                .spi_io_oe(spi_io_oe[n*4 +: 4]),
+                .spi_io_i(spi_io[n*4 +: 4]),
+                .spi_cs_n(spi_cs_n[n*4 +: 4])
+            );
+        end
+    endgenerate
+    
+    // SPI data lane tristate buffers
+    genvar io;
+    generate
+        for (io = 0; io < 4 * SPI_NUM_CTRL; io = io + 1) begin : spi_io_buf
+            assign spi_io[io] = spi_io_oe[io] ? spi_io_o[io] : 1'bz;
+        end
+    endgenerate
+    
+    // Cycle counter for firmware timeouts and delays
+    simple_timer #(
+        .BASE_ADDR(32'h4000_1000),
+        .CLK_HZ(CLK_HZ)
+    ) timer_inst (
         .clk(clk),
         .reset(reset),
-        
-        // Wishbone slave interface
         .wb_addr_i(wb_addr),
-        .wb_data_o(wb_data_s2m),
+        .wb_data_o(timer_wb_data),
         .wb_data_i(wb_data_m2s),
         .wb_we_i(wb_we),
         .wb_stb_i(wb_stb),
         .wb_cyc_i(wb_cyc),
-        .wb_ack_o(wb_ack),
-        
-        // Interrupt
-        .irq_o(wb_irq),
-        
-        // SPI interface
-        .spi_sck(spi_sck),
-        .spi_mosi(spi_mosi),
-        .spi_miso(spi_miso),
-        .spi_cs_n(spi_cs_n)
+        .wb_ack_o(timer_wb_ack)
     );
     
     // Simple UART for debug output
@@ -225,17 +376,75 @@ module simple_cpu (
     
 endmodule
 
-// Block RAM module
+// DMA port arbiter
+// Grants the shared memory port to one master for a whole Wishbone cycle,
+// from the cycle in which its cyc rises until cyc falls. An idle port is
+// granted in the same cycle; the next grant goes round robin, starting
+// after the previous owner, so no master can starve the others.
+module dma_arbiter #(
+    parameter NUM_MASTERS = 2,
+    parameter IDX_WIDTH = 1
+)(
+    input wire clk,
+    input wire reset,
+    input wire [NUM_MASTERS-1:0] cyc_i,
+    output wire [IDX_WIDTH-1:0] grant_o,
+    output wire granted_o
+);
+
+    reg [IDX_WIDTH-1:0] owner;
+    reg active;
+    reg [IDX_WIDTH-1:0] next;
+    
+    // First requester after the previous owner
+    integer k;
+    always @(*) begin
+        next = owner;
+        for (k = NUM_MASTERS; k >= 1; k = k - 1) begin
+            if (cyc_i[(owner + k) % NUM_MASTERS]) begin
+                next = (owner + k) % NUM_MASTERS;
+            end
+        end
+    end
+    
+    assign grant_o = active ? owner : next;
+    assign granted_o = active || (|cyc_i);
+    
+    always @(posedge clk or posedge reset) begin
+        if (reset) begin
+            owner <= {IDX_WIDTH{1'b0}};
+            active <= 1'b0;
+        end else if (active) begin
+            // The cycle ends when the owner drops cyc
+            active <= cyc_i[owner];
+        end else if (|cyc_i) begin
+            owner <= next;
+            active <= 1'b1;
+        end
+    end
+    
+endmodule
+
+// Block RAM module (true dual-port, byte-writable on port B)
 module block_ram #(
     parameter ADDR_WIDTH = 12,
     parameter DATA_WIDTH = 32
 )(
     input wire clk,
+    
+    // Port A
     input wire [ADDR_WIDTH-1:0] addr,
     input wire [DATA_WIDTH-1:0] data_in,
     output reg [DATA_WIDTH-1:0] data_out,
     input wire we,
-    input wire en
+    input wire en,
+    
+    // Port B
+    input wire [ADDR_WIDTH-1:0] addr_b,
+    input wire [DATA_WIDTH-1:0] data_in_b,
+    output reg [DATA_WIDTH-1:0] data_out_b,
+    input wire [DATA_WIDTH/8-1:0] we_b,
+    input wire en_b
 );
     
     // Memory array
@@ -263,6 +472,17 @@ module block_ram #(
         end
     end
     
+    always @(posedge clk) begin
+        if (en_b) begin
+            for (int i = 0; i < DATA_WIDTH/8; i = i + 1) begin
+                if (we_b[i]) begin
+                    memory[addr_b][i*8 +: 8] <= data_in_b[i*8 +: 8];
+                end
+            end
+            data_out_b <= memory[addr_b];
+        end
+    end
+    
 endmodule
 
 // Simple UART module
@@ -285,3 +505,69 @@ module simple_uart (
     assign rx_valid = 1'b0;
     
 endmodule
+
+// Simple timer module
+// Free-running 64-bit cycle counter. A COUNT_LO read snapshots the whole
+// counter, so a COUNT_LO then COUNT_HI read pair is one consistent value.
+module simple_timer #(
+    parameter BASE_ADDR = 32'h4000_1000,
+    parameter CLK_HZ = 50_000_000
+)(
+    input wire clk,
+    input wire reset,
+    
+    // Wishbone Bus Interface
+    input wire [31:0] wb_addr_i,
+    output reg [31:0] wb_data_o,
+    input wire [31:0] wb_data_i,
+    input wire wb_we_i,
+    input wire wb_stb_i,
+    input wire wb_cyc_i,
+    output reg wb_ack_o
+);
+
+    // Register addresses
+    localparam REG_COUNT_LO = 8'h00;
+    localparam REG_COUNT_HI = 8'h04;  // Upper half of the COUNT_LO snapshot
+    localparam REG_FREQ     = 8'h08;  // Counter frequency in Hz
+    localparam [31:0] FREQ  = CLK_HZ;
+    
+    reg [63:0] count;
+    reg [63:0] count_latch;
+    
+    wire addr_match = (wb_addr_i[31:8] == BASE_ADDR[31:8]);
+    wire [7:0] reg_addr = wb_addr_i[7:0];
+    
+    always @(posedge clk or posedge reset) begin
+        if (reset) begin
+            count <= 64'h0;
+            count_latch <= 64'h0;
+            wb_ack_o <= 1'b0;
+        end else begin
+            count <= count + 1;
+            wb_ack_o <= 1'b0;
+            
+            if (wb_cyc_i && wb_stb_i && addr_match && !wb_ack_o) begin
+                wb_ack_o <= 1'b1;
+                if (!wb_we_i && reg_addr == REG_COUNT_LO) begin
+                    count_latch <= count;
+                end
+            end
+        end
+    end
+    
+    // Read data (the counter is read-only, writes are acked and dropped)
+    always @(*) begin
+        wb_data_o = 32'h0000_0000;
+        
+        if (addr_match) begin
+            case (reg_addr)
+                REG_COUNT_LO: wb_data_o = count_latch[31:0];
+                REG_COUNT_HI: wb_data_o = count_latch[63:32];
+                REG_FREQ:     wb_data_o = FREQ;
+                default:      wb_data_o = 32'hDEAD_BEEF;
+            endcase
+        end
+    end
+    
+endmodule
@@ -0,0 +1,93 @@
+// Synthesis Benchmark Wrapper
+// Out-of-context harness around spi_controller for make synth-bench. The
+// controller's bus ports (Wishbone slave and DMA master, 105 inputs and
+// 106 outputs) do not fit an FPGA package, and tying them off would let
+// synthesis prune the logic being measured; top cannot stand in either,
+// since its placeholder CPU never drives the bus. Instead every bus input
+// comes from a shift register loaded through bench_in, and every output is
+// registered and folded into bench_out, so all controller paths stay live
+// and run register to register, and only the SPI pins are real ports.
+// Frame width and lane count are run-time CONTROL fields, so one build
+// covers every width and lane mode.
+
+module spi_synth_bench #(
+    parameter FIFO_DEPTH = 8,
+    parameter NUM_PROFILES = 4,
+    parameter TRACE_DEPTH = 0,
+    parameter WB_PIPELINED = 0,
+    parameter CLOCK_GATING = 0,
+    parameter SCK_IO = 1           // The iCE40 SB_IO drives spi_sck
+)(
+    input wire clk,
+    input wire reset,
+    
+    // Serial stimulus and observation
+    input wire bench_in,
+    output reg bench_out,
+    
+    // SPI Interface
+    output wire spi_sck,
+    output wire [3:0] spi_io_o,
+    output wire [3:0] spi_io_oe,
+    input wire [3:0] spi_io_i,
+    output wire [3:0] spi_cs_n
+);
+    
+    localparam IN_BITS = 105;
+    localparam OUT_BITS = 106;
+    
+    reg [IN_BITS-1:0] in_q;
+    reg [OUT_BITS-1:0] out_q;
+    wire [OUT_BITS-1:0] out_w;
+    
+    always @(posedge clk) begin
+        in_q <= {in_q[IN_BITS-2:0], bench_in};
+        out_q <= out_w;
+        bench_out <= ^out_q;
+    end
+    
+    spi_controller #(
+        .FIFO_DEPTH(FIFO_DEPTH),
+        .NUM_PROFILES(NUM_PROFILES),
+        .TRACE_DEPTH(TRACE_DEPTH),
+        .WB_PIPELINED(WB_PIPELINED),
+        .CLOCK_GATING(CLOCK_GATING),
+        .SCK_IO(SCK_IO)
+    ) dut (
+        .clk(clk),
+        .reset(reset),
+        
+        // Wishbone slave interface
+        .wb_addr_i(in_q[31:0]),
+        .wb_data_o(out_w[31:0]),
+        .wb_data_i(in_q[63:32]),
+        .wb_we_i(in_q[64]),
+        .wb_stb_i(in_q[65]),
+        .wb_cyc_i(in_q[66]),
+        .wb_cti_i(in_q[69:67]),
+        .wb_bte_i(in_q[71:70]),
+        .wb_ack_o(out_w[32]),
+        .wb_stall_o(out_w[33]),
+        
+        // Interrupt
+        .irq_o(out_w[34]),
+        
+        // DMA master interface
+        .dma_addr_o(out_w[66:35]),
+        .dma_data_o(out_w[98:67]),
+        .dma_data_i(in_q[103:72]),
+        .dma_we_o(out_w[99]),
+        .dma_sel_o(out_w[103:100]),
+        .dma_stb_o(out_w[104]),
+        .dma_cyc_o(out_w[105]),
+        .dma_ack_i(in_q[104]),
+        
+        // SPI interface
+        .spi_sck(spi_sck),
+        .spi_io_o(spi_io_o),
+        .spi_io_oe(spi_io_oe),
+        .spi_io_i(spi_io_i),
+        .spi_cs_n(spi_cs_n)
+    );
+    
+endmodule
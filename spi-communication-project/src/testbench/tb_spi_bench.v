@@ -0,0 +1,463 @@
+// Throughput Benchmark for the SPI Controller
+// Drives spi_controller over Wishbone exactly as firmware would (TX_FIFO
+// pushes, STATUS polls, RX_FIFO pops) in internal loopback, and sweeps
+// modes, clock dividers and burst lengths. FIFO_DEPTH is a build-time
+// parameter; `make bench` builds one image per depth. With BURST=1 the
+// FIFO ports are filled and drained with constant-address Wishbone bursts
+// (one word per clock) instead of single cycles. PIPELINED=1 builds the
+// controller as a Wishbone B4 pipelined slave and drives it that way: one
+// request per unstalled cycle, so a burst is back-to-back requests.
+//
+// Every configuration prints one line:
+//   BENCH,depth,mode,div,frames,cycles,ideal_cycles,bytes_per_cycle,
+//         busy_cycles,idle_cycles,underruns,latency,errors
+// cycles       - first TX push to last RX pop
+// ideal_cycles - SCK time alone (16 * div per byte)
+// idle_cycles  - PERF_IDLE: master idle while work was pending
+// latency      - first TX push to first RX byte in the FIFO
+
+`timescale 1ns/1ps
+
+module tb_spi_bench;
+    
+    // Parameters
+    parameter CLK_PERIOD = 20;  // 50 MHz
+    parameter FIFO_DEPTH = 8;
+    parameter TIMEOUT = 200000; // Cycles without progress before giving up
+    parameter BURST = 0;        // 1: FIFO accesses as classic bursts
+    parameter PIPELINED = 0;    // 1: pipelined slave (WB_PIPELINED) and master
+    
+    localparam BASE_ADDR = 32'h4000_0000;
+    
+    // Register offsets
+    localparam REG_CONTROL   = 8'h00;
+    localparam REG_STATUS    = 8'h04;
+    localparam REG_CLK_DIV   = 8'h10;
+    localparam REG_TX_FIFO   = 8'h14;
+    localparam REG_RX_FIFO   = 8'h18;
+    localparam REG_FIFO_INFO = 8'h2C;
+    localparam REG_PERF_BUSY     = 8'h64;
+    localparam REG_PERF_IDLE     = 8'h68;
+    localparam REG_PERF_UNDERRUN = 8'h6C;
+    localparam REG_PERF_CTRL     = 8'h7C;
+    
+    localparam CTRL_LOOPBACK = 32'h0000_0080;
+    localparam STAT_BUSY     = 0;
+    localparam STAT_RX_EMPTY = 5;
+    
+    // Wishbone cycle types
+    localparam CTI_CLASSIC = 3'b000;
+    localparam CTI_CONST   = 3'b001;
+    localparam CTI_END     = 3'b111;
+    
+    // DUT signals
+    reg clk;
+    reg reset;
+    reg [31:0] wb_addr;
+    reg [31:0] wb_wdata;
+    wire [31:0] wb_rdata;
+    reg wb_we;
+    reg wb_stb;
+    reg wb_cyc;
+    reg [2:0] wb_cti;
+    wire wb_ack;
+    wire wb_stall;
+    wire spi_sck;
+    wire [3:0] spi_io_o;
+    wire [3:0] spi_io_oe;
+    wire [3:0] spi_cs_n;
+    
+    // Benchmark state
+    integer cycle = 0;
+    integer config_count = 0;
+    integer fail_count = 0;
+    
+    // Instantiate DUT
+    spi_controller #(
+        .BASE_ADDR(BASE_ADDR),
+        .FIFO_DEPTH(FIFO_DEPTH),
+        .WB_PIPELINED(PIPELINED)
+    ) dut (
+        .clk(clk),
+        .reset(reset),
+        .wb_addr_i(wb_addr),
+        .wb_data_o(wb_rdata),
+        .wb_data_i(wb_wdata),
+        .wb_we_i(wb_we),
+        .wb_stb_i(wb_stb),
+        .wb_cyc_i(wb_cyc),
+        .wb_cti_i(wb_cti),
+        .wb_bte_i(2'b00),
+        .wb_ack_o(wb_ack),
+        .wb_stall_o(wb_stall),
+        .irq_o(),
+        .dma_addr_o(),
+        .dma_data_o(),
+        .dma_data_i(32'h0),
+        .dma_we_o(),
+        .dma_sel_o(),
+        .dma_stb_o(),
+        .dma_cyc_o(),
+        .dma_ack_i(1'b0),
+        .spi_sck(spi_sck),
+        .spi_io_o(spi_io_o),
+        .spi_io_oe(spi_io_oe),
+        .spi_io_i(4'hF),
+        .spi_cs_n(spi_cs_n)
+    );
+    
+    // Clock generation
+    always begin
+        #(CLK_PERIOD/2) clk = ~clk;
+    end
+    
+    always @(posedge clk) begin
+        cycle <= cycle + 1;
+    end
+    
+    // First cycle the RX FIFO holds data after each PERF clear
+    integer first_rx_cycle = 0;
+    reg rx_seen = 1'b0;
+    always @(posedge clk) begin
+        if (dut.perf_clear) begin
+            rx_seen <= 1'b0;
+        end else if (!rx_seen && !dut.rx_fifo_empty) begin
+            rx_seen <= 1'b1;
+            first_rx_cycle <= cycle;
+        end
+    end
+    
+    // Pipelined request phase: STB stays up until the slave takes the
+    // request, and the ack follows in the next cycle
+    task wb_pipe_request;
+        reg stalled;
+        begin
+            stalled = 1'b1;
+            while (stalled) begin
+                @(posedge clk);
+                stalled = wb_stall;
+                #1;
+            end
+            wb_stb = 1'b0;
+        end
+    endtask
+    
+    // Wishbone single write
+    task wb_write;
+        input [7:0] addr;
+        input [31:0] data;
+        begin
+            @(posedge clk); #1;
+            wb_addr = BASE_ADDR | addr;
+            wb_wdata = data;
+            wb_we = 1'b1;
+            wb_stb = 1'b1;
+            wb_cyc = 1'b1;
+            if (PIPELINED) begin
+                wb_pipe_request;
+            end else begin
+                @(posedge clk); #1;
+            end
+            while (!wb_ack) begin
+                @(posedge clk); #1;
+            end
+            wb_we = 1'b0;
+            wb_stb = 1'b0;
+            wb_cyc = 1'b0;
+        end
+    endtask
+    
+    // Wishbone single read
+    task wb_read;
+        input [7:0] addr;
+        output [31:0] data;
+        begin
+            @(posedge clk); #1;
+            wb_addr = BASE_ADDR | addr;
+            wb_we = 1'b0;
+            wb_stb = 1'b1;
+            wb_cyc = 1'b1;
+            if (PIPELINED) begin
+                wb_pipe_request;
+            end else begin
+                @(posedge clk); #1;
+            end
+            while (!wb_ack) begin
+                @(posedge clk); #1;
+            end
+            data = wb_rdata;
+            wb_stb = 1'b0;
+            wb_cyc = 1'b0;
+        end
+    endtask
+    
+    // Constant-address burst of `count` writes (count >= 1) carrying
+    // consecutive bytes from `first`. Like a registered master, the next
+    // beat goes on the bus after the clock edge that sampled the ack. A
+    // pipelined master instead moves on at every edge that takes a
+    // request and counts the acks separately.
+    task wb_write_burst;
+        input [7:0] addr;
+        input integer first;
+        input integer count;
+        integer beat;
+        integer acks;
+        reg acked;
+        reg stalled;
+        begin
+            @(posedge clk); #1;
+            wb_addr = BASE_ADDR | addr;
+            wb_wdata = first & 8'hFF;
+            wb_cti = (count > 1) ? CTI_CONST : CTI_END;
+            wb_we = 1'b1;
+            wb_stb = 1'b1;
+            wb_cyc = 1'b1;
+            beat = 0;
+            acks = 0;
+            while (PIPELINED && acks < count) begin
+                @(posedge clk);
+                acked = wb_ack;
+                stalled = wb_stall;
+                #1;
+                if (acked) begin
+                    acks = acks + 1;
+                end
+                if (wb_stb && !stalled) begin
+                    beat = beat + 1;
+                    wb_wdata = (first + beat) & 8'hFF;
+                    wb_stb = (beat < count);
+                end
+            end
+            while (!PIPELINED && beat < count) begin
+                @(posedge clk);
+                acked = wb_ack;
+                #1;
+                if (acked) begin
+                    beat = beat + 1;
+                    wb_wdata = (first + beat) & 8'hFF;
+                    wb_cti = (beat == count - 1) ? CTI_END : CTI_CONST;
+                end
+            end
+            wb_we = 1'b0;
+            wb_stb = 1'b0;
+            wb_cyc = 1'b0;
+            wb_cti = CTI_CLASSIC;
+        end
+    endtask
+    
+    // Constant-address burst of `count` RX FIFO pops, checked against
+    // consecutive bytes from `first`; returns the mismatches
+    task wb_read_burst;
+        input integer first;
+        input integer count;
+        output integer mismatches;
+        integer beat;
+        integer acks;
+        reg acked;
+        reg stalled;
+        reg [31:0] data;
+        begin
+            @(posedge clk); #1;
+            wb_addr = BASE_ADDR | REG_RX_FIFO;
+            wb_cti = (count > 1) ? CTI_CONST : CTI_END;
+            wb_we = 1'b0;
+            wb_stb = 1'b1;
+            wb_cyc = 1'b1;
+            beat = 0;
+            acks = 0;
+            mismatches = 0;
+            while (PIPELINED && acks < count) begin
+                @(posedge clk);
+                acked = wb_ack;
+                stalled = wb_stall;
+                data = wb_rdata;
+                #1;
+                if (acked) begin
+                    if (data[7:0] != ((first + acks) & 8'hFF)) begin
+                        mismatches = mismatches + 1;
+                    end
+                    acks = acks + 1;
+                end
+                if (wb_stb && !stalled) begin
+                    beat = beat + 1;
+                    wb_stb = (beat < count);
+                end
+            end
+            while (!PIPELINED && beat < count) begin
+                @(posedge clk);
+                acked = wb_ack;
+                data = wb_rdata;
+                #1;
+                if (acked) begin
+                    if (data[7:0] != ((first + beat) & 8'hFF)) begin
+                        mismatches = mismatches + 1;
+                    end
+                    beat = beat + 1;
+                    wb_cti = (beat == count - 1) ? CTI_END : CTI_CONST;
+                end
+            end
+            wb_stb = 1'b0;
+            wb_cyc = 1'b0;
+            wb_cti = CTI_CLASSIC;
+        end
+    endtask
+    
+    // One benchmark point: stream `frames` bytes through the FIFOs, keeping
+    // at most FIFO_DEPTH bytes in flight so neither FIFO can overflow
+    task run_config;
+        input [1:0] mode;
+        input [7:0] div;
+        input integer frames;
+        reg [31:0] status;
+        reg [31:0] rx;
+        reg [31:0] busy_cycles;
+        reg [31:0] idle_cycles;
+        reg [31:0] underruns;
+        integer pushed;
+        integer popped;
+        integer errors;
+        integer start_cycle;
+        integer end_cycle;
+        integer latency;
+        integer last_progress;
+        integer chunk;
+        integer mismatches;
+        begin
+            wb_write(REG_CONTROL, CTRL_LOOPBACK | (mode << 1));
+            wb_write(REG_CLK_DIV, div);
+            wb_write(REG_PERF_CTRL, 32'h1);
+            
+            pushed = 0;
+            popped = 0;
+            errors = 0;
+            start_cycle = cycle;
+            last_progress = cycle;
+            
+            while (BURST && popped < frames && cycle - last_progress < TIMEOUT) begin
+                // Every free TX slot in one burst, then every RX byte
+                chunk = FIFO_DEPTH - (pushed - popped);
+                if (chunk > frames - pushed) begin
+                    chunk = frames - pushed;
+                end
+                if (chunk > 0) begin
+                    wb_write_burst(REG_TX_FIFO, pushed, chunk);
+                    pushed = pushed + chunk;
+                    last_progress = cycle;
+                end
+                
+                wb_read(REG_FIFO_INFO, status);
+                chunk = status[15:8];
+                if (chunk > 0) begin
+                    wb_read_burst(popped, chunk, mismatches);
+                    errors = errors + mismatches;
+                    popped = popped + chunk;
+                    last_progress = cycle;
+                end
+            end
+            
+            while (!BURST && popped < frames && cycle - last_progress < TIMEOUT) begin
+                if (pushed < frames && pushed - popped < FIFO_DEPTH) begin
+                    wb_write(REG_TX_FIFO, pushed & 8'hFF);
+                    pushed = pushed + 1;
+                    last_progress = cycle;
+                end
+                
+                wb_read(REG_STATUS, status);
+                if (!status[STAT_RX_EMPTY]) begin
+                    wb_read(REG_RX_FIFO, rx);
+                    if (rx[7:0] != (popped & 8'hFF)) begin
+                        errors = errors + 1;
+                    end
+                    popped = popped + 1;
+                    last_progress = cycle;
+                end
+            end
+            end_cycle = cycle;
+            
+            if (popped < frames) begin
+                $display("  TIMEOUT: mode %0d div %0d frames %0d (%0d received)",
+                         mode, div, frames, popped);
+                errors = errors + (frames - popped);
+            end
+            
+            // Let the master finish before reading the counters
+            status = 32'h1;
+            while (status[STAT_BUSY]) begin
+                wb_read(REG_STATUS, status);
+            end
+            wb_write(REG_PERF_CTRL, 32'h2);
+            wb_read(REG_PERF_BUSY, busy_cycles);
+            wb_read(REG_PERF_IDLE, idle_cycles);
+            wb_read(REG_PERF_UNDERRUN, underruns);
+            wb_write(REG_PERF_CTRL, 32'h0);
+            
+            latency = first_rx_cycle - start_cycle;
+            
+            $display("BENCH,%0d,%0d,%0d,%0d,%0d,%0d,%0.4f,%0d,%0d,%0d,%0d,%0d",
+                     FIFO_DEPTH, mode, div, frames, end_cycle - start_cycle,
+                     frames * 16 * div,
+                     frames * 1.0 / (end_cycle - start_cycle),
+                     busy_cycles, idle_cycles, underruns, latency, errors);
+            
+            config_count = config_count + 1;
+            if (errors != 0) begin
+                fail_count = fail_count + 1;
+            end
+        end
+    endtask
+    
+    // Sweep
+    integer m;
+    integer d;
+    integer f;
+    reg [7:0] divs [0:3];
+    integer frame_counts [0:3];
+    
+    initial begin
+        divs[0] = 1;
+        divs[1] = 2;
+        divs[2] = 4;
+        divs[3] = 8;
+        frame_counts[0] = 1;
+        frame_counts[1] = 4;
+        frame_counts[2] = 32;
+        frame_counts[3] = 256;
+        
+        // Initialize signals
+        clk = 0;
+        reset = 1;
+        wb_addr = 32'h0;
+        wb_wdata = 32'h0;
+        wb_we = 1'b0;
+        wb_stb = 1'b0;
+        wb_cyc = 1'b0;
+        wb_cti = CTI_CLASSIC;
+        
+        repeat(10) @(posedge clk);
+        reset = 0;
+        repeat(5) @(posedge clk);
+        
+        $display("========================================");
+        $display("SPI Controller Benchmark (FIFO_DEPTH=%0d, BURST=%0d, PIPELINED=%0d)",
+                 FIFO_DEPTH, BURST, PIPELINED);
+        $display("========================================");
+        $display("BENCH_HEADER,depth,mode,div,frames,cycles,ideal_cycles,bytes_per_cycle,busy_cycles,idle_cycles,underruns,latency,errors");
+        
+        for (m = 0; m < 4; m = m + 1) begin
+            for (d = 0; d < 4; d = d + 1) begin
+                for (f = 0; f < 4; f = f + 1) begin
+                    run_config(m, divs[d], frame_counts[f]);
+                end
+            end
+        end
+        
+        $display("\nConfigurations: %0d, with errors: %0d", config_count, fail_count);
+        if (fail_count == 0) begin
+            $display("\nAll benchmarks PASSED!");
+        end else begin
+            $display("\nSome benchmarks FAILED!");
+        end
+        $finish;
+    end
+
+endmodule
@@ -7,6 +7,7 @@ module tb_spi_master;
     // Parameters
     parameter CLK_PERIOD = 20;  // 50 MHz
     parameter CLK_DIV = 4;
+    parameter CLOCK_GATING = 0;  // 1: run the master on its gated idle clocks
     
     // DUT signals
     reg clk;
@@ -15,11 +16,13 @@ module tb_spi_master;
     reg [7:0] data_tx;
     reg [1:0] cpol_cpha;
     wire [7:0] data_rx;
+    wire [31:0] data_rx_frame;
     wire busy;
     wire done;
     wire sck;
     wire mosi;
     reg miso;
+    wire [3:0] sio_o;
     wire cs_n;
     
     // Test signals
@@ -30,18 +33,37 @@ module tb_spi_master;
     
     // Instantiate DUT
     spi_master #(
-        .CLK_DIV_WIDTH(8)
+        .CLK_DIV_WIDTH(8),
+        .CLOCK_GATING(CLOCK_GATING)
     ) dut (
         .clk(clk),
         .reset(reset),
         .start(start),
-        .data_tx(data_tx),
+        .data_tx({24'h0, data_tx}),
         .cpol_cpha(cpol_cpha),
+        .frame_size(2'b00),  // 8-bit frames
+        .lanes(2'b00),       // Single lane (MOSI/MISO)
+        .lane_in(1'b0),
         .clk_div(CLK_DIV),
-        .cs_polarity(1'b0),  // Active low
+        .clk_frac(8'h0),
+        .sck_fast(1'b0),
+        .sample_delay(4'h0),
+        .cs_polarity(4'b0000),  // Active low
         .cs_select(2'b00),
+        .cs_hold(1'b0),
+        .auto_cs_en(1'b0),
+        .auto_cs_count(16'h0),
+        .cs_setup_cycles(8'h0),
+        .cs_hold_cycles(8'h0),
+        .frame_gap_cycles(8'h0),
         .loopback(1'b0),
-        .data_rx(data_rx),
+        .fill_load(1'b0),
+        .fill_frames(16'h0),
+        .fill_data(32'h0),
+        .rx_discard(1'b0),
+        .fill_left(),
+        .data_rx(data_rx_frame),
+        .tx_frame(),
         .busy(busy),
         .done(done),
         .error(),
@@ -49,17 +71,23 @@ module tb_spi_master;
         .tx_fifo_empty(),
         .rx_fifo_full(),
         .rx_fifo_empty(),
+        .tx_underrun(),
+        .rx_overrun(),
         .sck(sck),
-        .mosi(mosi),
-        .miso(miso),
+        .sio_o(sio_o),
+        .sio_oe(),
+        .sio_i({2'b11, miso, 1'b0}),
         .cs_n(cs_n),
         .fifo_write_en(1'b0),
-        .fifo_data_in(8'h00),
+        .fifo_data_in(32'h0),
         .fifo_read_en(1'b0),
         .fifo_data_out(),
         .irq()
     );
     
+    assign data_rx = data_rx_frame[7:0];
+    assign mosi = sio_o[0];
+    
     // Clock generation
     always begin
         #(CLK_PERIOD/2) clk = ~clk;
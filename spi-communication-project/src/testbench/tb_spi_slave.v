@@ -6,6 +6,7 @@ module tb_spi_slave;
     
     // Parameters
     parameter CLK_PERIOD = 20;  // 50 MHz
+    parameter SCK_CLOCKED = 0;  // Slave datapath under test
     
     // DUT signals
     reg clk;
@@ -26,12 +27,19 @@ module tb_spi_slave;
     // Test signals
     reg [7:0] master_tx_data;
     reg [7:0] slave_tx_data;
+    reg [7:0] master_rx;
+    wire [4:0] rx_level;
+    wire [31:0] rx_overflow_count;
+    wire [31:0] tx_underflow_count;
     integer test_count = 0;
     integer pass_count = 0;
     integer fail_count = 0;
     
     // Instantiate DUT
-    spi_slave dut (
+    spi_slave #(
+        .FIFO_DEPTH(16),
+        .SCK_CLOCKED(SCK_CLOCKED)
+    ) dut (
         .clk(clk),
         .reset(reset),
         .data_tx(data_tx),
@@ -40,6 +48,15 @@ module tb_spi_slave;
         .data_rx(data_rx),
         .rx_valid(rx_valid),
         .rx_read(rx_read),
+        .tx_watermark(8'd2),
+        .rx_watermark(8'd8),
+        .tx_level(),
+        .rx_level(rx_level),
+        .tx_low(),
+        .rx_high(),
+        .rx_overflow_count(rx_overflow_count),
+        .tx_underflow_count(tx_underflow_count),
+        .clear_counters(1'b0),
         .sck(sck),
         .mosi(mosi),
         .miso(miso),
@@ -68,9 +85,9 @@ module tb_spi_slave;
             // Wait a bit
             repeat(2) @(posedge clk);
             
-            // Assert chip select
+            // Assert chip select (the SCK-clocked slave needs 4 clk of setup)
             cs_n = 1'b0;
-            repeat(2) @(posedge clk);
+            repeat(4) @(posedge clk);
             
             // Transfer 8 bits
             for (integer i = 7; i >= 0; i = i - 1) begin
@@ -88,7 +105,7 @@ module tb_spi_slave;
             
             // Deassert chip select
             cs_n = 1'b1;
-            repeat(2) @(posedge clk);
+            repeat(4) @(posedge clk);
         end
     endtask
     
@@ -120,7 +137,6 @@ module tb_spi_slave;
         data_tx = 8'hAA;
         tx_valid = 1'b1;
         @(posedge clk);
-        wait(tx_ready == 1'b0);
         tx_valid = 1'b0;
         
         // Master transfers 0x55, expects to receive 0xAA
@@ -159,7 +175,6 @@ module tb_spi_slave;
             data_tx = 8'h10 + i;
             tx_valid = 1'b1;
             @(posedge clk);
-            wait(tx_ready == 1'b0);
             tx_valid = 1'b0;
             
             // Master transfer
@@ -189,7 +204,109 @@ module tb_spi_slave;
             end
         end
         
-        // Test 3: CS glitch during transfer
+        // Test 3: Burst under one CS assertion, serviced only afterwards
+        test_count = test_count + 1;
+        $display("\nTest %0d: Burst through the FIFOs", test_count);
+        
+        for (integer i = 0; i < 4; i = i + 1) begin
+            data_tx = 8'hC0 + i;
+            tx_valid = 1'b1;
+            @(posedge clk);
+        end
+        tx_valid = 1'b0;
+        
+        cs_n = 1'b0;
+        repeat(4) @(posedge clk);
+        for (integer b = 0; b < 4; b = b + 1) begin
+            for (integer i = 7; i >= 0; i = i - 1) begin
+                mosi = ((8'h30 + b) >> i) & 1'b1;
+                #10 sck = 1'b1;
+                #20 sck = 1'b0;
+                #10;
+                master_rx[i] = miso;
+            end
+            if (master_rx == (8'hC0 + b)) begin
+                pass_count = pass_count + 1;
+            end else begin
+                $display("  Burst byte %0d: Master FAIL (0x%02X)", b, master_rx);
+                fail_count = fail_count + 1;
+            end
+        end
+        cs_n = 1'b1;
+        repeat(4) @(posedge clk);
+        
+        if (rx_level == 4) begin
+            $display("  PASS: 4 bytes queued in the RX FIFO");
+            pass_count = pass_count + 1;
+        end else begin
+            $display("  FAIL: RX level %0d, expected 4", rx_level);
+            fail_count = fail_count + 1;
+        end
+        
+        for (integer b = 0; b < 4; b = b + 1) begin
+            if (data_rx == (8'h30 + b)) begin
+                pass_count = pass_count + 1;
+            end else begin
+                $display("  Burst byte %0d: Slave FAIL (0x%02X)", b, data_rx);
+                fail_count = fail_count + 1;
+            end
+            rx_read = 1'b1;
+            @(posedge clk);
+            rx_read = 1'b0;
+            @(posedge clk);
+        end
+        
+        if (rx_overflow_count == 0 && tx_underflow_count == 0) begin
+            $display("  PASS: No overflow or underflow");
+            pass_count = pass_count + 1;
+        end else begin
+            $display("  FAIL: %0d overflows, %0d underflows", rx_overflow_count, tx_underflow_count);
+            fail_count = fail_count + 1;
+        end
+        
+        // Test 4: TX FIFO empty at CS assert, refilled during the first byte
+        test_count = test_count + 1;
+        $display("\nTest %0d: TX data queued during a burst", test_count);
+        
+        cs_n = 1'b0;
+        repeat(4) @(posedge clk);
+        for (integer b = 0; b < 2; b = b + 1) begin
+            for (integer i = 7; i >= 0; i = i - 1) begin
+                mosi = 1'b0;
+                #10 sck = 1'b1;
+                #20 sck = 1'b0;
+                #10;
+                master_rx[i] = miso;
+                
+                // Queue the next byte once the first has started
+                if (b == 0 && i == 7) begin
+                    repeat(4) @(posedge clk);
+                    data_tx = 8'hA5;
+                    tx_valid = 1'b1;
+                    @(posedge clk);
+                    tx_valid = 1'b0;
+                    repeat(2) @(posedge clk);
+                end
+            end
+            if (master_rx == ((b == 0) ? 8'hFF : 8'hA5)) begin
+                pass_count = pass_count + 1;
+            end else begin
+                $display("  Burst byte %0d: Master FAIL (0x%02X)", b, master_rx);
+                fail_count = fail_count + 1;
+            end
+        end
+        cs_n = 1'b1;
+        repeat(4) @(posedge clk);
+        
+        for (integer b = 0; b < 2; b = b + 1) begin
+            rx_read = 1'b1;
+            @(posedge clk);
+            rx_read = 1'b0;
+            @(posedge clk);
+        end
+        $display("  Queued byte sent after TX_FILL");
+        
+        // Test 5: CS glitch during transfer
         test_count = test_count + 1;
         $display("\nTest %0d: CS glitch test", test_count);
         
@@ -0,0 +1,326 @@
+// Verilator Co-simulation Harness
+// Runs the host-compiled firmware (main.c, spi_driver.c, spi_queue.c,
+// timer.c) against a Verilated spi_controller. The host program takes the
+// place of simple_cpu: the firmware is built with the SPI_BUS_HOST register
+// backend (spi_hal.h), every access becomes one Wishbone cycle on the
+// controller, and the timer at TIMER_BASE_ADDR is
+// modelled here from the simulated cycle count, so timeouts and delays are
+// measured in RTL clock cycles.
+//
+// SPI IO lanes are looped back externally (MISO follows MOSI in single-lane
+// mode, each quad lane reads back its own output). The DMA master port is
+// served from the host buffers the firmware maps with spi_model_map_memory(),
+// as in the host model, and from a sparse harness-local memory elsewhere.
+// spi_model_set_irq_handler() lets irq_o in between register accesses.
+// Only controller 0 is instantiated: accesses to the windows of the other
+// controllers complete in one cycle and read zero, so the firmware finds
+// them absent.
+//
+// Plusargs: +trace writes vsim.vcd (Verilator built with --trace)
+
+#include "Vspi_controller.h"
+#include "verilated.h"
+#if VM_TRACE
+#include "verilated_vcd_c.h"
+#endif
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
+#include <vector>
+
+// Firmware entry points (C objects; main.c built with -Dmain=firmware_main)
+extern "C" {
+int firmware_main(void);
+uint32_t spi_bus_read(uint32_t addr, uint32_t size);
+void spi_bus_write(uint32_t addr, uint32_t size, uint32_t value);
+void spi_bus_wait_irq(void);
+void spi_model_map_memory(uint32_t bus_addr, void *host, uint32_t size);
+void spi_model_set_irq_handler(uint32_t ctrl, void (*handler)(void));
+}
+
+// Configuration
+static const uint32_t CLK_HZ = 50000000;
+static const uint32_t TIMER_BASE = 0x40001000;
+static const uint32_t TIMER_COUNT_LO = 0x00;
+static const uint32_t TIMER_COUNT_HI = 0x04;
+static const uint32_t TIMER_FREQ = 0x08;
+static const uint32_t BUS_TIMEOUT = 1000000;  // Cycles to wait for an ack
+static const uint32_t SPI_BASE = 0x40000000;
+static const uint32_t XIP_BASE = 0x60000000;
+static const uint32_t XIP_SIZE = 0x01000000;
+
+// Simulation state
+static VerilatedContext *contextp;
+static Vspi_controller *dut;
+static uint64_t cycles = 0;
+static uint32_t timer_hi_snapshot = 0;
+static std::unordered_map<uint32_t, uint32_t> dma_mem;
+static void (*irq_handler)(void) = nullptr;
+static bool in_irq = false;
+
+// Host memory visible to the DMA master
+struct DmaWindow {
+    uint32_t bus_addr;
+    uint8_t *host;
+    uint32_t size;
+};
+static std::vector<DmaWindow> dma_windows;
+
+static uint8_t *dma_locate(uint32_t addr) {
+    for (const DmaWindow &w : dma_windows) {
+        if (addr - w.bus_addr < w.size) {
+            return w.host + (addr - w.bus_addr);
+        }
+    }
+    return nullptr;
+}
+#if VM_TRACE
+static VerilatedVcdC *tracep = nullptr;
+#endif
+
+// External loopback on the SPI IO pins
+static void drive_io(void) {
+    uint8_t out = dut->spi_io_o;
+    uint8_t oe = dut->spi_io_oe;
+    uint8_t in = out & oe;
+    
+    // Single-lane frames read MISO (IO1) while only IO0 drives
+    if (!(oe & 0x2)) {
+        in = (in & ~0x2) | ((out & 0x1) << 1);
+    }
+    // Undriven WP#/HOLD# float high
+    in |= ~oe & 0xC;
+    dut->spi_io_i = in & 0xF;
+}
+
+// Wishbone slave for the DMA master port: one-cycle registered ack. Each
+// byte lane comes from a mapped host buffer when one covers it.
+static void service_dma(void) {
+    if (dut->dma_cyc_o && dut->dma_stb_o && !dut->dma_ack_i) {
+        uint32_t addr = dut->dma_addr_o & ~3u;
+        uint32_t word = dma_mem[addr];
+        for (int lane = 0; lane < 4; lane++) {
+            uint8_t *host = dma_locate(addr + lane);
+            uint32_t mask = 0xFFu << (lane * 8);
+            if (host) {
+                word = (word & ~mask) | ((uint32_t)*host << (lane * 8));
+            }
+        }
+        if (dut->dma_we_o) {
+            for (int lane = 0; lane < 4; lane++) {
+                if (dut->dma_sel_o & (1u << lane)) {
+                    uint32_t mask = 0xFFu << (lane * 8);
+                    word = (word & ~mask) | (dut->dma_data_o & mask);
+                    uint8_t *host = dma_locate(addr + lane);
+                    if (host) {
+                        *host = (uint8_t)(dut->dma_data_o >> (lane * 8));
+                    }
+                }
+            }
+            dma_mem[addr] = word;
+        }
+        dut->dma_data_i = word;
+        dut->dma_ack_i = 1;
+    } else {
+        dut->dma_ack_i = 0;
+    }
+}
+
+// Advance one clock cycle
+static void tick(void) {
+    dut->clk = 0;
+    dut->eval();
+#if VM_TRACE
+    if (tracep) tracep->dump(contextp->time());
+#endif
+    contextp->timeInc(10);
+    
+    dut->clk = 1;
+    dut->eval();
+    drive_io();
+    service_dma();
+    dut->eval();
+#if VM_TRACE
+    if (tracep) tracep->dump(contextp->time());
+#endif
+    contextp->timeInc(10);
+    cycles++;
+}
+
+// One Wishbone single cycle; returns the read data sampled with the ack
+static uint32_t wb_cycle(uint32_t addr, uint32_t data, bool write) {
+    uint32_t rdata = 0;
+    uint32_t waited = 0;
+    
+    dut->wb_addr_i = addr;
+    dut->wb_data_i = data;
+    dut->wb_we_i = write;
+    dut->wb_stb_i = 1;
+    dut->wb_cyc_i = 1;
+    
+    do {
+        tick();
+        if (++waited > BUS_TIMEOUT) {
+            fprintf(stderr, "[sim] Bus timeout at 0x%08X (cycle %llu)\n",
+                    addr, (unsigned long long)cycles);
+            exit(2);
+        }
+    } while (!dut->wb_ack_o);
+    rdata = dut->wb_data_o;
+    
+    dut->wb_stb_i = 0;
+    dut->wb_cyc_i = 0;
+    dut->wb_we_i = 0;
+    dut->eval();
+    
+    return rdata;
+}
+
+// Addresses decoded by the controller: its registers and XIP window
+static bool dut_selected(uint32_t addr) {
+    return (addr & ~0xFFu) == SPI_BASE || addr - XIP_BASE < XIP_SIZE;
+}
+
+// Timer registers, modelled on the simulated clock. Each access costs one
+// cycle so polling loops always make progress.
+static uint32_t timer_read(uint32_t offset) {
+    tick();
+    switch (offset) {
+        case TIMER_COUNT_LO:
+            timer_hi_snapshot = (uint32_t)(cycles >> 32);
+            return (uint32_t)cycles;
+        case TIMER_COUNT_HI:
+            return timer_hi_snapshot;
+        case TIMER_FREQ:
+            return CLK_HZ;
+        default:
+            return 0;
+    }
+}
+
+// Take irq_o after an access, the way the CPU would between instructions
+static void take_irq(void) {
+    if (irq_handler && !in_irq && dut->irq_o) {
+        in_irq = true;
+        irq_handler();
+        in_irq = false;
+    }
+}
+
+// Register backend for the firmware. Byte accesses read the containing
+// word and write the value on its byte lane, as the CPU's byte loads and
+// stores would.
+uint32_t spi_bus_read(uint32_t addr, uint32_t size) {
+    uint32_t shift = (size < 4) ? (addr & 3u) * 8 : 0;
+    uint32_t data;
+    
+    if ((addr & ~0xFFFu) == TIMER_BASE) {
+        data = timer_read(addr & 0xFFCu);
+    } else if (dut_selected(addr)) {
+        data = wb_cycle(addr & ~3u, 0, false);
+    } else {
+        tick();
+        data = 0;
+    }
+    take_irq();
+    
+    data >>= shift;
+    return (size < 4) ? (data & ((1u << (size * 8)) - 1)) : data;
+}
+
+void spi_bus_write(uint32_t addr, uint32_t size, uint32_t value) {
+    uint32_t shift = (size < 4) ? (addr & 3u) * 8 : 0;
+    
+    if ((addr & ~0xFFFu) == TIMER_BASE) {
+        tick();  // Timer registers are read-only
+        return;
+    }
+    if (!dut_selected(addr)) {
+        tick();
+        return;
+    }
+    wb_cycle(addr & ~3u, value << shift, true);
+    take_irq();
+}
+
+// WFI: clock the controller until irq_o rises. Nothing else can wake the
+// firmware, so a wait that outlasts BUS_TIMEOUT is reported like a hung
+// bus cycle.
+void spi_bus_wait_irq(void) {
+    uint32_t waited = 0;
+    
+    while (!dut->irq_o) {
+        tick();
+        if (++waited > BUS_TIMEOUT) {
+            fprintf(stderr, "[sim] WFI without an interrupt (cycle %llu)\n",
+                    (unsigned long long)cycles);
+            exit(2);
+        }
+    }
+    take_irq();
+}
+
+void spi_model_map_memory(uint32_t bus_addr, void *host, uint32_t size) {
+    dma_windows.push_back({bus_addr, (uint8_t *)host, size});
+}
+
+// Only controller 0 exists here
+void spi_model_set_irq_handler(uint32_t ctrl, void (*handler)(void)) {
+    if (ctrl == 0) {
+        irq_handler = handler;
+    }
+}
+
+int main(int argc, char **argv) {
+    contextp = new VerilatedContext;
+    contextp->commandArgs(argc, argv);
+    dut = new Vspi_controller{contextp};
+
+#if VM_TRACE
+    const char *trace_arg = contextp->commandArgsPlusMatch("trace");
+    if (trace_arg && trace_arg[0]) {
+        contextp->traceEverOn(true);
+        tracep = new VerilatedVcdC;
+        dut->trace(tracep, 99);
+        tracep->open("vsim.vcd");
+    }
+#endif
+    
+    // Reset
+    dut->reset = 1;
+    dut->wb_stb_i = 0;
+    dut->wb_cyc_i = 0;
+    dut->wb_we_i = 0;
+    dut->dma_ack_i = 0;
+    for (int i = 0; i < 10; i++) {
+        tick();
+    }
+    dut->reset = 0;
+    for (int i = 0; i < 5; i++) {
+        tick();
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    int result = firmware_main();
+    auto stop = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(stop - start).count();
+    
+    printf("\n[sim] %llu cycles (%.3f ms at %u Hz) in %.2f s, %.2f Mcycles/s\n",
+           (unsigned long long)cycles, cycles * 1000.0 / CLK_HZ, CLK_HZ,
+           seconds, seconds > 0 ? cycles / seconds / 1e6 : 0.0);
+    
+    dut->final();
+#if VM_TRACE
+    if (tracep) {
+        tracep->close();
+        delete tracep;
+    }
+#endif
+    delete dut;
+    delete contextp;
+    
+    return result;
+}